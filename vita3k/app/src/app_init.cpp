@@ -28,8 +28,8 @@
 #include <renderer/functions.h>
 #include <rtc/rtc.h>
 #include <util/fs.h>
-#include <util/lock_and_find.h>
 #include <util/log.h>
+#include <util/string_utils.h>
 
 #if DISCORD_RPC
 #include <app/discord.h>
@@ -41,7 +41,6 @@
 
 #ifdef USE_VULKAN
 #include <renderer/vulkan/functions.h>
-#include <util/string_utils.h>
 #endif
 
 #include <SDL_video.h>
@@ -95,7 +94,7 @@ void update_viewport(HostState &state) {
 
 bool init(HostState &state, Config &cfg, const Root &root_paths) {
     const ResumeAudioThread resume_thread = [&state](SceUID thread_id) {
-        const auto thread = lock_and_find(thread_id, state.kernel.threads, state.kernel.mutex);
+        const auto thread = state.kernel.threads.get(thread_id);
         const std::lock_guard<std::mutex> lock(thread->mutex);
         if (thread->to_do == ThreadToDo::wait) {
             thread->to_do = ThreadToDo::run;
@@ -124,6 +123,8 @@ bool init(HostState &state, Config &cfg, const Root &root_paths) {
     if (string_utils::toupper(state.cfg.backend_renderer) == "VULKAN")
         backend = renderer::Backend::Vulkan;
 #endif
+    if (string_utils::toupper(state.cfg.backend_renderer) == "NULL")
+        backend = renderer::Backend::Null;
 
     int window_type = 0;
     switch (backend) {
@@ -135,20 +136,25 @@ bool init(HostState &state, Config &cfg, const Root &root_paths) {
         window_type = SDL_WINDOW_VULKAN;
         break;
 #endif
+    case renderer::Backend::Null:
+        break;
     default:
         LOG_ERROR("Unimplemented backend render: {}.", state.cfg.backend_renderer);
         break;
     }
 
-    if (cfg.fullscreen) {
-        state.display.fullscreen = true;
-        window_type |= SDL_WINDOW_FULLSCREEN_DESKTOP;
-    }
-    state.window = WindowPtr(SDL_CreateWindow(window_title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, DEFAULT_RES_WIDTH, DEFAULT_RES_HEIGHT, window_type | SDL_WINDOW_RESIZABLE), SDL_DestroyWindow);
+    // The Null backend draws nothing and runs in console mode, where SDL video is not even initialised.
+    if (backend != renderer::Backend::Null) {
+        if (cfg.fullscreen) {
+            state.display.fullscreen = true;
+            window_type |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+        }
+        state.window = WindowPtr(SDL_CreateWindow(window_title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, DEFAULT_RES_WIDTH, DEFAULT_RES_HEIGHT, window_type | SDL_WINDOW_RESIZABLE), SDL_DestroyWindow);
 
-    if (!state.window) {
-        LOG_ERROR("SDL failed to create window!");
-        return false;
+        if (!state.window) {
+            LOG_ERROR("SDL failed to create window!");
+            return false;
+        }
     }
 
     if (!init(state.mem)) {
@@ -156,6 +162,14 @@ bool init(HostState &state, Config &cfg, const Root &root_paths) {
         return false;
     }
 
+    if (string_utils::toupper(state.cfg.cpu_backend) == "UNICORN")
+        state.kernel.cpu_backend = CPUBackend::Unicorn;
+    else
+        LOG_ERROR("Unknown CPU backend: {}, falling back to Unicorn.", state.cfg.cpu_backend);
+
+    if (state.cfg.share_jit_cache)
+        state.kernel.jit_cache = init_jit_cache(state.mem);
+
     if (!init(state.audio, resume_thread)) {
         LOG_WARN("Failed to init audio! Audio will not work.");
     }
@@ -180,6 +194,16 @@ bool init(HostState &state, Config &cfg, const Root &root_paths) {
     state.kernel.start_tick = { rtc_base_ticks() };
     state.kernel.base_tick = { rtc_base_ticks() };
 
+    if (backend == renderer::Backend::Null) {
+        // Nothing is displayed, so the host GUI can't run on top of it.
+        if (!cfg.console) {
+            LOG_ERROR("The Null renderer backend only runs in console mode.");
+            return false;
+        }
+
+        return renderer::init(state.window.get(), state.renderer, backend);
+    }
+
     if (!cfg.console) {
         if (renderer::init(state.window.get(), state.renderer, backend)) {
             update_viewport(state);
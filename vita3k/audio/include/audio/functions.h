@@ -21,8 +21,14 @@
 
 #include <functional>
 
+struct AudioOutPort;
 struct AudioState;
 
 typedef std::function<void(SceUID)> ResumeAudioThread;
 
 bool init(AudioState &state, ResumeAudioThread resume_thread);
+
+// Returns the new port's id, or -1 if it could not be opened.
+int open_out_port(AudioState &state, int len, int freq, int channels);
+// Queues len_bytes of guest samples. Returns how many bytes are waiting to be played afterwards.
+size_t output_to_out_port(AudioOutPort &port, const void *buf);
@@ -0,0 +1,87 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Byte queue between exactly one writing and one reading thread. Neither side locks or waits for the other.
+class AudioRingBuffer {
+public:
+    // Rounded up to a power of two. Not thread safe, call before the buffer is shared.
+    void resize(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        data.assign(size, 0);
+        read_position = 0;
+        write_position = 0;
+    }
+
+    size_t capacity() const {
+        return data.size();
+    }
+
+    // Bytes waiting to be read. Exact for the reader, a lower bound for the writer.
+    size_t available() const {
+        return write_position.load(std::memory_order_acquire) - read_position.load(std::memory_order_acquire);
+    }
+
+    // Writer only. Returns how many bytes fitted.
+    size_t write(const void *src, size_t size) {
+        const size_t write_at = write_position.load(std::memory_order_relaxed);
+        const size_t free = data.size() - (write_at - read_position.load(std::memory_order_acquire));
+        size = std::min(size, free);
+
+        const size_t offset = write_at & (data.size() - 1);
+        const size_t first = std::min(size, data.size() - offset);
+        std::memcpy(&data[offset], src, first);
+        std::memcpy(&data[0], static_cast<const uint8_t *>(src) + first, size - first);
+
+        write_position.store(write_at + size, std::memory_order_release);
+        return size;
+    }
+
+    // Reader only. Hands up to size bytes to consume(const uint8_t *data, size_t size) in at most two contiguous
+    // pieces, then frees them. Returns how many bytes were read.
+    template <typename Consume>
+    size_t read(size_t size, Consume &&consume) {
+        const size_t read_at = read_position.load(std::memory_order_relaxed);
+        size = std::min(size, write_position.load(std::memory_order_acquire) - read_at);
+
+        const size_t offset = read_at & (data.size() - 1);
+        const size_t first = std::min(size, data.size() - offset);
+        if (first > 0)
+            consume(&data[offset], first);
+        if (size > first)
+            consume(&data[0], size - first);
+
+        read_position.store(read_at + size, std::memory_order_release);
+        return size;
+    }
+
+private:
+    std::vector<uint8_t> data;
+    // Both only ever grow, the buffer holds write_position - read_position bytes.
+    alignas(64) std::atomic<size_t> read_position{ 0 };
+    alignas(64) std::atomic<size_t> write_position{ 0 };
+};
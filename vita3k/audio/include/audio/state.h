@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <audio/ring_buffer.h>
 #include <util/types.h>
 
 #include <SDL_audio.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -34,14 +36,22 @@ struct ReadOnlyAudioOutPortState {
     int len_bytes = 0;
 };
 
+// Only used by the guest threads outputting to the port.
+struct GuestAudioOutPortState {
+    std::mutex mutex; // Keeps the ring single producer if several threads output to the same port.
+    AudioStreamPtr stream; // Converts to the device format. Null if the port already matches it.
+    std::vector<uint8_t> converted;
+};
+
+// Shared with the audio callback without locking.
 struct SharedAudioOutPortState {
-    std::mutex mutex;
-    AudioStreamPtr stream;
-    SceUID thread = -1;
+    AudioRingBuffer buffer; // Samples in the device format.
+    std::atomic<SceUID> thread{ -1 }; // Waiting for the buffer to drain.
 };
 
 struct AudioOutPort {
     ReadOnlyAudioOutPortState ro;
+    GuestAudioOutPortState guest;
     SharedAudioOutPortState shared;
 };
 
@@ -61,13 +71,16 @@ struct ReadOnlyAudioState {
 };
 
 struct AudioCallbackState {
-    std::vector<uint8_t> temp_buffer;
+    // Copy of the shared ports, refreshed when their version changes.
+    std::vector<AudioOutPortPtr> out_ports;
+    uint32_t out_ports_version = 0;
 };
 
 struct SharedAudioState {
     std::mutex mutex;
     int next_port_id = 0;
     AudioOutPortPtrs out_ports;
+    std::atomic<uint32_t> out_ports_version{ 0 }; // Bumped under the mutex whenever out_ports changes.
     AudioInPort in_port;
 };
 
@@ -24,36 +24,86 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_MIX_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_MIX_NEON
+#endif
+
 #define AUDIO_PROFILE(name) MICROPROFILE_SCOPEI("Audio", name, MP_THISTLE)
 
-static void mix_out_port(uint8_t *stream, uint8_t *temp_buffer, int len, AudioOutPort &port, const ResumeAudioThread &resume_thread) {
+// Saturates like SDL_MixAudio does at full volume.
+static void mix_s16(int16_t *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+#if defined(AUDIO_MIX_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        const __m128i mixed = _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&dst[i])), _mm_loadu_si128(reinterpret_cast<const __m128i *>(&src[i])));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[i]), mixed);
+    }
+#elif defined(AUDIO_MIX_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(&dst[i], vqaddq_s16(vld1q_s16(&dst[i]), vld1q_s16(&src[i])));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = static_cast<int16_t>(std::clamp(dst[i] + src[i], INT16_MIN, INT16_MAX));
+    }
+}
+
+static void mix_f32(float *dst, const float *src, size_t count) {
+    size_t i = 0;
+#if defined(AUDIO_MIX_SSE2)
+    const __m128 min = _mm_set1_ps(-1.0f);
+    const __m128 max = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 mixed = _mm_add_ps(_mm_loadu_ps(&dst[i]), _mm_loadu_ps(&src[i]));
+        _mm_storeu_ps(&dst[i], _mm_min_ps(_mm_max_ps(mixed, min), max));
+    }
+#elif defined(AUDIO_MIX_NEON)
+    const float32x4_t min = vdupq_n_f32(-1.0f);
+    const float32x4_t max = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t mixed = vaddq_f32(vld1q_f32(&dst[i]), vld1q_f32(&src[i]));
+        vst1q_f32(&dst[i], vminq_f32(vmaxq_f32(mixed, min), max));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = std::clamp(dst[i] + src[i], -1.0f, 1.0f);
+    }
+}
+
+static void mix_out_port(uint8_t *stream, int len, SDL_AudioFormat format, AudioOutPort &port, const ResumeAudioThread &resume_thread) {
     AUDIO_PROFILE(__func__);
 
     // How much data is available?
-    std::unique_lock<std::mutex> lock(port.shared.mutex);
-    const int bytes_available = SDL_AudioStreamAvailable(port.shared.stream.get());
-    assert(bytes_available >= 0);
+    AudioRingBuffer &buffer = port.shared.buffer;
+    const size_t bytes_available = buffer.available();
 
     // Running out of data?
     // The (len * 2) is just a guess that seems to work.
-    if (bytes_available < (len * 2)) {
-        // Is there a thread waiting for playback to finish?
-        if (port.shared.thread >= 0) {
-            // Wake the thread up.
-            resume_thread(port.shared.thread);
-            port.shared.thread = -1;
+    if (bytes_available < static_cast<size_t>(len * 2)) {
+        // Is there a thread waiting for playback to finish? If so, wake it up.
+        const SceUID thread = port.shared.thread.exchange(-1);
+        if (thread >= 0) {
+            resume_thread(thread);
         }
     }
 
-    // Mix as much as we need.
-    const int bytes_to_get = std::min(len, bytes_available);
-    const int bytes_got = SDL_AudioStreamGet(port.shared.stream.get(), temp_buffer, bytes_to_get);
-    lock.unlock();
-    if (bytes_got > 0) {
-        SDL_MixAudio(stream, temp_buffer, bytes_got, SDL_MIX_MAXVOLUME);
-    }
+    // Mix as much as we need, straight out of the ring.
+    uint8_t *dst = stream;
+    buffer.read(std::min(static_cast<size_t>(len), bytes_available), [&dst, format](const uint8_t *src, size_t size) {
+        if (format == AUDIO_F32LSB) {
+            mix_f32(reinterpret_cast<float *>(dst), reinterpret_cast<const float *>(src), size / sizeof(float));
+        } else {
+            mix_s16(reinterpret_cast<int16_t *>(dst), reinterpret_cast<const int16_t *>(src), size / sizeof(int16_t));
+        }
+        dst += size;
+    });
 }
 
 static void SDLCALL audio_callback(void *userdata, Uint8 *stream, int len) {
@@ -63,22 +113,24 @@ static void SDLCALL audio_callback(void *userdata, Uint8 *stream, int len) {
     assert(stream != nullptr);
     AudioState &state = *static_cast<AudioState *>(userdata);
     assert(len == state.ro.spec.size);
-    assert(len == state.callback.temp_buffer.size());
-
-    std::vector<AudioOutPortPtr> ports;
-    {
-        // Read from shared state.
-        const std::lock_guard<std::mutex> lock(state.shared.mutex);
-        ports.reserve(state.shared.out_ports.size());
-        for (const AudioOutPortPtrs::value_type &port : state.shared.out_ports) {
-            ports.push_back(port.second);
+
+    // Only look at the shared ports when one was opened. Never wait for the lock, the ports will be picked up next time.
+    const uint32_t out_ports_version = state.shared.out_ports_version.load(std::memory_order_acquire);
+    if (out_ports_version != state.callback.out_ports_version) {
+        const std::unique_lock<std::mutex> lock(state.shared.mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            state.callback.out_ports.clear();
+            for (const AudioOutPortPtrs::value_type &port : state.shared.out_ports) {
+                state.callback.out_ports.push_back(port.second);
+            }
+            state.callback.out_ports_version = state.shared.out_ports_version.load(std::memory_order_relaxed);
         }
     }
 
     std::memset(stream, state.ro.spec.silence, len);
 
-    for (const AudioOutPortPtr &port : ports) {
-        mix_out_port(stream, state.callback.temp_buffer.data(), len, *port, state.ro.resume_thread);
+    for (const AudioOutPortPtr &port : state.callback.out_ports) {
+        mix_out_port(stream, len, state.ro.spec.format, *port, state.ro.resume_thread);
     }
 }
 
@@ -102,10 +154,67 @@ bool init(AudioState &state, ResumeAudioThread resume_thread) {
         return false;
     }
 
+    // The mixer only handles these formats, have SDL convert from the desired one otherwise.
+    if ((state.ro.spec.format != AUDIO_S16LSB) && (state.ro.spec.format != AUDIO_F32LSB)) {
+        SDL_CloseAudio();
+        if (SDL_OpenAudio(&desired, nullptr) != 0) {
+            LOG_ERROR("SDL audio error: {}", SDL_GetError());
+            return false;
+        }
+
+        state.ro.spec = desired;
+    }
+
     state.device = AudioDevicePtr(nullptr, close_audio);
-    state.callback.temp_buffer.resize(state.ro.spec.size);
 
     SDL_PauseAudio(0);
 
     return true;
 }
+
+int open_out_port(AudioState &state, int len, int freq, int channels) {
+    const SDL_AudioSpec &spec = state.ro.spec;
+    const AudioOutPortPtr port = std::make_shared<AudioOutPort>();
+    port->ro.len_bytes = len * channels * sizeof(int16_t);
+
+    size_t converted_size = port->ro.len_bytes;
+    if ((spec.format != AUDIO_S16LSB) || (spec.channels != channels) || (spec.freq != freq)) {
+        port->guest.stream = AudioStreamPtr(SDL_NewAudioStream(AUDIO_S16LSB, channels, freq, spec.format, spec.channels, spec.freq), SDL_FreeAudioStream);
+        if (!port->guest.stream) {
+            LOG_ERROR("SDL audio error: {}", SDL_GetError());
+            return -1;
+        }
+
+        // Leave room for the resampler's rounding.
+        const size_t frame_size = spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+        converted_size = (static_cast<size_t>(len) * spec.freq / freq + 16) * frame_size;
+        port->guest.converted.resize(converted_size);
+    }
+
+    // The callback wakes the guest up below two callbacks' worth of data, and the guest only waits above one.
+    port->shared.buffer.resize((spec.size + converted_size) * 2);
+
+    const std::lock_guard<std::mutex> lock(state.shared.mutex);
+    const int port_id = state.shared.next_port_id++;
+    state.shared.out_ports.emplace(port_id, port);
+    state.shared.out_ports_version.fetch_add(1, std::memory_order_release);
+
+    return port_id;
+}
+
+size_t output_to_out_port(AudioOutPort &port, const void *buf) {
+    AUDIO_PROFILE(__func__);
+
+    const std::lock_guard<std::mutex> lock(port.guest.mutex);
+    if (!port.guest.stream) {
+        port.shared.buffer.write(buf, port.ro.len_bytes);
+    } else {
+        SDL_AudioStreamPut(port.guest.stream.get(), buf, port.ro.len_bytes);
+        int converted_size;
+        while ((converted_size = SDL_AudioStreamGet(port.guest.stream.get(), port.guest.converted.data(), static_cast<int>(port.guest.converted.size()))) > 0) {
+            port.shared.buffer.write(port.guest.converted.data(), converted_size);
+        }
+    }
+
+    return port.shared.buffer.available();
+}
@@ -28,6 +28,8 @@
 #define CONFIG_INDIVIDUAL(code)                                                                         \
     code(bool, "log-imports", false, log_imports)                                                       \
     code(bool, "stack-traceback", false, stack_traceback) \
+    code(bool, "share-jit-cache", false, share_jit_cache)                                               \
+    code(std::string, "cpu-backend", "Unicorn", cpu_backend)                                            \
     code(bool, "log-exports", false, log_exports)                                                       \
     code(bool, "log-active-shaders", false, log_active_shaders)                                         \
     code(bool, "log-uniforms", false, log_uniforms)                                                     \
@@ -38,6 +40,8 @@
     code(int, "icon-size", 64, icon_size)                                                               \
     code(bool, "archive-log", false, archive_log)                                                       \
     code(bool, "texture-cache", true, texture_cache)                                                    \
+    code(bool, "program-binary-cache", true, program_binary_cache)                                      \
+    code(std::string, "shader-compile-policy", "sync", shader_compile_policy)                           \
     code(int, "sys-button", static_cast<int>(SCE_SYSTEM_PARAM_ENTER_BUTTON_CROSS), sys_button)          \
     code(int, "sys-lang", static_cast<int>(SCE_SYSTEM_PARAM_LANG_ENGLISH_US), sys_lang)                 \
     code(bool, "auto-lle", false, auto_lle)                                                             \
@@ -93,7 +97,8 @@
 #define CONFIG_VECTOR(code)                                                                             \
     code(std::vector<std::string>, "lle-modules", std::vector<std::string>{}, lle_modules)              \
     code(std::vector<std::string>, "user-backgrounds",  std::vector<std::string>{}, user_backgrounds)   \
-    code(std::vector<std::string>, "online-id", std::vector<std::string>{"Vita3K"}, online_id)
+    code(std::vector<std::string>, "online-id", std::vector<std::string>{"Vita3K"}, online_id)          \
+    code(std::vector<std::string>, "title-shader-compile-policies", std::vector<std::string>{}, title_shader_compile_policies)
 
 // Parent macro for easier generation
 #define CONFIG_LIST(code)                                                                               \
@@ -25,6 +25,7 @@
 #include <stack>
 
 struct CPUState;
+struct JITCache;
 struct MemState;
 
 enum ImportCallLogLevel {
@@ -35,6 +36,10 @@ enum ImportCallLogLevel {
 
 constexpr ImportCallLogLevel IMPORT_CALL_LOG_LEVEL = None;
 
+enum class CPUBackend {
+    Unicorn,
+};
+
 struct CPUContext {
     uint32_t cpu_registers[16];
     uint32_t sp;
@@ -63,17 +68,25 @@ typedef std::function<std::string(Address)> ResolveNIDName;
 typedef std::function<Address(Address)> GetWatchMemoryAddr;
 typedef std::unique_ptr<CPUState, std::function<void(CPUState *)>> CPUStatePtr;
 typedef std::unique_ptr<CPUContext, std::function<void(CPUContext *)>> CPUContextPtr;
+typedef std::shared_ptr<JITCache> JITCachePtr;
 
 struct CPUDepInject {
-    CallImport call_import;
     CallSVC call_svc;
     ResolveNIDName resolve_nid_name;
     GetWatchMemoryAddr get_watch_memory_addr;
     std::vector<ModuleRegion> module_regions;
+    JITCachePtr jit_cache;
+    CPUBackend cpu_backend = CPUBackend::Unicorn;
     bool trace_stack;
 };
 
+// Shared translation cache (Unicorn backend). Engines of exited threads are kept with their translated
+// blocks and handed to new threads instead of opening (and translating into) a fresh one each time.
+JITCachePtr init_jit_cache(MemState &mem);
+void invalidate_jit_cache(JITCache &cache, Address addr, size_t size);
+
 CPUStatePtr init_cpu(SceUID thread_id, Address pc, Address sp, MemState &mem, CPUDepInject &inject);
+SceUID get_thread_id(CPUState &state);
 int run(CPUState &state, bool callback, Address entry_point);
 int step(CPUState &state, bool callback, Address entry_point);
 void stop(CPUState &state);
@@ -0,0 +1,96 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#pragma once
+
+#include <cpu/functions.h>
+#include <cpu/impl/interface.h>
+
+#include <unicorn/unicorn.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+typedef std::unique_ptr<uc_struct, std::function<void(uc_struct *)>> UnicornPtr;
+
+struct InvalidateRange {
+    Address addr;
+    size_t size;
+};
+
+class UnicornCPU : public CPUInterface {
+    CPUState *parent;
+    UnicornPtr engine;
+    JITCachePtr jit_cache;
+
+    uc_hook interrupt_hook = 0;
+    uc_hook stack_hook = 0;
+    uc_hook memory_read_hook = 0;
+    uc_hook memory_write_hook = 0;
+    uc_hook code_hook = 0;
+
+    static void intr_hook(uc_engine *uc, uint32_t intno, void *user_data);
+    static void stack_trace_hook(uc_engine *uc, uint64_t address, uint32_t size, void *user_data);
+    static void code_log_hook(uc_engine *uc, uint64_t address, uint32_t size, void *user_data);
+    static void read_hook(uc_engine *uc, uc_mem_type type, uint64_t address, int size, int64_t value, void *user_data);
+    static void write_hook(uc_engine *uc, uc_mem_type type, uint64_t address, int size, int64_t value, void *user_data);
+
+    void log_error(uc_err code);
+
+public:
+    // Ranges written while this engine was running. Only the owning thread may touch the engine,
+    // so they are flushed the next time it enters run/step or traps into an SVC.
+    std::vector<InvalidateRange> pending_invalidations; // protected by jit_cache->mutex
+    std::atomic<bool> has_pending_invalidations{ false };
+    // Set when a flush failed. The engine may run stale code, so it is closed instead of recycled.
+    bool stale_translations = false;
+
+    UnicornCPU(CPUState *state, Address pc, Address sp, bool trace_stack, const JITCachePtr &jit_cache);
+    ~UnicornCPU() override;
+
+    void flush_pending_invalidations();
+
+    int run(Address pc, Address until) override;
+    int step(Address pc) override;
+    void stop() override;
+
+    uint32_t get_reg(uint8_t idx) override;
+    void set_reg(uint8_t idx, uint32_t val) override;
+    float get_float_reg(uint8_t idx) override;
+    void set_float_reg(uint8_t idx, float val) override;
+
+    uint32_t get_sp() override;
+    void set_sp(uint32_t val) override;
+    uint32_t get_pc() override;
+    void set_pc(uint32_t val) override;
+    uint32_t get_lr() override;
+    void set_lr(uint32_t val) override;
+    uint32_t get_cpsr() override;
+    void set_cpsr(uint32_t val) override;
+    uint32_t get_fpscr() override;
+    void set_fpscr(uint32_t val) override;
+    uint32_t get_tpidruro() override;
+    void set_tpidruro(uint32_t val) override;
+
+    bool is_thumb_mode() override;
+
+    void set_log_code(bool log) override;
+    void set_log_mem(bool log) override;
+    bool get_log_code() override;
+    bool get_log_mem() override;
+};
@@ -0,0 +1,509 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#include <cpu/impl/unicorn_cpu.h>
+#include <cpu/state.h>
+
+#include <disasm/functions.h>
+#include <mem/ptr.h>
+#include <util/align.h>
+#include <util/log.h>
+#include <util/string_utils.h>
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+constexpr bool LOG_REGISTERS = false;
+constexpr bool TRACE_RETURN_VALUES = true;
+
+constexpr uint32_t INT_SVC = 2;
+constexpr uint32_t INT_BKPT = 7;
+
+union DoubleReg {
+    double d;
+    float f[2];
+};
+
+struct JITCache {
+    MemState *mem = nullptr;
+    std::mutex mutex;
+    // Engines whose guest thread exited. Their translated blocks stay valid for the next thread.
+    std::vector<uc_engine *> idle_engines;
+    std::vector<UnicornCPU *> active_cpus;
+    uint32_t initial_cpsr = 0;
+
+    ~JITCache() {
+        for (uc_engine *uc : idle_engines)
+            uc_close(uc);
+    }
+};
+
+// uc_ctl, and with it dropping translated blocks, only exists from Unicorn 2 on.
+#if defined(UC_API_MAJOR) && (UC_API_MAJOR >= 2)
+#define UNICORN_REMOVE_CACHE 1
+#endif
+
+// Returns false if the translations could not be dropped, the engine must not be recycled then.
+static bool flush_translations(uc_engine *uc, const InvalidateRange &range) {
+#ifdef UNICORN_REMOVE_CACHE
+    // Guest memory is mapped straight into Unicorn, so host writes never reach its TB tracking.
+    const uc_err err = uc_ctl_remove_cache(uc, static_cast<uint64_t>(range.addr), static_cast<uint64_t>(range.addr) + range.size);
+    if (err != UC_ERR_OK) {
+        LOG_ERROR("Failed to flush translations at {} ({} bytes): {}", log_hex(range.addr), range.size, uc_strerror(err));
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+JITCachePtr init_jit_cache(MemState &mem) {
+    const JITCachePtr cache = std::make_shared<JITCache>();
+    cache->mem = &mem;
+    return cache;
+}
+
+void invalidate_jit_cache(JITCache &cache, Address addr, size_t size) {
+    MemState &mem = *cache.mem;
+    // The null page is never mapped into Unicorn.
+    const Address start = std::max<Address>(align_down(addr, mem.page_size), static_cast<Address>(mem.page_size));
+    const uint64_t end = align(static_cast<uint64_t>(addr) + size, mem.page_size);
+    if (end <= start)
+        return;
+
+    const InvalidateRange range{ start, static_cast<size_t>(end - start) };
+
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+    // Engines that can't drop the range are closed, the next thread gets a fresh one.
+    auto &idle = cache.idle_engines;
+    const auto flushed = [&range](uc_engine *uc) {
+        if (flush_translations(uc, range))
+            return true;
+
+        uc_close(uc);
+        return false;
+    };
+    idle.erase(std::stable_partition(idle.begin(), idle.end(), flushed), idle.end());
+
+    for (UnicornCPU *cpu : cache.active_cpus) {
+        cpu->pending_invalidations.push_back(range);
+        cpu->has_pending_invalidations = true;
+    }
+}
+
+static void enable_vfp_fpu(uc_engine *uc) {
+    uint64_t c1_c0_2 = 0;
+    uc_err err = uc_reg_read(uc, UC_ARM_REG_C1_C0_2, &c1_c0_2);
+    assert(err == UC_ERR_OK);
+
+    c1_c0_2 |= (0xf << 20);
+
+    err = uc_reg_write(uc, UC_ARM_REG_C1_C0_2, &c1_c0_2);
+    assert(err == UC_ERR_OK);
+
+    const uint64_t fpexc = 0xf0000000;
+
+    err = uc_reg_write(uc, UC_ARM_REG_FPEXC, &fpexc);
+    assert(err == UC_ERR_OK);
+}
+
+static uc_engine *open_engine(MemState &mem) {
+    uc_engine *uc = nullptr;
+    uc_err err = uc_open(UC_ARCH_ARM, UC_MODE_ARM, &uc);
+    assert(err == UC_ERR_OK);
+
+    // Don't map the null page into unicorn so that unicorn returns access error instead of
+    // crashing the whole emulator on invalid access
+    err = uc_mem_map_ptr(uc, mem.page_size, GB(4) - mem.page_size, UC_PROT_ALL, &mem.memory[mem.page_size]);
+    assert(err == UC_ERR_OK);
+
+    enable_vfp_fpu(uc);
+
+    return uc;
+}
+
+static uc_engine *acquire_engine(JITCache &cache, UnicornCPU &cpu) {
+    {
+        const std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.active_cpus.push_back(&cpu);
+        if (!cache.idle_engines.empty()) {
+            uc_engine *const uc = cache.idle_engines.back();
+            cache.idle_engines.pop_back();
+
+            // Wipe what the previous thread left behind, translated blocks are kept.
+            const uint32_t zero = 0;
+            for (int reg = UC_ARM_REG_R0; reg <= UC_ARM_REG_R12; ++reg)
+                uc_reg_write(uc, reg, &zero);
+            for (const int reg : { UC_ARM_REG_SP, UC_ARM_REG_LR, UC_ARM_REG_FPSCR, UC_ARM_REG_C13_C0_3 })
+                uc_reg_write(uc, reg, &zero);
+
+            // The Q registers alias pairs of D registers.
+            const uint64_t zero_d = 0;
+            for (int reg = UC_ARM_REG_D0; reg <= UC_ARM_REG_D31; ++reg)
+                uc_reg_write(uc, reg, &zero_d);
+
+            uc_reg_write(uc, UC_ARM_REG_CPSR, &cache.initial_cpsr);
+
+            return uc;
+        }
+    }
+
+    uc_engine *const uc = open_engine(*cache.mem);
+
+    const std::lock_guard<std::mutex> lock(cache.mutex);
+    uc_reg_read(uc, UC_ARM_REG_CPSR, &cache.initial_cpsr);
+
+    return uc;
+}
+
+UnicornCPU::UnicornCPU(CPUState *state, Address pc, Address sp, bool trace_stack, const JITCachePtr &jit_cache)
+    : parent(state)
+    , jit_cache(jit_cache) {
+    if (jit_cache)
+        engine = UnicornPtr(acquire_engine(*jit_cache, *this), uc_close);
+    else
+        engine = UnicornPtr(open_engine(*state->mem), uc_close);
+
+    uc_err err = uc_hook_add(engine.get(), &interrupt_hook, UC_HOOK_INTR, reinterpret_cast<void *>(&intr_hook), this, 1, 0);
+    assert(err == UC_ERR_OK);
+
+    err = uc_reg_write(engine.get(), UC_ARM_REG_SP, &sp);
+    assert(err == UC_ERR_OK);
+
+    err = uc_reg_write(engine.get(), UC_ARM_REG_PC, &pc);
+    assert(err == UC_ERR_OK);
+
+    err = uc_reg_write(engine.get(), UC_ARM_REG_LR, &pc);
+    assert(err == UC_ERR_OK);
+
+    if (trace_stack) {
+        err = uc_hook_add(engine.get(), &stack_hook, UC_HOOK_CODE, reinterpret_cast<void *>(&stack_trace_hook), this, 1, 0);
+        assert(err == UC_ERR_OK);
+    }
+}
+
+UnicornCPU::~UnicornCPU() {
+    if (!jit_cache)
+        return;
+
+    uc_engine *const uc = engine.release();
+
+    // Hooks point at this object, which is about to go away.
+    for (const uc_hook hook : { interrupt_hook, stack_hook, code_hook, memory_read_hook, memory_write_hook }) {
+        if (hook != 0)
+            uc_hook_del(uc, hook);
+    }
+
+    const std::lock_guard<std::mutex> lock(jit_cache->mutex);
+    for (const InvalidateRange &range : pending_invalidations)
+        stale_translations |= !flush_translations(uc, range);
+
+    auto &active = jit_cache->active_cpus;
+    active.erase(std::remove(active.begin(), active.end(), this), active.end());
+    if (stale_translations)
+        uc_close(uc);
+    else
+        jit_cache->idle_engines.push_back(uc);
+}
+
+void UnicornCPU::flush_pending_invalidations() {
+    if (!has_pending_invalidations)
+        return;
+
+    std::vector<InvalidateRange> ranges;
+    {
+        const std::lock_guard<std::mutex> lock(jit_cache->mutex);
+        ranges.swap(pending_invalidations);
+        has_pending_invalidations = false;
+    }
+
+    for (const InvalidateRange &range : ranges)
+        stale_translations |= !flush_translations(engine.get(), range);
+}
+
+void UnicornCPU::intr_hook(uc_engine *uc, uint32_t intno, void *user_data) {
+    assert(intno == INT_SVC || intno == INT_BKPT);
+    UnicornCPU &cpu = *static_cast<UnicornCPU *>(user_data);
+    cpu.flush_pending_invalidations();
+
+    const uint32_t pc = cpu.get_pc();
+    if (intno == INT_SVC) {
+        handle_svc(*cpu.parent, pc);
+    } else if (intno == INT_BKPT) {
+        handle_bkpt(*cpu.parent, pc);
+    }
+}
+
+void UnicornCPU::stack_trace_hook(uc_engine *uc, uint64_t address, uint32_t size, void *user_data) {
+    UnicornCPU &cpu = *static_cast<UnicornCPU *>(user_data);
+    CPUState &state = *cpu.parent;
+    if (cpu.is_thumb_mode()) {
+        uint16_t ins = 0;
+        uc_err err = uc_mem_read(uc, address, &ins, sizeof(ins));
+        assert(err == UC_ERR_OK);
+        if ((ins & 0xff00) == 0xB400 || (ins & 0xff00) == 0xB500 || ins == 0xE92D) {
+            state.stack_frames.push({ static_cast<uint32_t>(address), cpu.get_sp() });
+        }
+        if ((ins & 0xff00) == 0xBC00 || (ins & 0xff00) == 0xBD00 || ins == 0xE8BD) {
+            state.stack_frames.pop();
+        }
+    } else {
+        uint16_t ins = 0;
+        uc_err err = uc_mem_read(uc, address + 2, &ins, sizeof(ins));
+        assert(err == UC_ERR_OK);
+        if (ins == 0xE92D) {
+            state.stack_frames.push({ static_cast<uint32_t>(address), cpu.get_sp() });
+        }
+        if (ins == 0xE8BD) {
+            state.stack_frames.pop();
+        }
+    }
+}
+
+void UnicornCPU::code_log_hook(uc_engine *uc, uint64_t address, uint32_t size, void *user_data) {
+    UnicornCPU &cpu = *static_cast<UnicornCPU *>(user_data);
+    CPUState &state = *cpu.parent;
+    std::string disassembly = disassemble(state, address);
+    if (LOG_REGISTERS) {
+        for (int i = 0; i < 12; i++) {
+            auto reg_name = fmt::format("r{}", i);
+            auto reg_name_with_value = fmt::format("{}({})", reg_name, log_hex(cpu.get_reg(i)));
+            string_utils::replace(disassembly, reg_name, reg_name_with_value);
+        }
+
+        string_utils::replace(disassembly, "lr", fmt::format("lr({})", log_hex(cpu.get_lr())));
+        string_utils::replace(disassembly, "sp", fmt::format("sp({})", log_hex(cpu.get_sp())));
+    }
+
+    auto name = state.resolve_nid_name(address);
+    if (name != "") {
+        LOG_TRACE("{} ({}): {} {} entering export function {}", log_hex((uint64_t)uc), state.thread_id, log_hex(address), disassembly, name);
+    } else {
+        LOG_TRACE("{} ({}): {} {}", log_hex((uint64_t)uc), state.thread_id, log_hex(address), disassembly);
+    }
+
+    if (TRACE_RETURN_VALUES)
+        if (is_returning(state.disasm))
+            LOG_TRACE("Returning, r0: {}", log_hex(cpu.get_reg(0)));
+
+    log_stack_frames(state);
+}
+
+static void log_memory_access(uc_engine *uc, const char *type, Address address, int size, int64_t value, MemState &mem, CPUState &cpu, Address offset) {
+    const char *const name = mem_name(address, mem);
+    auto pc = read_pc(cpu);
+    LOG_TRACE("{} ({}): {} {} bytes, address {} + {} ({}, {}), value {} at {}", log_hex((uint64_t)uc), cpu.thread_id, type, size, log_hex(address), log_hex(offset), log_hex(address + offset), name, log_hex(value), log_hex(pc));
+}
+
+void UnicornCPU::read_hook(uc_engine *uc, uc_mem_type type, uint64_t address, int size, int64_t value, void *user_data) {
+    assert(value == 0);
+
+    CPUState &state = *static_cast<UnicornCPU *>(user_data)->parent;
+    MemState &mem = *state.mem;
+    auto start = state.get_watch_memory_addr(address);
+    if (start) {
+        memcpy(&value, Ptr<const void>(static_cast<Address>(address)).get(mem), size);
+        log_memory_access(uc, "Read", start, size, value, mem, state, address - start);
+    }
+}
+
+void UnicornCPU::write_hook(uc_engine *uc, uc_mem_type type, uint64_t address, int size, int64_t value, void *user_data) {
+    CPUState &state = *static_cast<UnicornCPU *>(user_data)->parent;
+    auto start = state.get_watch_memory_addr(address);
+    if (start) {
+        MemState &mem = *state.mem;
+        log_memory_access(uc, "Write", start, size, value, mem, state, address - start);
+    }
+}
+
+void UnicornCPU::log_error(uc_err code) {
+    // I don't especially want the time logged for every line, but I also want it to print to the log file...
+    LOG_ERROR("Unicorn error {}. {}", log_hex(code), uc_strerror(code));
+}
+
+int UnicornCPU::run(Address pc, Address until) {
+    flush_pending_invalidations();
+
+    const uc_err err = uc_emu_start(engine.get(), pc, until, 0, 0);
+    if (err != UC_ERR_OK) {
+        log_error(err);
+        return -1;
+    }
+
+    return 0;
+}
+
+int UnicornCPU::step(Address pc) {
+    flush_pending_invalidations();
+
+    const uc_err err = uc_emu_start(engine.get(), pc, 0, 0, 1);
+    if (err != UC_ERR_OK) {
+        log_error(err);
+        return -1;
+    }
+
+    return 0;
+}
+
+void UnicornCPU::stop() {
+    const uc_err err = uc_emu_stop(engine.get());
+    assert(err == UC_ERR_OK);
+}
+
+uint32_t UnicornCPU::get_reg(uint8_t idx) {
+    uint32_t value = 0;
+    const uc_err err = uc_reg_read(engine.get(), UC_ARM_REG_R0 + idx, &value);
+    assert(err == UC_ERR_OK);
+
+    return value;
+}
+
+void UnicornCPU::set_reg(uint8_t idx, uint32_t val) {
+    const uc_err err = uc_reg_write(engine.get(), UC_ARM_REG_R0 + idx, &val);
+    assert(err == UC_ERR_OK);
+}
+
+float UnicornCPU::get_float_reg(uint8_t idx) {
+    DoubleReg value;
+
+    const int single_index = idx / 2;
+    const uc_err err = uc_reg_read(engine.get(), UC_ARM_REG_D0 + single_index, &value);
+    assert(err == UC_ERR_OK);
+    return value.f[idx % 2];
+}
+
+void UnicornCPU::set_float_reg(uint8_t idx, float val) {
+    const uc_err err = uc_reg_write(engine.get(), UC_ARM_REG_R0 + idx, &val);
+    assert(err == UC_ERR_OK);
+}
+
+static uint32_t read_uc_reg(uc_engine *uc, int reg) {
+    uint32_t value = 0;
+    const uc_err err = uc_reg_read(uc, reg, &value);
+    assert(err == UC_ERR_OK);
+
+    return value;
+}
+
+static void write_uc_reg(uc_engine *uc, int reg, uint32_t value) {
+    const uc_err err = uc_reg_write(uc, reg, &value);
+    assert(err == UC_ERR_OK);
+}
+
+uint32_t UnicornCPU::get_sp() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_SP);
+}
+
+void UnicornCPU::set_sp(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_SP, val);
+}
+
+uint32_t UnicornCPU::get_pc() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_PC);
+}
+
+void UnicornCPU::set_pc(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_PC, val);
+}
+
+uint32_t UnicornCPU::get_lr() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_LR);
+}
+
+void UnicornCPU::set_lr(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_LR, val);
+}
+
+uint32_t UnicornCPU::get_cpsr() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_CPSR);
+}
+
+void UnicornCPU::set_cpsr(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_CPSR, val);
+}
+
+uint32_t UnicornCPU::get_fpscr() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_FPSCR);
+}
+
+void UnicornCPU::set_fpscr(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_FPSCR, val);
+}
+
+uint32_t UnicornCPU::get_tpidruro() {
+    return read_uc_reg(engine.get(), UC_ARM_REG_C13_C0_3);
+}
+
+void UnicornCPU::set_tpidruro(uint32_t val) {
+    write_uc_reg(engine.get(), UC_ARM_REG_C13_C0_3, val);
+}
+
+bool UnicornCPU::is_thumb_mode() {
+    size_t mode = 0;
+    const uc_err err = uc_query(engine.get(), UC_QUERY_MODE, &mode);
+    assert(err == UC_ERR_OK);
+
+    return mode & UC_MODE_THUMB;
+}
+
+void UnicornCPU::set_log_code(bool log) {
+    if (log == get_log_code())
+        return;
+
+    if (log) {
+        const uc_err err = uc_hook_add(engine.get(), &code_hook, UC_HOOK_CODE, reinterpret_cast<void *>(&code_log_hook), this, 1, 0);
+        assert(err == UC_ERR_OK);
+    } else {
+        const uc_err err = uc_hook_del(engine.get(), code_hook);
+        assert(err == UC_ERR_OK);
+        code_hook = 0;
+    }
+}
+
+void UnicornCPU::set_log_mem(bool log) {
+    if (log == get_log_mem())
+        return;
+
+    if (log) {
+        uc_err err = uc_hook_add(engine.get(), &memory_read_hook, UC_HOOK_MEM_READ, reinterpret_cast<void *>(&read_hook), this, 1, 0);
+        assert(err == UC_ERR_OK);
+
+        err = uc_hook_add(engine.get(), &memory_write_hook, UC_HOOK_MEM_WRITE, reinterpret_cast<void *>(&write_hook), this, 1, 0);
+        assert(err == UC_ERR_OK);
+    } else {
+        uc_err err = uc_hook_del(engine.get(), memory_read_hook);
+        assert(err == UC_ERR_OK);
+        memory_read_hook = 0;
+
+        err = uc_hook_del(engine.get(), memory_write_hook);
+        assert(err == UC_ERR_OK);
+        memory_write_hook = 0;
+    }
+}
+
+bool UnicornCPU::get_log_code() {
+    return code_hook != 0;
+}
+
+bool UnicornCPU::get_log_mem() {
+    return memory_read_hook != 0 && memory_write_hook != 0;
+}
@@ -9,6 +9,9 @@ struct FeatureState {
     bool hardware_flip = true; ///< Allow flipping in shader.
     bool use_ubo = false;
     bool use_shader_binding = false;
+    bool support_buffer_storage = false; ///< Draws read vertex, index and uniform data straight from persistently mapped staging memory.
+    bool support_multi_bind = false; ///< Texture units changed by a draw are bound in one call.
+    bool support_parallel_shader_compile = false; ///< Shader compiles and program links can be polled instead of waited for.
 
     bool is_programmable_blending_supported() const {
         return support_shader_interlock || support_texture_barrier || direct_fragcolor;
@@ -170,9 +170,10 @@ static std::string cmd_reply_empty(HostState &state, PacketCommand &command) {
 
 static SceUID select_thread(HostState &state, int thread_id) {
     if (thread_id == 0) {
-        if (state.kernel.threads.empty())
+        const ThreadStatePtrs::Snapshot threads = state.kernel.threads.snapshot();
+        if (threads.empty())
             return -1;
-        return state.kernel.threads.begin()->first;
+        return threads.begin()->first;
     }
     return thread_id;
 }
@@ -264,11 +265,11 @@ static void modify_reg(CPUState &state, uint32_t reg, uint32_t value) {
 }
 
 static std::string cmd_read_registers(HostState &state, PacketCommand &command) {
-    if (state.gdb.current_thread == -1
-        || state.kernel.threads.find(state.gdb.current_thread) == state.kernel.threads.end())
+    const ThreadStatePtr thread = state.kernel.threads.get(state.gdb.current_thread);
+    if (!thread)
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *thread->cpu.get();
 
     std::stringstream stream;
     for (uint32_t a = 0; a <= 15; a++) {
@@ -279,11 +280,11 @@ static std::string cmd_read_registers(HostState &state, PacketCommand &command)
 }
 
 static std::string cmd_write_registers(HostState &state, PacketCommand &command) {
-    if (state.gdb.current_thread == -1
-        || state.kernel.threads.find(state.gdb.current_thread) == state.kernel.threads.end())
+    const ThreadStatePtr thread = state.kernel.threads.get(state.gdb.current_thread);
+    if (!thread)
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *thread->cpu.get();
 
     const std::string content = content_string(command).substr(1);
 
@@ -296,11 +297,11 @@ static std::string cmd_write_registers(HostState &state, PacketCommand &command)
 }
 
 static std::string cmd_read_register(HostState &state, PacketCommand &command) {
-    if (state.gdb.current_thread == -1
-        || state.kernel.threads.find(state.gdb.current_thread) == state.kernel.threads.end())
+    const ThreadStatePtr thread = state.kernel.threads.get(state.gdb.current_thread);
+    if (!thread)
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *thread->cpu.get();
 
     const std::string content = content_string(command);
     int32_t reg = parse_hex(content.substr(1, content.size() - 1));
@@ -309,11 +310,11 @@ static std::string cmd_read_register(HostState &state, PacketCommand &command) {
 }
 
 static std::string cmd_write_register(HostState &state, PacketCommand &command) {
-    if (state.gdb.current_thread == -1
-        || state.kernel.threads.find(state.gdb.current_thread) == state.kernel.threads.end())
+    const ThreadStatePtr thread = state.kernel.threads.get(state.gdb.current_thread);
+    if (!thread)
         return "E00";
 
-    CPUState &cpu = *state.kernel.threads[state.gdb.current_thread]->cpu.get();
+    CPUState &cpu = *thread->cpu.get();
 
     const std::string content = content_string(command);
     uint32_t equal_index = content.find('=');
@@ -429,16 +430,14 @@ static std::string cmd_continue(HostState &state, PacketCommand &command) {
             if (colon != std::string::npos) {
                 const int32_t thread_id = parse_hex(text.substr(colon + 1));
 
-                if (state.kernel.threads.find(thread_id) == state.kernel.threads.end())
+                const ThreadStatePtr thread = state.kernel.threads.get(thread_id);
+                if (!thread)
                     return "E00";
 
-                ThreadStatePtr thread = state.kernel.threads[thread_id];
-                if (thread) {
-                    thread->to_do = step ? ThreadToDo::step : ThreadToDo::run;
-                    thread->something_to_do.notify_one();
-                }
+                thread->to_do = step ? ThreadToDo::step : ThreadToDo::run;
+                thread->something_to_do.notify_one();
             } else {
-                for (const auto &thread : state.kernel.threads) {
+                for (const auto &thread : state.kernel.threads.snapshot()) {
                     if (thread.second) {
                         thread.second->to_do = step ? ThreadToDo::step : ThreadToDo::run;
                         thread.second->something_to_do.notify_one();
@@ -451,7 +450,7 @@ static std::string cmd_continue(HostState &state, PacketCommand &command) {
             if (!step) {
                 bool hit_break = false;
                 while (!hit_break) {
-                    for (const auto &thread : state.kernel.threads) {
+                    for (const auto &thread : state.kernel.threads.snapshot()) {
                         if (thread.second->to_do == ThreadToDo::wait && hit_breakpoint(*thread.second->cpu)) {
                             hit_break = true;
                             break;
@@ -484,7 +483,7 @@ static std::string cmd_thread_alive(HostState &state, PacketCommand &command) {
     const int32_t thread_id = parse_hex(content.substr(1));
 
     // Assuming a thread is removed from the map when it closes or is killed.
-    if (state.kernel.threads.find(thread_id) != state.kernel.threads.end())
+    if (state.kernel.threads.get(thread_id))
         return "OK";
 
     return "E00";
@@ -511,10 +510,11 @@ static std::string cmd_list_threads(HostState &state, PacketCommand &command) {
 
     stream << "m";
 
+    const ThreadStatePtrs::Snapshot threads = state.kernel.threads.snapshot();
     uint32_t count = 0;
-    for (const auto &thread : state.kernel.threads) {
+    for (const auto &thread : threads) {
         stream << to_hex(static_cast<uint32_t>(thread.first));
-        if (count != state.kernel.threads.size() - 1)
+        if (count != threads.size() - 1)
             stream << ",";
         count++;
     }
@@ -538,6 +538,8 @@ static std::string cmd_add_breakpoint(HostState &state, PacketCommand &command)
     // kind is 2 if it's thumb mode
     // https://sourceware.org/gdb/current/onlinedocs/gdb/ARM-Breakpoint-Kinds.html#ARM-Breakpoint-Kinds
     add_breakpoint(state.mem, true, kind == 2, address, nullptr);
+    if (state.kernel.jit_cache)
+        invalidate_jit_cache(*state.kernel.jit_cache, address, 4);
 
     return "OK";
 }
@@ -553,6 +555,8 @@ static std::string cmd_remove_breakpoint(HostState &state, PacketCommand &comman
 
     LOG_GDB("GDB Server Removed Breakpoint at {} ({}, {}).", log_hex(address), type, kind);
     remove_breakpoint(state.mem, address);
+    if (state.kernel.jit_cache)
+        invalidate_jit_cache(*state.kernel.jit_cache, address, 4);
 
     return "OK";
 }
@@ -709,7 +713,7 @@ static void server_listen(HostState &state) {
         return;
     }
 
-    for (const auto &thread : state.kernel.threads) {
+    for (const auto &thread : state.kernel.threads.snapshot()) {
         stop(*thread.second->cpu);
         thread.second->to_do = ThreadToDo::wait;
     }
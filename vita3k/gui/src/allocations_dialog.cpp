@@ -33,6 +33,14 @@ void draw_allocations_dialog(GuiState &gui, HostState &host) {
     ImGui::Begin("Memory Allocations", &gui.debug_menu.allocations_dialog);
 
     const std::lock_guard<std::mutex> lock(host.mem.generation_mutex);
+    if (ImGui::TreeNode("Committed")) {
+        for (const auto &pair : host.mem.committed_bytes) {
+            if (pair.second != 0)
+                ImGui::Text("%s: %zu KB", pair.first.c_str(), pair.second / KB(1));
+        }
+        ImGui::TreePop();
+    }
+
     for (const auto &pair : host.mem.generation_names) {
         const auto generation_num = pair.first;
         const auto generation_name = pair.second;
@@ -28,7 +28,8 @@ namespace gui {
 static void evaluate_code(GuiState &gui, HostState &host, uint32_t from, uint32_t count, bool thumb) {
     gui.disassembly.clear();
 
-    if (host.kernel.threads.empty()) {
+    const ThreadStatePtrs::Snapshot threads = host.kernel.threads.snapshot();
+    if (threads.empty()) {
         gui.disassembly.emplace_back("Nothing to disassemble.");
         return;
     }
@@ -48,7 +49,7 @@ static void evaluate_code(GuiState &gui, HostState &host, uint32_t from, uint32_
 
         // Use DisasmState for first thread.
         std::string disasm = fmt::format("{:0>8X}: {}",
-            addr, disassemble(*host.kernel.threads.begin()->second->cpu.get(), addr, thumb, &size));
+            addr, disassemble(*threads.begin()->second->cpu.get(), addr, thumb, &size));
         gui.disassembly.emplace_back(disasm);
         addr += size;
     }
@@ -27,9 +27,7 @@ void draw_mutexes_dialog(GuiState &gui, HostState &host) {
     ImGui::Begin("Mutexes", &gui.debug_menu.mutexes_dialog);
     ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-16s %-32s   %-7s   %-8s   %-16s   %-16s", "ID", "Mutex Name", "Status", "Attributes", "Waiting Threads", "Owner");
 
-    const std::lock_guard<std::mutex> lock(host.kernel.mutex);
-
-    for (const auto &mutex : host.kernel.mutexes) {
+    for (const auto &mutex : host.kernel.mutexes.snapshot()) {
         std::shared_ptr<Mutex> mutex_state = mutex.second;
         ImGui::TextColored(GUI_COLOR_TEXT, "0x%08X       %-32s   %02d        %01d            %02zu                 %s",
             mutex.first,
@@ -46,16 +44,18 @@ void draw_lw_mutexes_dialog(GuiState &gui, HostState &host) {
     ImGui::Begin("Lightweight Mutexes", &gui.debug_menu.lwmutexes_dialog);
     ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-16s %-32s   %-7s   %-8s  %-16s   %-16s", "ID", "LwMutex Name", "Status", "Attributes", "Waiting Threads", "Owner");
 
-    const std::lock_guard<std::mutex> lock(host.kernel.mutex);
-    for (const auto &mutex : host.kernel.lwmutexes) {
+    for (const auto &mutex : host.kernel.lwmutexes.snapshot()) {
         std::shared_ptr<Mutex> mutex_state = mutex.second;
+        // Ownership of lightweight mutexes lives in the guest workarea.
+        const SceUID owner_id = mutex_state->workarea ? mutex_state->workarea->owner.load() : 0;
+        const ThreadStatePtr owner = owner_id ? host.kernel.threads.get(owner_id) : ThreadStatePtr();
         ImGui::TextColored(GUI_COLOR_TEXT, "0x%08X       %-32s   %02d        %01d           %02zu                 %s",
             mutex.first,
             mutex_state->name,
-            mutex_state->lock_count,
+            owner_id ? mutex_state->workarea->count : 0,
             mutex_state->attr,
             mutex_state->waiting_threads.size(),
-            mutex_state->owner == nullptr ? "not owned" : mutex_state->owner->name.c_str());
+            owner ? owner->name.c_str() : "not owned");
     }
     ImGui::End();
 }
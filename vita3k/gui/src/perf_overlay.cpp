@@ -20,6 +20,7 @@
 #include <host/state.h>
 #include <kernel/thread/thread_functions.h>
 #include <kernel/thread/thread_state.h>
+#include <renderer/gl/state.h>
 
 namespace gui {
 static const ImVec2 PERF_OVERLAY_POS = ImVec2(10.0f, 10.0f);
@@ -33,6 +34,10 @@ void draw_perf_overlay(GuiState &gui, HostState &host) {
 
     ImGui::Begin("##performance", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar);
     ImGui::Text("FPS: %d", host.fps);
+    if (host.renderer->current_backend == renderer::Backend::OpenGL) {
+        const renderer::gl::GLStateCounters &counters = static_cast<renderer::gl::GLState &>(*host.renderer).last_frame_state_counters;
+        ImGui::Text("GL state: %llu issued, %llu filtered", static_cast<unsigned long long>(counters.issued), static_cast<unsigned long long>(counters.filtered));
+    }
     ImGui::End();
 
     ImGui::PopStyleColor();
@@ -25,9 +25,7 @@ void draw_semaphores_dialog(GuiState &gui, HostState &host) {
     ImGui::Begin("Semaphores", &gui.debug_menu.semaphores_dialog);
     ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-16s %-32s   %-16s   %-16s", "ID", "Semaphore Name", "Status", "Locked Threads");
 
-    const std::lock_guard<std::mutex> lock(host.kernel.mutex);
-
-    for (const auto &semaphore : host.kernel.semaphores) {
+    for (const auto &semaphore : host.kernel.semaphores.snapshot()) {
         std::shared_ptr<Semaphore> sema_state = semaphore.second;
         ImGui::TextColored(GUI_COLOR_TEXT, "0x%08X       %-32s   %02d/%02d              %02zu",
             semaphore.first,
@@ -244,6 +244,9 @@ void draw_settings_dialog(GuiState &gui, HostState &host) {
         ImGui::Checkbox("Texture Cache", &host.cfg.texture_cache);
         if (ImGui::IsItemHovered())
             ImGui::SetTooltip("Uncheck the box to disable texture cache.");
+        ImGui::Checkbox("Program Cache", &host.cfg.program_binary_cache);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Uncheck the box to disable saving linked shader programs to disk.\nTakes effect on next application start.");
         ImGui::Separator();
         ImGui::TextColored(GUI_COLOR_TEXT_MENUBAR, "Emulated System Storage Folder");
         ImGui::Spacing();
@@ -27,7 +27,10 @@
 namespace gui {
 
 void draw_thread_details_dialog(GuiState &gui, HostState &host) {
-    ThreadStatePtr &thread = host.kernel.threads[gui.thread_watch_index];
+    const ThreadStatePtr thread = host.kernel.threads.get(gui.thread_watch_index);
+    if (!thread)
+        return;
+
     CPUState &cpu = *thread->cpu;
 
     ImGui::Begin("Thread Viewer", &gui.debug_menu.thread_details_dialog);
@@ -61,9 +64,7 @@ void draw_threads_dialog(GuiState &gui, HostState &host) {
     ImGui::TextColored(GUI_COLOR_TEXT_TITLE,
         "%-16s %-32s   %-16s   %-16s", "ID", "Thread Name", "Status", "Stack Pointer");
 
-    const std::lock_guard<std::mutex> lock(host.kernel.mutex);
-
-    for (const auto &thread : host.kernel.threads) {
+    for (const auto &thread : host.kernel.threads.snapshot()) {
         std::shared_ptr<ThreadState> th_state = thread.second;
         std::string run_state;
         switch (th_state->to_do) {
@@ -19,9 +19,7 @@
 
 #include <util/types.h>
 
-#include <functional>
-
 struct CPUState;
 struct HostState;
 
-using ImportFn = std::function<void(HostState &host, CPUState &cpu, SceUID thread_id)>;
+using ImportFn = void (*)(HostState &host, CPUState &cpu, SceUID thread_id);
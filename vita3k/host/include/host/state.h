@@ -26,6 +26,7 @@
 #include <host/window.h>
 #include <io/state.h>
 #include <kernel/state.h>
+#include <mem/heap.h>
 #include <net/state.h>
 #include <ngs/state.h>
 #include <nids/types.h>
@@ -77,6 +78,7 @@ struct HostState {
     SceFVector2 viewport_pos = { 0, 0 };
     SceFVector2 viewport_size = { 0, 0 };
     MemState mem;
+    HeapState heap;
     CtrlState ctrl;
     KernelState kernel;
     AudioState audio;
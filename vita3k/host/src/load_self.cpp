@@ -141,6 +141,26 @@ static uint32_t encode_arm_inst(uint8_t type, uint16_t immed, uint16_t reg) {
     }
 }
 
+static uint32_t get_import_slot(KernelState &kernel, uint32_t nid) {
+    const ImportSlotIndices::const_iterator found = kernel.import_slot_indices.find(nid);
+    if (found != kernel.import_slot_indices.end())
+        return found->second;
+
+    const uint32_t slot = kernel.import_slot_count.load(std::memory_order_relaxed);
+    if (slot == MAX_IMPORT_SLOTS)
+        return 0;
+
+    ImportSlot &import_slot = kernel.import_slots[slot];
+    import_slot.nid = nid;
+    import_slot.hle_index = import_index(nid);
+    kernel.import_slot_indices.emplace(nid, slot);
+
+    // Publish the slot only once it is filled in, call_svc range-checks against the count.
+    kernel.import_slot_count.store(slot + 1, std::memory_order_release);
+
+    return slot;
+}
+
 static bool load_func_imports(const uint32_t *nids, const Ptr<uint32_t> *entries, size_t count, KernelState &kernel, const MemState &mem, const Config &cfg) {
     for (size_t i = 0; i < count; ++i) {
         const uint32_t nid = nids[i];
@@ -169,7 +189,7 @@ static bool load_func_imports(const uint32_t *nids, const Ptr<uint32_t> *entries
         case None: {
             if (export_address == kernel.export_nids.end()) {
                 // TODO replace these into non-interrupt ones like below when the weak module is loaded
-                stub[0] = 0xef000000; // svc #0 - Call our interrupt hook.
+                stub[0] = 0xef000000 | get_import_slot(kernel, nid); // svc #slot - Call our interrupt hook.
                 stub[1] = 0xe1a0f00e; // mov pc, lr - Return to the caller.
                 stub[2] = nid; // Our interrupt hook will read this.
             } else {
@@ -261,9 +281,14 @@ static bool load_func_exports(Ptr<const void> &entry_point, const uint32_t *nids
         if (nid == NID_MODULE_STOP || nid == NID_MODULE_EXIT)
             continue;
 
-        kernel.export_nids.emplace(nid, entry.address());
+        const bool inserted = kernel.export_nids.emplace(nid, entry.address()).second;
         kernel.nid_from_export.emplace(entry.address(), nid);
 
+        // Modules loaded earlier may already import it through an svc stub
+        const ImportSlotIndices::const_iterator slot = kernel.import_slot_indices.find(nid);
+        if (inserted && slot != kernel.import_slot_indices.end())
+            kernel.import_slots[slot->second].export_pc.store(entry.address(), std::memory_order_release);
+
         if (cfg.log_exports) {
             const char *const name = import_name(nid);
 
@@ -426,6 +451,10 @@ SceUID load_self(Ptr<const void> &entry_point, KernelState &kernel, MemState &me
             if (DUMP_SEGMENTS)
                 dump_segment(seg_addr.get(mem));
 
+            // Pages may have held code of an unloaded module that is still translated
+            if (kernel.jit_cache && (seg_header.p_flags & PF_X))
+                invalidate_jit_cache(*kernel.jit_cache, segment_address, seg_header.p_memsz);
+
             segment_reloc_info[seg_index] = { segment_address, seg_header.p_vaddr, seg_header.p_memsz };
         } else if (seg_header.p_type == PT_LOOS) {
             if (seg_infos[seg_index].compression == 2) {
@@ -30,7 +30,6 @@
 #include <kernel/thread/thread_functions.h>
 #include <modules/module_parent.h>
 #include <touch/touch.h>
-#include <util/find.h>
 #include <util/log.h>
 #include <util/string_utils.h>
 
@@ -505,7 +504,7 @@ ExitCode run_app(HostState &host, Ptr<const void> &entry_point) {
         return InitThreadFailed;
     }
 
-    const ThreadStatePtr main_thread = util::find(main_thread_id, host.kernel.threads);
+    const ThreadStatePtr main_thread = host.kernel.threads.get(main_thread_id);
 
     // Run `module_start` export (entry point) of loaded libraries
     for (auto &mod : host.kernel.loaded_modules) {
@@ -522,7 +521,7 @@ ExitCode run_app(HostState &host, Ptr<const void> &entry_point) {
         auto inject = create_cpu_dep_inject(host);
         const SceUID module_thread_id = create_thread(module_start, host.kernel, host.mem, module_name, SCE_KERNEL_DEFAULT_PRIORITY_USER, static_cast<int>(SCE_KERNEL_STACK_SIZE_USER_DEFAULT),
             inject, nullptr);
-        const ThreadStatePtr module_thread = util::find(module_thread_id, host.kernel.threads);
+        const ThreadStatePtr module_thread = host.kernel.threads.get(module_thread_id);
         const auto ret = run_on_current(*module_thread, module_start, 0, argp);
         module_thread->to_do = ThreadToDo::exit;
         module_thread->something_to_do.notify_all(); // TODO Should this be notify_one()?
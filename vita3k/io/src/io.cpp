@@ -23,6 +23,7 @@
 #include <io/util.h>
 #include <io/vfs.h>
 
+#include <mem/mem.h>
 #include <rtc/rtc.h>
 #include <util/log.h>
 #include <util/preprocessor.h>
@@ -270,6 +271,7 @@ int read_file(void *data, IOState &io, const SceUID fd, const SceSize size, cons
 
     const auto file = io.std_files.find(fd);
     if (file != io.std_files.end()) {
+        prepare_host_write(data, size);
         const auto read = file->second.read(data, 1, size);
         LOG_TRACE("{}: Reading {} bytes of fd {}", export_name, read, log_hex(fd));
         return static_cast<int>(read);
@@ -0,0 +1,113 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <util/types.h>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Kernel objects keyed by UID. The table is split into shards with a lock each, so lookups from
+// different guest threads rarely contend and never wait on the global kernel mutex.
+template <typename T>
+class KernelObjects {
+public:
+    typedef std::shared_ptr<T> ObjectPtr;
+    // Ordered copy of the table, for code that walks every object.
+    typedef std::map<SceUID, ObjectPtr> Snapshot;
+
+    // Returns an empty pointer if there is no object with this UID.
+    ObjectPtr get(SceUID uid) const {
+        const Shard &shard = shard_of(uid);
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.objects.find(uid);
+        return (it != shard.objects.end()) ? it->second : ObjectPtr();
+    }
+
+    // Returns false if the UID is already taken.
+    bool emplace(SceUID uid, ObjectPtr object) {
+        Shard &shard = shard_of(uid);
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.objects.emplace(uid, std::move(object)).second)
+            return false;
+
+        ++count;
+        return true;
+    }
+
+    // Removes the object and returns it, or an empty pointer if there is none. Of several
+    // threads taking the same UID only one gets the object. It is released outside the shard lock.
+    ObjectPtr take(SceUID uid) {
+        Shard &shard = shard_of(uid);
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.objects.find(uid);
+        if (it == shard.objects.end())
+            return ObjectPtr();
+
+        ObjectPtr object = std::move(it->second);
+        shard.objects.erase(it);
+        --count;
+        return object;
+    }
+
+    bool erase(SceUID uid) {
+        return static_cast<bool>(take(uid));
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    Snapshot snapshot() const {
+        Snapshot result;
+        for (const Shard &shard : shards) {
+            const std::lock_guard<std::mutex> lock(shard.mutex);
+            result.insert(shard.objects.begin(), shard.objects.end());
+        }
+
+        return result;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    // Aligned so that neighbouring shard locks do not share a cache line.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<SceUID, ObjectPtr> objects;
+    };
+
+    Shard &shard_of(SceUID uid) {
+        return shards[static_cast<uint32_t>(uid) % SHARD_COUNT];
+    }
+
+    const Shard &shard_of(SceUID uid) const {
+        return shards[static_cast<uint32_t>(uid) % SHARD_COUNT];
+    }
+
+    std::array<Shard, SHARD_COUNT> shards;
+    std::atomic<size_t> count{ 0 };
+};
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cpu/functions.h>
+#include <kernel/object_table.h>
 #include <kernel/thread/thread_state.h>
 #include <kernel/types.h>
 #include <mem/ptr.h>
@@ -27,8 +28,10 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 struct ThreadState;
@@ -49,7 +52,7 @@ typedef std::map<SceUID, CodecEngineBlock> CodecEngineBlocks;
 typedef std::map<SceUID, Ptr<Ptr<void>>> SlotToAddress;
 typedef std::map<SceUID, SlotToAddress> ThreadToSlotToAddress;
 typedef std::shared_ptr<ThreadState> ThreadStatePtr;
-typedef std::map<SceUID, ThreadStatePtr> ThreadStatePtrs;
+typedef KernelObjects<ThreadState> ThreadStatePtrs;
 typedef std::shared_ptr<SDL_Thread> ThreadPtr;
 typedef std::map<SceUID, ThreadPtr> ThreadPtrs;
 typedef std::shared_ptr<SceKernelModuleInfo> SceKernelModuleInfoPtr;
@@ -60,6 +63,18 @@ typedef std::map<Address, uint32_t> NotFoundVars;
 typedef std::map<Address, WatchMemory> WatchMemoryAddrs;
 typedef std::vector<ModuleRegion> ModuleRegions;
 
+struct ImportSlot {
+    uint32_t nid = 0;
+    int32_t hle_index = -1; // import_index() of the NID, -1 if there is no HLE function for it
+    std::atomic<Address> export_pc{ 0 }; // Set when a module loaded later exports the NID, calls then go LLE
+};
+
+// Slot numbers are encoded as the svc immediate of import stubs. Slot 0 means the NID follows the svc.
+constexpr size_t MAX_IMPORT_SLOTS = 0x10000;
+// Allocated once, guest threads index it without a lock while modules are being loaded.
+typedef std::unique_ptr<ImportSlot[]> ImportSlots;
+typedef std::unordered_map<uint32_t, uint32_t> ImportSlotIndices;
+
 struct WaitingThreadData {
     ThreadStatePtr thread;
     int32_t priority;
@@ -116,7 +131,7 @@ public:
 };
 
 // NOTE: uid is copied to sync primitives here for debugging,
-//       not really needed since they are put in std::map's
+//       not really needed since they are kept in KernelObjects tables
 struct SyncPrimitive {
     SceUID uid;
 
@@ -134,22 +149,24 @@ struct Semaphore : SyncPrimitive {
 };
 
 typedef std::shared_ptr<Semaphore> SemaphorePtr;
-typedef std::map<SceUID, SemaphorePtr> SemaphorePtrs;
+typedef KernelObjects<Semaphore> SemaphorePtrs;
 
 struct Mutex : SyncPrimitive {
     int lock_count;
     ThreadStatePtr owner;
+    // Lightweight mutexes keep owner and count in the guest workarea instead.
+    SceKernelLwMutexWork *workarea = nullptr;
 };
 
 typedef std::shared_ptr<Mutex> MutexPtr;
-typedef std::map<SceUID, MutexPtr> MutexPtrs;
+typedef KernelObjects<Mutex> MutexPtrs;
 
 struct EventFlag : SyncPrimitive {
     int flags;
 };
 
 typedef std::shared_ptr<EventFlag> EventFlagPtr;
-typedef std::map<SceUID, EventFlagPtr> EventFlagPtrs;
+typedef KernelObjects<EventFlag> EventFlagPtrs;
 
 struct Condvar : SyncPrimitive {
     struct SignalTarget {
@@ -172,7 +189,7 @@ struct Condvar : SyncPrimitive {
     MutexPtr associated_mutex;
 };
 typedef std::shared_ptr<Condvar> CondvarPtr;
-typedef std::map<SceUID, CondvarPtr> CondvarPtrs;
+typedef KernelObjects<Condvar> CondvarPtrs;
 
 struct WaitingThreadState {
     std::string name; // for debugging
@@ -285,9 +302,14 @@ struct KernelState {
     LoadedSysmodules loaded_sysmodules;
     ExportNids export_nids;
     NidFromExport nid_from_export;
+    ImportSlots import_slots = std::make_unique<ImportSlot[]>(MAX_IMPORT_SLOTS);
+    std::atomic<uint32_t> import_slot_count{ 1 }; // Slots below it are filled in.
+    ImportSlotIndices import_slot_indices;
     NotFoundVars not_found_vars;
     WatchMemoryAddrs watch_memory_addrs;
     ModuleRegions module_regions;
+    JITCachePtr jit_cache;
+    CPUBackend cpu_backend = CPUBackend::Unicorn;
 
     InitialFibers initial_fibers;
     SceRtcTick start_tick;
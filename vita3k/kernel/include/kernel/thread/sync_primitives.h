@@ -31,6 +31,12 @@ int mutex_try_lock(KernelState &kernel, const char *export_name, SceUID thread_i
 int mutex_unlock(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID mutexid, int unlock_count, SyncWeight weight);
 int mutex_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID mutexid, SyncWeight weight);
 
+// Lightweight Mutex
+SceUID lwmutex_create(KernelState &kernel, const char *export_name, const char *name, SceUID thread_id, SceKernelLwMutexWork &workarea, SceUInt attr, int init_count);
+int lwmutex_lock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int lock_count, unsigned int *timeout);
+int lwmutex_try_lock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int lock_count);
+int lwmutex_unlock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int unlock_count);
+
 // Semaphore
 SceUID semaphore_create(KernelState &kernel, const char *export_name, const char *name, SceUID thread_id, SceUInt attr, int initVal, int maxVal);
 int semaphore_wait(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID semaid, SceInt32 signal, SceUInt *timeout);
@@ -530,11 +530,16 @@ struct SceKernelLMOption {
     SceSize size;
 };
 
-// We only use workarea for uid
+// Besides the uid, the workarea holds the owner and count so that uncontended lock and unlock
+// never enter the kernel.
 struct SceKernelLwMutexWork {
     SceUID uid;
+    std::atomic<SceUID> owner; // Owning thread id, 0 if not owned.
+    std::int32_t count; // Only touched by the owner.
+    std::atomic<std::int32_t> waiters; // Threads waiting in the kernel.
+    SceUInt attr;
 
-    std::uint8_t padding[28];
+    std::uint8_t padding[12];
 };
 
 // We only use workarea for uid
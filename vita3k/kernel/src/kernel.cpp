@@ -26,7 +26,6 @@
 
 #include <spdlog/fmt/fmt.h>
 
-#include <util/find.h>
 #include <util/log.h>
 
 Ptr<Ptr<void>> get_thread_tls_addr(KernelState &kernel, MemState &mem, SceUID thread_id, int key) {
@@ -37,7 +36,7 @@ Ptr<Ptr<void>> get_thread_tls_addr(KernelState &kernel, MemState &mem, SceUID th
         return existing->second;
     }
 
-    const ThreadStatePtr thread = util::find(thread_id, kernel.threads);
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
 
     Address tls = read_tpidruro(*thread->cpu) - 0x800 + key * 4;
 
@@ -60,14 +59,13 @@ Ptr<Ptr<void>> get_thread_tls_addr(KernelState &kernel, MemState &mem, SceUID th
 }
 
 void stop_all_threads(KernelState &kernel) {
-    const std::lock_guard<std::mutex> lock(kernel.mutex);
-    for (ThreadStatePtrs::iterator thread = kernel.threads.begin(); thread != kernel.threads.end(); ++thread) {
+    for (const auto &thread : kernel.threads.snapshot()) {
         {
-            const std::lock_guard<std::mutex> lock2(thread->second->mutex);
-            thread->second->to_do = ThreadToDo::exit;
+            const std::lock_guard<std::mutex> lock(thread.second->mutex);
+            thread.second->to_do = ThreadToDo::exit;
         }
-        thread->second->something_to_do.notify_all();
-        stop(*thread->second->cpu);
+        thread.second->something_to_do.notify_all();
+        stop(*thread.second->cpu);
     }
 }
 
@@ -90,7 +88,7 @@ Address get_watch_memory_addr(KernelState &state, Address addr) {
 }
 
 void update_watches(KernelState &state) {
-    for (const auto &thread : state.threads) {
+    for (const auto &thread : state.threads.snapshot()) {
         auto &cpu = *thread.second->cpu;
         if (state.watch_code != log_code_exists(cpu)) {
             if (state.watch_code)
@@ -20,7 +20,6 @@
 #include <cpu/functions.h>
 #include <kernel/state.h>
 #include <kernel/types.h>
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
 static constexpr bool LOG_SYNC_PRIMITIVES = false;
@@ -51,7 +50,7 @@ inline CondvarPtrs &get_condvars(KernelState &kernel, SyncWeight weight) {
 
 inline int find_mutex(MutexPtr &mutex_out, MutexPtrs **mutexes_out, KernelState &kernel, const char *export_name, SceUID mutexid, SyncWeight weight) {
     MutexPtrs &mutexes = get_mutexes(kernel, weight);
-    mutex_out = lock_and_find(mutexid, mutexes, kernel.mutex);
+    mutex_out = mutexes.get(mutexid);
     if (!mutex_out) {
         return unknown_mutex_id(export_name, weight);
     }
@@ -64,7 +63,7 @@ inline int find_mutex(MutexPtr &mutex_out, MutexPtrs **mutexes_out, KernelState
 
 inline int find_condvar(CondvarPtr &condvar_out, CondvarPtrs **condvars_out, KernelState &kernel, const char *export_name, SceUID condid, SyncWeight weight) {
     CondvarPtrs &condvars = get_condvars(kernel, weight);
-    condvar_out = lock_and_find(condid, condvars, kernel.mutex);
+    condvar_out = condvars.get(condid);
     if (!condvar_out) {
         return unknown_cond_id(export_name, weight);
     }
@@ -86,9 +85,18 @@ inline int handle_timeout(const ThreadStatePtr &thread, std::unique_lock<std::mu
         if (!status) {
             *timeout = 0; // Time run out, so remaining time is 0
 
-            thread->to_do = ThreadToDo::run;
-
+            // Wakers lock the primitive before the thread, take them in the same order.
+            thread_lock.unlock();
             primitive_lock.lock();
+            thread_lock.lock();
+
+            // Woken up after the timeout, but before the primitive was locked.
+            if (thread->to_do == ThreadToDo::run) {
+                primitive_lock.unlock();
+                return SCE_KERNEL_OK;
+            }
+
+            thread->to_do = ThreadToDo::run;
             primitive.waiting_threads.remove(data);
 
             return RET_ERROR(SCE_KERNEL_ERROR_WAIT_TIMEOUT);
@@ -123,11 +131,10 @@ SceUID mutex_create(SceUID *uid_out, KernelState &kernel, const char *export_nam
     mutex->attr = attr;
     mutex->owner = nullptr;
     if (init_count > 0) {
-        const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+        const ThreadStatePtr thread = kernel.threads.get(thread_id);
         mutex->owner = thread;
     }
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
     auto &mutexes = get_mutexes(kernel, weight);
     mutexes.emplace(uid, mutex);
 
@@ -143,6 +150,120 @@ SceUID mutex_create(SceUID *uid_out, KernelState &kernel, const char *export_nam
     return SCE_KERNEL_OK;
 }
 
+// Lightweight mutexes keep their owner and count in the guest workarea. Locking when nobody owns the
+// mutex and nobody waits is a single compare-and-swap, and unlocking only enters the kernel when a
+// thread is queued. The kernel Mutex then only serves as the wait queue.
+inline bool lwmutex_try_acquire(SceKernelLwMutexWork &workarea, SceUID thread_id, int lock_count) {
+    SceUID expected = 0;
+    if (!workarea.owner.compare_exchange_strong(expected, thread_id))
+        return false;
+
+    workarea.count = lock_count;
+    return true;
+}
+
+// Only the owner itself can store its own id in the workarea, so this needs no lock.
+inline bool lwmutex_relock(SceKernelLwMutexWork &workarea, const char *export_name, SceUID thread_id, int lock_count, int &result) {
+    if (workarea.owner.load() != thread_id)
+        return false;
+
+    if (workarea.attr & SCE_KERNEL_MUTEX_ATTR_RECURSIVE) {
+        workarea.count += lock_count;
+        result = SCE_KERNEL_OK;
+    } else {
+        result = RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_RECURSIVE);
+    }
+
+    return true;
+}
+
+static int lwmutex_lock_slow(KernelState &kernel, const char *export_name, SceUID thread_id, int lock_count, Mutex &mutex, SceUInt *timeout, bool only_try) {
+    SceKernelLwMutexWork &workarea = *mutex.workarea;
+
+    int result = SCE_KERNEL_OK;
+    if (lwmutex_relock(workarea, export_name, thread_id, lock_count, result))
+        return result;
+
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
+
+    std::unique_lock<std::mutex> mutex_lock(mutex.mutex);
+
+    // Count ourselves as a waiter before the last attempt. An owner releasing concurrently either
+    // sees the waiter and hands the mutex over, or the attempt sees the mutex released.
+    ++workarea.waiters;
+    if (lwmutex_try_acquire(workarea, thread_id, lock_count)) {
+        --workarea.waiters;
+        return SCE_KERNEL_OK;
+    }
+
+    if (only_try) {
+        --workarea.waiters;
+        return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN);
+    }
+
+    // Sleep thread!
+    std::unique_lock<std::mutex> thread_lock(thread->mutex);
+    assert(thread->to_do == ThreadToDo::run);
+    thread->to_do = ThreadToDo::wait;
+
+    WaitingThreadData data;
+    data.thread = thread;
+    data.lock_count = lock_count;
+    data.priority = (mutex.attr & SCE_KERNEL_ATTR_TH_FIFO) ? 0 : thread->priority;
+
+    mutex.waiting_threads.emplace(data);
+    mutex_lock.unlock();
+
+    // Timing out leaves the mutex locked, so nothing can be handed over to us past this point.
+    result = handle_timeout(thread, thread_lock, mutex_lock, mutex, data, export_name, timeout);
+    if (result != SCE_KERNEL_OK)
+        --workarea.waiters;
+
+    return result;
+}
+
+// Hand a released mutex over to the first waiting thread.
+static void lwmutex_wake(Mutex &mutex) {
+    SceKernelLwMutexWork &workarea = *mutex.workarea;
+
+    const std::lock_guard<std::mutex> mutex_lock(mutex.mutex);
+    if (mutex.waiting_threads.empty())
+        return;
+
+    // Someone else took it in between, it will hand it over when it unlocks.
+    const auto waiting_thread_data = mutex.waiting_threads.top();
+    const auto waiting_thread = waiting_thread_data.thread;
+    if (!lwmutex_try_acquire(workarea, get_thread_id(*waiting_thread->cpu), waiting_thread_data.lock_count))
+        return;
+
+    --workarea.waiters;
+    mutex.waiting_threads.pop();
+
+    const std::lock_guard<std::mutex> waiting_thread_lock(waiting_thread->mutex);
+    assert(waiting_thread->to_do == ThreadToDo::wait);
+    waiting_thread->to_do = ThreadToDo::run;
+    waiting_thread->something_to_do.notify_one();
+}
+
+// Returns true if the mutex was released and a waiter has to be woken.
+inline bool lwmutex_release(SceKernelLwMutexWork &workarea, const char *export_name, SceUID thread_id, int unlock_count, int &result) {
+    result = SCE_KERNEL_OK;
+    if (workarea.owner.load() != thread_id)
+        return false;
+
+    if (unlock_count > workarea.count) {
+        result = RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_UNLOCK_UDF);
+        return false;
+    }
+
+    workarea.count -= unlock_count;
+    if (workarea.count > 0)
+        return false;
+
+    workarea.owner.store(0);
+    return workarea.waiters.load() != 0;
+}
+
 inline int mutex_lock_impl(KernelState &kernel, const char *export_name, SceUID thread_id, int lock_count, MutexPtr &mutex, SyncWeight weight, SceUInt *timeout, bool only_try) {
     if (LOG_SYNC_PRIMITIVES) {
         LOG_DEBUG("{}: uid: {} thread_id: {} name: \"{}\" attr: {} lock_count: {} timeout: {} waiting_threads: {}",
@@ -150,7 +271,10 @@ inline int mutex_lock_impl(KernelState &kernel, const char *export_name, SceUID
             mutex->waiting_threads.size());
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    if (mutex->workarea)
+        return lwmutex_lock_slow(kernel, export_name, thread_id, lock_count, *mutex, timeout, only_try);
+
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
 
     std::unique_lock<std::mutex> mutex_lock(mutex->mutex);
 
@@ -225,7 +349,15 @@ int mutex_try_lock(KernelState &kernel, const char *export_name, SceUID thread_i
 }
 
 inline int mutex_unlock_impl(KernelState &kernel, const char *export_name, SceUID thread_id, int unlock_count, MutexPtr &mutex) {
-    const ThreadStatePtr current_thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    if (mutex->workarea) {
+        int result = SCE_KERNEL_OK;
+        if (lwmutex_release(*mutex->workarea, export_name, thread_id, unlock_count, result))
+            lwmutex_wake(*mutex);
+
+        return result;
+    }
+
+    const ThreadStatePtr current_thread = kernel.threads.get(thread_id);
 
     const std::lock_guard<std::mutex> mutex_lock(mutex->mutex);
 
@@ -293,7 +425,9 @@ int mutex_delete(KernelState &kernel, const char *export_name, SceUID thread_id,
 
     if (mutex->waiting_threads.empty()) {
         const std::lock_guard<std::mutex> mutex_lock(mutex->mutex);
-        mutexes->erase(mutexid);
+        // Another thread may have deleted it since the lookup.
+        if (!mutexes->take(mutexid))
+            return unknown_mutex_id(export_name, weight);
     } else {
         // TODO:
         LOG_WARN("Can't delete sync object, it has waiting threads.");
@@ -302,6 +436,68 @@ int mutex_delete(KernelState &kernel, const char *export_name, SceUID thread_id,
     return SCE_KERNEL_OK;
 }
 
+// *********************
+// * Lightweight Mutex *
+// *********************
+
+SceUID lwmutex_create(KernelState &kernel, const char *export_name, const char *name, SceUID thread_id, SceKernelLwMutexWork &workarea, SceUInt attr, int init_count) {
+    SceUID uid = 0;
+    if (auto error = mutex_create(&uid, kernel, export_name, name, thread_id, attr, init_count, SyncWeight::Light))
+        return error;
+
+    MutexPtr mutex;
+    if (auto error = find_mutex(mutex, nullptr, kernel, export_name, uid, SyncWeight::Light))
+        return error;
+
+    // Only touch the guest workarea once the mutex exists.
+    workarea.owner = (init_count > 0) ? thread_id : 0;
+    workarea.count = init_count;
+    workarea.waiters = 0;
+    workarea.attr = attr;
+    workarea.uid = uid;
+
+    const std::lock_guard<std::mutex> mutex_lock(mutex->mutex);
+    mutex->workarea = &workarea;
+
+    return SCE_KERNEL_OK;
+}
+
+int lwmutex_lock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int lock_count, unsigned int *timeout) {
+    if ((workarea.waiters.load() == 0) && lwmutex_try_acquire(workarea, thread_id, lock_count))
+        return SCE_KERNEL_OK;
+
+    int result = SCE_KERNEL_OK;
+    if (lwmutex_relock(workarea, export_name, thread_id, lock_count, result))
+        return result;
+
+    return mutex_lock(kernel, export_name, thread_id, workarea.uid, lock_count, timeout, SyncWeight::Light);
+}
+
+int lwmutex_try_lock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int lock_count) {
+    if (lwmutex_try_acquire(workarea, thread_id, lock_count))
+        return SCE_KERNEL_OK;
+
+    int result = SCE_KERNEL_OK;
+    if (lwmutex_relock(workarea, export_name, thread_id, lock_count, result))
+        return result;
+
+    return RET_ERROR(SCE_KERNEL_ERROR_LW_MUTEX_FAILED_TO_OWN);
+}
+
+int lwmutex_unlock(KernelState &kernel, const char *export_name, SceUID thread_id, SceKernelLwMutexWork &workarea, int unlock_count) {
+    int result = SCE_KERNEL_OK;
+    if (!lwmutex_release(workarea, export_name, thread_id, unlock_count, result))
+        return result;
+
+    MutexPtr mutex;
+    if (auto error = find_mutex(mutex, nullptr, kernel, export_name, workarea.uid, SyncWeight::Light))
+        return error;
+
+    lwmutex_wake(*mutex);
+
+    return SCE_KERNEL_OK;
+}
+
 // **************
 // * Sempaphore *
 // **************
@@ -324,7 +520,6 @@ SceUID semaphore_create(KernelState &kernel, const char *export_name, const char
             export_name, uid, thread_id, name, attr, init_val, max_val);
     }
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
     kernel.semaphores.emplace(uid, semaphore);
 
     return uid;
@@ -335,7 +530,7 @@ int semaphore_wait(KernelState &kernel, const char *export_name, SceUID thread_i
     assert(signal == 1);
 
     // TODO Don't lock twice.
-    const SemaphorePtr semaphore = lock_and_find(semaid, kernel.semaphores, kernel.mutex);
+    const SemaphorePtr semaphore = kernel.semaphores.get(semaid);
     if (!semaphore) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     }
@@ -346,7 +541,7 @@ int semaphore_wait(KernelState &kernel, const char *export_name, SceUID thread_i
             timeout ? *timeout : 0, semaphore->waiting_threads.size());
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
 
     std::unique_lock<std::mutex> semaphore_lock(semaphore->mutex);
 
@@ -377,7 +572,7 @@ int semaphore_signal(KernelState &kernel, const char *export_name, SceUID thread
     assert(semaid >= 0);
 
     // TODO Don't lock twice.
-    const SemaphorePtr semaphore = lock_and_find(semaid, kernel.semaphores, kernel.mutex);
+    const SemaphorePtr semaphore = kernel.semaphores.get(semaid);
     if (!semaphore) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     }
@@ -419,8 +614,7 @@ int semaphore_signal(KernelState &kernel, const char *export_name, SceUID thread
 int semaphore_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID semaid) {
     assert(semaid >= 0);
 
-    // TODO: Don't lock twice
-    const SemaphorePtr semaphore = lock_and_find(semaid, kernel.semaphores, kernel.mutex);
+    const SemaphorePtr semaphore = kernel.semaphores.get(semaid);
     if (!semaphore) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     }
@@ -433,7 +627,8 @@ int semaphore_delete(KernelState &kernel, const char *export_name, SceUID thread
 
     if (semaphore->waiting_threads.empty()) {
         const std::lock_guard<std::mutex> semaphore_lock(semaphore->mutex);
-        kernel.semaphores.erase(semaid);
+        if (!kernel.semaphores.take(semaid))
+            return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     } else {
         // TODO:
         LOG_WARN("Can't delete sync object, it has waiting threads.");
@@ -466,7 +661,6 @@ SceUID condvar_create(SceUID *uid_out, KernelState &kernel, const char *export_n
     condvar->associated_mutex = std::move(assoc_mutex);
     std::copy(name, name + KERNELOBJECT_MAX_NAME_LENGTH, condvar->name);
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
     auto &condvars = get_condvars(kernel, weight);
     condvars.emplace(uid, condvar);
 
@@ -489,7 +683,7 @@ int condvar_wait(KernelState &kernel, const char *export_name, SceUID thread_id,
             timeout ? *timeout : 0, condvar->waiting_threads.size());
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
 
     std::unique_lock<std::mutex> condition_variable_lock(condvar->mutex);
 
@@ -535,7 +729,7 @@ int condvar_signal(KernelState &kernel, const char *export_name, SceUID thread_i
 
     WaitingThreadData waiting_thread_data;
     if (target_type == Condvar::SignalTarget::Type::Specific) {
-        ThreadStatePtr waiting_thread = lock_and_find(signal_target.thread_id, kernel.threads, kernel.mutex);
+        ThreadStatePtr waiting_thread = kernel.threads.get(signal_target.thread_id);
 
         const std::lock_guard<std::mutex> condvar_lock(condvar->mutex);
 
@@ -605,7 +799,8 @@ int condvar_delete(KernelState &kernel, const char *export_name, SceUID thread_i
 
     if (condvar->waiting_threads.empty()) {
         const std::lock_guard<std::mutex> condvar_lock(condvar->mutex);
-        condvars->erase(condid);
+        if (!condvars->take(condid))
+            return unknown_cond_id(export_name, weight);
     } else {
         // TODO:
         LOG_WARN("Can't delete sync object, it has waiting threads.");
@@ -636,7 +831,6 @@ SceUID eventflag_create(KernelState &kernel, const char *export_name, const char
     std::copy(event_name, event_name + KERNELOBJECT_MAX_NAME_LENGTH, event->name);
     event->attr = attr;
 
-    const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
     kernel.eventflags.emplace(uid, event);
 
     return uid;
@@ -646,7 +840,7 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
     assert(event_id >= 0);
 
     // TODO Don't lock twice.
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = kernel.eventflags.get(event_id);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     }
@@ -658,7 +852,7 @@ static int eventflag_waitorpoll(KernelState &kernel, const char *export_name, Sc
             event->waiting_threads.size());
     }
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    const ThreadStatePtr thread = kernel.threads.get(thread_id);
 
     std::unique_lock<std::mutex> event_lock(event->mutex);
 
@@ -715,7 +909,7 @@ int eventflag_set(KernelState &kernel, const char *export_name, SceUID thread_id
     assert(event_id >= 0);
 
     // TODO Don't lock twice.
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = kernel.eventflags.get(event_id);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -770,7 +964,7 @@ int eventflag_set(KernelState &kernel, const char *export_name, SceUID thread_id
 int eventflag_delete(KernelState &kernel, const char *export_name, SceUID thread_id, SceUID event_id) {
     assert(event_id >= 0);
 
-    const EventFlagPtr event = lock_and_find(event_id, kernel.eventflags, kernel.mutex);
+    const EventFlagPtr event = kernel.eventflags.get(event_id);
     if (!event) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     }
@@ -783,8 +977,8 @@ int eventflag_delete(KernelState &kernel, const char *export_name, SceUID thread
     const std::lock_guard<std::mutex> event_lock(event->mutex);
 
     if (event->waiting_threads.empty()) {
-        const std::lock_guard<std::mutex> kernel_lock(kernel.mutex);
-        kernel.eventflags.erase(event_id);
+        if (!kernel.eventflags.take(event_id))
+            return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_EVF_ID);
     } else {
         // TODO:
         LOG_WARN("Can't delete sync object, it has waiting threads.");
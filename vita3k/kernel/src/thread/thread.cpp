@@ -23,8 +23,6 @@
 #include <kernel/functions.h>
 
 #include <cpu/functions.h>
-#include <util/find.h>
-#include <util/lock_and_find.h>
 #include <util/resource.h>
 
 #include <SDL_thread.h>
@@ -47,7 +45,7 @@ static int SDLCALL thread_function(void *data) {
     assert(data != nullptr);
     const ThreadParams params = *static_cast<const ThreadParams *>(data);
     SDL_SemPost(params.host_may_destroy_params.get());
-    const ThreadStatePtr thread = lock_and_find(params.thid, params.kernel->threads, params.kernel->mutex);
+    const ThreadStatePtr thread = params.kernel->threads.get(params.thid);
     write_reg(*thread->cpu, 0, params.arglen);
     write_reg(*thread->cpu, 1, params.argp.address());
     if (params.kernel->wait_for_debugger) {
@@ -78,17 +76,6 @@ SceUID create_thread(Ptr<const void> entry_point, KernelState &kernel, MemState
         free(mem, stack);
     };
 
-    const CallSVC call_svc = [inject, thid, &mem](CPUState &cpu, uint32_t imm, Address pc) {
-        uint32_t nid;
-        if (is_returning(cpu)) {
-            nid = *Ptr<uint32_t>(pc).get(mem);
-        } else {
-            nid = *Ptr<uint32_t>(pc + 4).get(mem);
-        }
-        inject.call_import(cpu, nid, thid);
-    };
-    inject.call_svc = call_svc;
-
     const ThreadStatePtr thread = std::make_shared<ThreadState>();
     thread->name = name;
     thread->entry_point = entry_point.address();
@@ -158,7 +145,7 @@ int start_thread(KernelState &kernel, const SceUID &thid, SceSize arglen, const
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
     }
 
-    const ThreadStatePtr thread = util::find(thid, kernel.threads);
+    const ThreadStatePtr thread = kernel.threads.get(thid);
     assert(thread);
 
     ThreadParams params;
@@ -191,8 +178,8 @@ int start_thread(KernelState &kernel, const SceUID &thid, SceSize arglen, const
 }
 
 Ptr<void> copy_stack(SceUID thid, SceUID thread_id, const Ptr<void> &argp, KernelState &kernel, MemState &mem) {
-    const ThreadStatePtr new_thread = lock_and_find(thid, kernel.threads, kernel.mutex);
-    const ThreadStatePtr old_thread = lock_and_find(thread_id, kernel.threads, kernel.mutex);
+    const ThreadStatePtr new_thread = kernel.threads.get(thid);
+    const ThreadStatePtr old_thread = kernel.threads.get(thread_id);
 
     const std::unique_lock<std::mutex> lock(kernel.mutex);
 
@@ -26,6 +26,7 @@
 #include <host/pkg.h>
 #include <host/state.h>
 #include <renderer/functions.h>
+#include <renderer/null/functions.h>
 #include <shader/spirv_recompiler.h>
 #include <util/log.h>
 #include <util/string_utils.h>
@@ -176,8 +177,23 @@ int main(int argc, char *argv[]) {
         return err;
 
     if (cfg.console) {
-        auto main_thread = host.kernel.threads.at(host.main_thread_id);
+        auto main_thread = host.kernel.threads.get(host.main_thread_id);
         auto lock = std::unique_lock<std::mutex>(main_thread->mutex);
+
+        if (host.renderer && host.renderer->current_backend == renderer::Backend::Null) {
+            // Headless replay: consume the GPU commands and signal vblanks as fast as the app produces frames.
+            while (main_thread->to_do != ThreadToDo::exit) {
+                lock.unlock();
+                renderer::process_batches(*host.renderer.get(), host.renderer->features, host.mem, host.cfg, host.base_path.c_str(),
+                    host.io.title_id.c_str());
+                host.display.condvar.notify_all();
+                lock.lock();
+            }
+
+            renderer::null::log_command_stats(static_cast<const renderer::null::NullState &>(*host.renderer));
+            return Success;
+        }
+
         main_thread->something_to_do.wait(lock, [&]() {
             return main_thread->to_do == ThreadToDo::exit;
         });
@@ -189,6 +205,10 @@ int main(int argc, char *argv[]) {
     gui::init_app_background(gui, host, host.io.title_id);
     host.renderer->features.hardware_flip = host.cfg.hardware_flip;
 
+    if (host.cfg.program_binary_cache)
+        renderer::prewarm_program_cache(*host.renderer, host.pref_path.c_str(), host.io.title_id.c_str());
+    renderer::init_shader_compiler(*host.renderer, host.cfg, host.io.title_id.c_str());
+
     app::gl_screen_renderer gl_renderer;
 
     if (!gl_renderer.init(host.base_path))
@@ -0,0 +1,63 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <mem/mem.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Guest heap behind the HLE malloc family. Blocks up to HEAP_MAX_SLOT_SIZE are slots of
+// fixed-size slabs carved out of large MemState regions; anything bigger is a MemState allocation
+// of its own. All bookkeeping lives on the host, so guest overruns cannot corrupt it.
+constexpr uint32_t HEAP_SLAB_SIZE = KB(64);
+constexpr uint32_t HEAP_REGION_SIZE = MB(4);
+constexpr uint32_t HEAP_MAX_SLOT_SIZE = KB(8);
+constexpr uint32_t HEAP_SIZE_CLASS_COUNT = 32;
+constexpr uint32_t HEAP_NO_SLAB = UINT32_MAX;
+
+struct HeapSlab {
+    Address base = 0;
+    uint32_t size_class = 0;
+    uint32_t used = 0;
+    std::vector<uint16_t> free_slots;
+    std::vector<bool> used_slots;
+};
+
+typedef std::vector<uint32_t> HeapSlabIds;
+// Large blocks, keyed by address and mapped to their requested size.
+typedef std::map<Address, uint32_t> HeapLargeBlocks;
+
+struct HeapState {
+    std::mutex mutex;
+    std::vector<HeapSlab> slabs;
+    HeapSlabIds free_slabs; // Slabs not assigned to any size class.
+    std::array<HeapSlabIds, HEAP_SIZE_CLASS_COUNT> partial_slabs; // Slabs with at least one free slot.
+    std::vector<uint32_t> slab_at; // Slab id for every HEAP_SLAB_SIZE chunk of the address space.
+    HeapLargeBlocks large_blocks;
+};
+
+Address heap_alloc(HeapState &heap, MemState &mem, uint32_t size, uint32_t alignment = 0);
+Address heap_calloc(HeapState &heap, MemState &mem, uint32_t count, uint32_t size);
+Address heap_realloc(HeapState &heap, MemState &mem, Address address, uint32_t size, uint32_t alignment = 0);
+// Returns false if the address was not allocated by the heap.
+bool heap_free(HeapState &heap, MemState &mem, Address address);
+uint32_t heap_usable_size(HeapState &heap, Address address);
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -29,6 +30,16 @@ typedef size_t Generation;
 typedef std::unique_ptr<uint8_t[], std::function<void(uint8_t *)>> Memory;
 typedef std::vector<Generation> Allocated;
 typedef std::map<Generation, std::string> GenerationNames;
+// Free page ranges, keyed by first page and mapped to page count.
+typedef std::map<size_t, size_t> FreePages;
+// Max tree over the pages, a leaf holds the length of the free range starting at its page.
+// Finds the lowest free range that is large enough (first fit) in logarithmic time.
+typedef std::vector<uint32_t> FreeRangeTree;
+// Page count of each allocation, keyed by first page.
+typedef std::map<size_t, size_t> AllocationPages;
+// Committed bytes per allocation name.
+typedef std::map<std::string, size_t> CommittedBytes;
+typedef std::unique_ptr<std::atomic<bool>[]> WriteTrackedPages;
 
 struct CPUState;
 struct MemState;
@@ -47,8 +58,13 @@ struct MemState {
     Generation generation = 0;
     Memory memory;
     Allocated allocated_pages;
+    FreePages free_pages;
+    FreeRangeTree free_range_tree;
+    AllocationPages allocation_pages;
     std::mutex generation_mutex;
     GenerationNames generation_names;
+    CommittedBytes committed_bytes;
+    WriteTrackedPages write_tracked_pages;
     std::map<Address, Address> aligned_addr_to_original;
     std::map<Address, Breakpoint> breakpoints;
 };
@@ -72,5 +88,13 @@ Address alloc_at(MemState &state, Address address, size_t size, const char *name
 void free(MemState &state, Address address);
 uint32_t mem_available(MemState &state);
 const char *mem_name(Address address, MemState &state);
+// Write-protect the pages covering a range. The first write to each page lifts the protection again.
+void track_writes(const MemState &state, Address address, size_t size);
+// True if any page in the range was written to (or was never tracked) since track_writes.
+bool is_written(const MemState &state, Address address, size_t size);
+// Touch the pages of a buffer the OS is about to write to, so that write-tracked pages are
+// unprotected first. System calls fail with EFAULT on protected pages instead of faulting.
+// Host code writing guest memory itself needs nothing, its writes fault like guest ones.
+void prepare_host_write(void *data, size_t size);
 void add_breakpoint(MemState &state, bool gdb, bool thumb_mode, uint32_t addr, BreakpointCallback callback);
 void remove_breakpoint(MemState &state, uint32_t addr);
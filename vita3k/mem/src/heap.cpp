@@ -0,0 +1,243 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/heap.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+// 16 byte steps up to 128, then four steps per power of two.
+static constexpr std::array<uint32_t, HEAP_SIZE_CLASS_COUNT> size_classes = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192
+};
+
+static_assert(size_classes.back() == HEAP_MAX_SLOT_SIZE);
+static_assert(HEAP_SLAB_SIZE / size_classes.front() <= UINT16_MAX + 1);
+
+// Slabs are aligned to HEAP_SLAB_SIZE, so a slot is aligned to any power of two dividing its size.
+static uint32_t find_size_class(uint32_t size, uint32_t alignment) {
+    for (auto it = std::lower_bound(size_classes.begin(), size_classes.end(), size); it != size_classes.end(); ++it) {
+        if ((alignment == 0) || (*it % alignment == 0))
+            return static_cast<uint32_t>(it - size_classes.begin());
+    }
+
+    return HEAP_SIZE_CLASS_COUNT;
+}
+
+static HeapSlab *find_slab(HeapState &heap, Address address, uint32_t *slab_id = nullptr) {
+    if (heap.slab_at.empty())
+        return nullptr;
+
+    const uint32_t id = heap.slab_at[address / HEAP_SLAB_SIZE];
+    if ((id == HEAP_NO_SLAB) || (heap.slabs[id].size_class == HEAP_SIZE_CLASS_COUNT))
+        return nullptr;
+
+    if (slab_id)
+        *slab_id = id;
+
+    return &heap.slabs[id];
+}
+
+static bool add_region(HeapState &heap, MemState &mem) {
+    const Address region = alloc(mem, HEAP_REGION_SIZE, "SceLibc heap", HEAP_SLAB_SIZE);
+    if (!region)
+        return false;
+
+    if (heap.slab_at.empty())
+        heap.slab_at.assign(GB(4) / HEAP_SLAB_SIZE, HEAP_NO_SLAB);
+
+    // Pushed in reverse so that the lowest slab is handed out first.
+    const uint32_t slab_count = HEAP_REGION_SIZE / HEAP_SLAB_SIZE;
+    for (uint32_t i = slab_count; i > 0; i--) {
+        const uint32_t id = static_cast<uint32_t>(heap.slabs.size());
+        HeapSlab slab;
+        slab.base = region + (i - 1) * HEAP_SLAB_SIZE;
+        slab.size_class = HEAP_SIZE_CLASS_COUNT;
+
+        heap.slab_at[slab.base / HEAP_SLAB_SIZE] = id;
+        heap.slabs.push_back(std::move(slab));
+        heap.free_slabs.push_back(id);
+    }
+
+    return true;
+}
+
+static Address alloc_slot(HeapState &heap, MemState &mem, uint32_t size_class) {
+    HeapSlabIds &partial = heap.partial_slabs[size_class];
+    if (partial.empty()) {
+        if (heap.free_slabs.empty() && !add_region(heap, mem))
+            return 0;
+
+        const uint32_t id = heap.free_slabs.back();
+        heap.free_slabs.pop_back();
+
+        HeapSlab &slab = heap.slabs[id];
+        const uint32_t slot_count = HEAP_SLAB_SIZE / size_classes[size_class];
+        slab.size_class = size_class;
+        slab.used = 0;
+        slab.used_slots.assign(slot_count, false);
+        slab.free_slots.resize(slot_count);
+        for (uint32_t slot = 0; slot < slot_count; slot++)
+            slab.free_slots[slot] = static_cast<uint16_t>(slot_count - 1 - slot);
+
+        partial.push_back(id);
+    }
+
+    HeapSlab &slab = heap.slabs[partial.back()];
+    const uint16_t slot = slab.free_slots.back();
+    slab.free_slots.pop_back();
+    slab.used_slots[slot] = true;
+    ++slab.used;
+
+    if (slab.free_slots.empty())
+        partial.pop_back();
+
+    return slab.base + slot * size_classes[size_class];
+}
+
+static void free_slot(HeapState &heap, HeapSlab &slab, uint32_t slab_id, Address address) {
+    const uint32_t slot_size = size_classes[slab.size_class];
+    const uint32_t offset = address - slab.base;
+    const uint32_t slot = offset / slot_size;
+    if ((offset % slot_size != 0) || (slot >= slab.used_slots.size()) || !slab.used_slots[slot]) {
+        LOG_ERROR("Freeing {} which is not an allocated heap block.", log_hex(address));
+        return;
+    }
+
+    HeapSlabIds &partial = heap.partial_slabs[slab.size_class];
+    slab.used_slots[slot] = false;
+    slab.free_slots.push_back(static_cast<uint16_t>(slot));
+    --slab.used;
+
+    // The slab was full, make it available again.
+    if (slab.free_slots.size() == 1)
+        partial.push_back(slab_id);
+
+    // Empty slabs go back to the shared pool, except the last one of a class so that a single
+    // block being allocated and freed in a loop does not keep reinitialising a slab.
+    if ((slab.used == 0) && (partial.size() > 1)) {
+        const auto it = std::find(partial.begin(), partial.end(), slab_id);
+        *it = partial.back();
+        partial.pop_back();
+
+        slab.size_class = HEAP_SIZE_CLASS_COUNT;
+        slab.free_slots.clear();
+        slab.used_slots.clear();
+        heap.free_slabs.push_back(slab_id);
+    }
+}
+
+Address heap_alloc(HeapState &heap, MemState &mem, uint32_t size, uint32_t alignment) {
+    const uint32_t size_class = find_size_class(size, alignment);
+
+    const std::lock_guard<std::mutex> lock(heap.mutex);
+    if (size_class != HEAP_SIZE_CLASS_COUNT)
+        return alloc_slot(heap, mem, size_class);
+
+    const Address address = alloc(mem, size, "SceLibc heap (large)", alignment);
+    if (address)
+        heap.large_blocks.emplace(address, size);
+
+    return address;
+}
+
+Address heap_calloc(HeapState &heap, MemState &mem, uint32_t count, uint32_t size) {
+    const uint64_t total = static_cast<uint64_t>(count) * size;
+    if (total > UINT32_MAX)
+        return 0;
+
+    const Address address = heap_alloc(heap, mem, static_cast<uint32_t>(total));
+    // Large blocks are fresh MemState pages, which are already zeroed.
+    if (address && (total <= HEAP_MAX_SLOT_SIZE))
+        std::memset(&mem.memory[address], 0, total);
+
+    return address;
+}
+
+Address heap_realloc(HeapState &heap, MemState &mem, Address address, uint32_t size, uint32_t alignment) {
+    if (!address)
+        return heap_alloc(heap, mem, size, alignment);
+
+    if (size == 0) {
+        heap_free(heap, mem, address);
+        return 0;
+    }
+
+    const uint32_t old_size = heap_usable_size(heap, address);
+    if (old_size == 0) {
+        LOG_ERROR("Reallocating {} which is not an allocated heap block.", log_hex(address));
+        return 0;
+    }
+
+    // Keep the block if it would land in the same size class again, or if a large block shrinks.
+    const bool aligned = (alignment == 0) || (address % alignment == 0);
+    if (aligned && (size <= old_size)) {
+        if ((old_size > HEAP_MAX_SLOT_SIZE) ? (size > HEAP_MAX_SLOT_SIZE) : (find_size_class(size, 0) == find_size_class(old_size, 0)))
+            return address;
+    }
+
+    const Address new_address = heap_alloc(heap, mem, size, alignment);
+    if (!new_address)
+        return 0;
+
+    std::memcpy(&mem.memory[new_address], &mem.memory[address], std::min(old_size, size));
+    heap_free(heap, mem, address);
+
+    return new_address;
+}
+
+bool heap_free(HeapState &heap, MemState &mem, Address address) {
+    if (!address)
+        return true;
+
+    const std::lock_guard<std::mutex> lock(heap.mutex);
+    uint32_t slab_id = 0;
+    if (HeapSlab *slab = find_slab(heap, address, &slab_id)) {
+        free_slot(heap, *slab, slab_id, address);
+        return true;
+    }
+
+    const HeapLargeBlocks::iterator large = heap.large_blocks.find(address);
+    if (large == heap.large_blocks.end())
+        return false;
+
+    heap.large_blocks.erase(large);
+    free(mem, address);
+
+    return true;
+}
+
+uint32_t heap_usable_size(HeapState &heap, Address address) {
+    const std::lock_guard<std::mutex> lock(heap.mutex);
+    if (const HeapSlab *slab = find_slab(heap, address)) {
+        const uint32_t slot_size = size_classes[slab->size_class];
+        const uint32_t offset = address - slab->base;
+        const uint32_t slot = offset / slot_size;
+        if ((offset % slot_size != 0) || (slot >= slab->used_slots.size()) || !slab->used_slots[slot])
+            return 0;
+
+        return slot_size;
+    }
+
+    const HeapLargeBlocks::const_iterator large = heap.large_blocks.find(address);
+    return (large != heap.large_blocks.end()) ? large->second : 0;
+}
@@ -23,17 +23,22 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <iterator>
 
 #ifdef WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #else
+#include <signal.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #endif
 
 constexpr size_t STANDARD_PAGE_SIZE = 4096;
 
+// The memory state whose pages the fault handler unprotects. There is only one per process.
+static MemState *write_tracking_state = nullptr;
+
 static void delete_memory(uint8_t *memory) {
     if (memory != nullptr) {
 #ifdef WIN32
@@ -45,20 +50,120 @@ static void delete_memory(uint8_t *memory) {
     }
 }
 
-static void alloc_inner(MemState &state, Address address, size_t page_count, Allocated::iterator block, const char *name) {
+static void set_free_range_length(MemState &state, size_t first_page, size_t page_count) {
+    FreeRangeTree &tree = state.free_range_tree;
+    const size_t leaf_count = tree.size() / 2;
+    size_t node = leaf_count + first_page;
+    tree[node] = static_cast<uint32_t>(page_count);
+    for (node /= 2; node > 0; node /= 2)
+        tree[node] = std::max(tree[node * 2], tree[node * 2 + 1]);
+}
+
+// First page of the lowest free range of at least page_count pages, or the page count if there is none.
+static size_t find_first_fit(const MemState &state, size_t page_count) {
+    const FreeRangeTree &tree = state.free_range_tree;
+    const size_t leaf_count = tree.size() / 2;
+    if (tree[1] < page_count)
+        return leaf_count;
+
+    size_t node = 1;
+    while (node < leaf_count)
+        node = (tree[node * 2] >= page_count) ? node * 2 : node * 2 + 1;
+
+    return node - leaf_count;
+}
+
+static void insert_free_range(MemState &state, size_t first_page, size_t page_count) {
+    state.free_pages.emplace(first_page, page_count);
+    set_free_range_length(state, first_page, page_count);
+}
+
+static void erase_free_range(MemState &state, FreePages::iterator range) {
+    set_free_range_length(state, range->first, 0);
+    state.free_pages.erase(range);
+}
+
+// Return pages to the free ranges, merging them with the free neighbours on either side.
+static void release_pages(MemState &state, size_t first_page, size_t page_count) {
+    const FreePages::iterator next = state.free_pages.find(first_page + page_count);
+    if (next != state.free_pages.end()) {
+        page_count += next->second;
+        erase_free_range(state, next);
+    }
+
+    FreePages::iterator prev = state.free_pages.lower_bound(first_page);
+    if (prev != state.free_pages.begin()) {
+        --prev;
+        if (prev->first + prev->second == first_page) {
+            first_page = prev->first;
+            page_count += prev->second;
+            erase_free_range(state, prev);
+        }
+    }
+
+    insert_free_range(state, first_page, page_count);
+}
+
+// Take pages out of the free ranges. alloc_at may ask for pages that straddle
+// several ranges or are already in use, so split whatever overlaps.
+static void reserve_pages(MemState &state, size_t first_page, size_t page_count) {
+    const size_t end_page = first_page + page_count;
+    FreePages::iterator range = state.free_pages.upper_bound(first_page);
+    if (range != state.free_pages.begin())
+        --range;
+
+    while ((range != state.free_pages.end()) && (range->first < end_page)) {
+        const size_t range_first = range->first;
+        const size_t range_end = range->first + range->second;
+        const FreePages::iterator next = std::next(range);
+        if (range_end > first_page) {
+            erase_free_range(state, range);
+            if (range_first < first_page)
+                insert_free_range(state, range_first, first_page - range_first);
+            if (range_end > end_page)
+                insert_free_range(state, end_page, range_end - end_page);
+        }
+        range = next;
+    }
+}
+
+static void alloc_inner(MemState &state, Address address, size_t page_count, const char *name) {
     // If we chopped off bytes when aligning, they would have spilled over to another page, so add it here
     if (address % state.page_size != 0)
         page_count++;
 
-    uint8_t *const memory = &state.memory[align_down(address, state.page_size)];
+    const size_t first_page = address / state.page_size;
+    uint8_t *const memory = &state.memory[first_page * state.page_size];
 
     const size_t size = page_count * state.page_size;
 
-    const Generation generation = ++state.generation;
-    std::fill_n(block, page_count, generation);
+    reserve_pages(state, first_page, page_count);
 
-    const std::lock_guard<std::mutex> lock(state.generation_mutex);
+    const Generation generation = ++state.generation;
     state.generation_names[generation] = name;
+    state.committed_bytes[name] += size;
+
+    // Free pages are decommitted, so they come back zeroed. Only pages that alloc_at
+    // takes over from a live allocation still hold data.
+    for (size_t page = first_page; page < first_page + page_count; ++page) {
+        const Generation previous = state.allocated_pages[page];
+        if (previous != 0) {
+            state.committed_bytes[state.generation_names[previous]] -= state.page_size;
+            std::memset(&state.memory[page * state.page_size], 0, state.page_size);
+
+            // Freeing the older allocation releases its pages up to the ones taken over.
+            AllocationPages::iterator older = state.allocation_pages.upper_bound(page);
+            if (older != state.allocation_pages.begin()) {
+                --older;
+                older->second = std::min(older->second, page - older->first);
+                if (older->second == 0)
+                    state.allocation_pages.erase(older);
+            }
+        }
+        state.allocated_pages[page] = generation;
+        state.write_tracked_pages[page] = false;
+    }
+    state.allocation_pages[first_page] = page_count;
 
 #ifdef WIN32
     const void *const ret = VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE);
@@ -66,9 +171,105 @@ static void alloc_inner(MemState &state, Address address, size_t page_count, All
 #else
     mprotect(memory, size, PROT_READ | PROT_WRITE);
 #endif
-    std::memset(memory, 0, size);
 }
 
+static void decommit_pages(MemState &state, size_t first_page, size_t page_count) {
+    uint8_t *const memory = &state.memory[first_page * state.page_size];
+    const size_t size = page_count * state.page_size;
+
+    for (size_t page = first_page; page < first_page + page_count; ++page)
+        state.write_tracked_pages[page] = false;
+
+    // The pages stay accessible, a guest use after free must not fault on the host.
+#ifdef WIN32
+    // Recommitted pages only take physical memory again once touched, and come back zeroed.
+    const BOOL ret = VirtualFree(memory, size, MEM_DECOMMIT);
+    LOG_CRITICAL_IF(!ret, "VirtualFree failed: {}", log_hex(GetLastError()));
+    const void *const recommitted = VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE);
+    LOG_CRITICAL_IF(!recommitted, "VirtualAlloc failed: {}", log_hex(GetLastError()));
+#else
+    // MADV_DONTNEED on a private anonymous mapping hands the pages back and
+    // guarantees zero-filled pages on the next touch.
+    madvise(memory, size, MADV_DONTNEED);
+    // Lift any write tracking protection left on them.
+    mprotect(memory, size, PROT_READ | PROT_WRITE);
+#endif
+}
+
+// Called on an access violation. Returns true if it was a write to a write-tracked page,
+// which is then made writable again so the faulting instruction can be restarted.
+static bool handle_write_fault(const uint8_t *fault_address) {
+    MemState *const state = write_tracking_state;
+    if (state == nullptr)
+        return false;
+
+    const uint8_t *const base = state->memory.get();
+    if ((fault_address < base) || (fault_address >= base + GB(4)))
+        return false;
+
+    // Every allocated page other than the null page is meant to be writable, so the fault
+    // is ours even if another thread already lifted the protection.
+    const size_t page = (fault_address - base) / state->page_size;
+    if ((page == 0) || (state->allocated_pages[page] == 0))
+        return false;
+
+    // Unprotect before clearing the flag, so a concurrent track_writes that sees the flag
+    // still set never leaves a writable page marked as unwritten.
+    uint8_t *const memory = &state->memory[page * state->page_size];
+#ifdef WIN32
+    DWORD old_protect = 0;
+    VirtualProtect(memory, state->page_size, PAGE_READWRITE, &old_protect);
+#else
+    mprotect(memory, state->page_size, PROT_READ | PROT_WRITE);
+#endif
+    state->write_tracked_pages[page] = false;
+
+    return true;
+}
+
+#ifdef WIN32
+static LONG NTAPI write_fault_handler(PEXCEPTION_POINTERS info) {
+    const EXCEPTION_RECORD &record = *info->ExceptionRecord;
+    const bool is_write = (record.NumberParameters >= 2) && (record.ExceptionInformation[0] == 1);
+    if ((record.ExceptionCode == EXCEPTION_ACCESS_VIOLATION) && is_write && handle_write_fault(reinterpret_cast<const uint8_t *>(record.ExceptionInformation[1])))
+        return EXCEPTION_CONTINUE_EXECUTION;
+
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void install_write_fault_handler() {
+    AddVectoredExceptionHandler(1, write_fault_handler);
+}
+#else
+static struct sigaction previous_segv_action;
+static struct sigaction previous_bus_action;
+
+static void write_fault_handler(int sig, siginfo_t *info, void *context) {
+    if (handle_write_fault(static_cast<const uint8_t *>(info->si_addr)))
+        return;
+
+    // Not ours, hand it to whatever handler was installed before, staying installed ourselves.
+    const struct sigaction &previous = (sig == SIGBUS) ? previous_bus_action : previous_segv_action;
+    if (previous.sa_flags & SA_SIGINFO) {
+        previous.sa_sigaction(sig, info, context);
+    } else if ((previous.sa_handler != SIG_DFL) && (previous.sa_handler != SIG_IGN)) {
+        previous.sa_handler(sig);
+    } else {
+        // A real crash. Let the access fault again with the default action, which ends the process.
+        signal(sig, SIG_DFL);
+    }
+}
+
+static void install_write_fault_handler() {
+    struct sigaction action = {};
+    action.sa_sigaction = write_fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previous_segv_action);
+    sigaction(SIGBUS, &action, &previous_bus_action);
+}
+#endif
+
 bool init(MemState &state) {
 #ifdef WIN32
     SYSTEM_INFO system_info = {};
@@ -103,6 +304,13 @@ bool init(MemState &state) {
 #endif
 
     state.allocated_pages.resize(length / state.page_size);
+    state.write_tracked_pages = std::make_unique<std::atomic<bool>[]>(state.allocated_pages.size());
+    state.free_pages.clear();
+    // The lowest-first descent in find_first_fit needs a power of two leaves, which 4 GB in pages is.
+    assert((state.allocated_pages.size() & (state.allocated_pages.size() - 1)) == 0);
+    state.free_range_tree.assign(state.allocated_pages.size() * 2, 0);
+    state.allocation_pages.clear();
+    insert_free_range(state, 0, state.allocated_pages.size());
     const Address null_address = alloc(state, 1, "NULL");
     assert(null_address == 0);
 #ifdef WIN32
@@ -113,6 +321,10 @@ bool init(MemState &state) {
     mprotect(state.memory.get(), state.page_size, PROT_NONE);
 #endif
 
+    if (write_tracking_state == nullptr)
+        install_write_fault_handler();
+    write_tracking_state = &state;
+
     return true;
 }
 
@@ -128,26 +340,27 @@ Address alloc(MemState &state, size_t size, const char *name, unsigned int align
 }
 
 Address alloc(MemState &state, size_t size, const char *name) {
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
     const size_t page_count = (size + (state.page_size - 1)) / state.page_size;
-    const Allocated::iterator block = std::search_n(state.allocated_pages.begin(), state.allocated_pages.end(), page_count, 0);
-    if (block == state.allocated_pages.end()) {
+    // First fit, like the page table scan this replaced, so guest allocations land where they always did.
+    const size_t block_page_index = find_first_fit(state, page_count);
+    if (block_page_index == state.allocated_pages.size()) {
         assert(false);
         return 0;
     }
 
-    const size_t block_page_index = block - state.allocated_pages.begin();
     const Address address = static_cast<Address>(block_page_index * state.page_size);
 
-    alloc_inner(state, address, page_count, block, name);
+    alloc_inner(state, address, page_count, name);
 
     return address;
 }
 
 Address alloc_at(MemState &state, Address address, size_t size, const char *name) {
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
     const size_t page_count = (size + (state.page_size - 1)) / state.page_size;
-    const Allocated::iterator block = state.allocated_pages.begin() + (address / state.page_size);
 
-    alloc_inner(state, address, page_count, block, name);
+    alloc_inner(state, address, page_count, name);
 
     return address;
 }
@@ -163,26 +376,36 @@ void free(MemState &state, Address address) {
     assert(page >= 0);
     assert(page < state.allocated_pages.size());
 
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
     const Generation generation = state.allocated_pages[page];
     assert(generation != 0);
 
-    const auto different_generation = std::bind(std::not_equal_to<Generation>(), std::placeholders::_1, generation);
     const Allocated::iterator first_page = state.allocated_pages.begin() + page;
-    const Allocated::iterator last_page = std::find_if(first_page, state.allocated_pages.end(), different_generation);
-    std::fill(first_page, last_page, 0);
+    size_t page_count = 0;
+    const AllocationPages::iterator allocation = state.allocation_pages.find(page);
+    if (allocation != state.allocation_pages.end()) {
+        page_count = allocation->second;
+        state.allocation_pages.erase(allocation);
+    } else {
+        // Not the start of an allocation, free up to the end of the one it is in.
+        const auto different_generation = std::bind(std::not_equal_to<Generation>(), std::placeholders::_1, generation);
+        page_count = std::find_if(first_page, state.allocated_pages.end(), different_generation) - first_page;
+    }
+    std::fill_n(first_page, page_count, 0);
+    release_pages(state, page, page_count);
+    state.committed_bytes[state.generation_names[generation]] -= page_count * state.page_size;
 
-    // TODO Decommit/protect freed memory.
+    decommit_pages(state, page, page_count);
 }
 
 uint32_t mem_available(MemState &state) {
-    const size_t page_count = 1;
-    const Allocated::iterator block = std::search_n(state.allocated_pages.begin(), state.allocated_pages.end(), page_count, 0);
-    if (block == state.allocated_pages.end()) {
+    const std::lock_guard<std::mutex> lock(state.generation_mutex);
+    if (state.free_pages.empty()) {
         assert(false);
         return 0;
     }
 
-    const size_t block_page_index = block - state.allocated_pages.begin();
+    const size_t block_page_index = state.free_pages.begin()->first;
     const Address address = static_cast<Address>(GB(4) - static_cast<Address>(block_page_index * state.page_size));
 
     return address;
@@ -208,6 +431,51 @@ const char *mem_name(Address address, MemState &state) {
     return found->second.c_str();
 }
 
+void track_writes(const MemState &state, Address address, size_t size) {
+    if (size == 0)
+        return;
+
+    const size_t first_page = address / state.page_size;
+    const size_t end_page = std::min((static_cast<size_t>(address) + size + state.page_size - 1) / state.page_size, state.allocated_pages.size());
+    for (size_t page = first_page; page < end_page; ++page) {
+        if ((state.allocated_pages[page] == 0) || state.write_tracked_pages[page].exchange(true))
+            continue;
+
+        uint8_t *const memory = &state.memory[page * state.page_size];
+#ifdef WIN32
+        DWORD old_protect = 0;
+        VirtualProtect(memory, state.page_size, PAGE_READONLY, &old_protect);
+#else
+        mprotect(memory, state.page_size, PROT_READ);
+#endif
+    }
+}
+
+bool is_written(const MemState &state, Address address, size_t size) {
+    const size_t first_page = address / state.page_size;
+    const size_t end_page = (static_cast<size_t>(address) + size + state.page_size - 1) / state.page_size;
+    // Nothing past the guest address space is tracked.
+    if (end_page > state.allocated_pages.size())
+        return true;
+
+    for (size_t page = first_page; page < end_page; ++page) {
+        if (!state.write_tracked_pages[page])
+            return true;
+    }
+
+    return false;
+}
+
+void prepare_host_write(void *data, size_t size) {
+    if (size == 0)
+        return;
+
+    volatile uint8_t *const bytes = static_cast<uint8_t *>(data);
+    for (size_t offset = 0; offset < size; offset += STANDARD_PAGE_SIZE)
+        bytes[offset] = bytes[offset];
+    bytes[size - 1] = bytes[size - 1];
+}
+
 constexpr unsigned char thumb_breakpoint[2] = { 0x00, 0xBE };
 constexpr unsigned char arm_breakpoint[4] = { 0x70, 0x00, 0x20, 0xE1 };
 
@@ -0,0 +1,132 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/mem.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+// Measures alloc/free throughput of MemState against the linear page scan it replaced.
+// Both sides first pin down a fragmented, long-lived region (as loaded modules and
+// game heaps do), then churn short-lived allocations on top of it.
+
+constexpr size_t ITERATIONS = 100000;
+constexpr size_t MAX_LIVE_ALLOCATIONS = 2048;
+constexpr size_t MAX_ALLOCATION_SIZE = KB(64);
+constexpr size_t RESIDENT_ALLOCATIONS = 16384;
+constexpr size_t RESIDENT_ALLOCATION_SIZE = KB(32);
+
+// The previous allocator: search_n over the page table for a run of free pages.
+// Commits the same way MemState does so only the bookkeeping differs.
+struct LinearPages {
+    size_t page_size = 0;
+    uint8_t *memory = nullptr;
+    Generation generation = 0;
+    Allocated allocated_pages;
+
+    LinearPages(size_t page_size, uint8_t *memory)
+        : page_size(page_size)
+        , memory(memory)
+        , allocated_pages(GB(4) / page_size) {
+        alloc(1);
+    }
+
+    Address alloc(size_t size) {
+        const size_t page_count = (size + (page_size - 1)) / page_size;
+        const Allocated::iterator block = std::search_n(allocated_pages.begin(), allocated_pages.end(), page_count, 0);
+        if (block == allocated_pages.end())
+            return 0;
+        std::fill_n(block, page_count, ++generation);
+
+        const Address address = static_cast<Address>((block - allocated_pages.begin()) * page_size);
+#ifndef WIN32
+        mprotect(&memory[address], page_count * page_size, PROT_READ | PROT_WRITE);
+#endif
+        std::memset(&memory[address], 0, page_count * page_size);
+        return address;
+    }
+
+    void free(Address address) {
+        const Allocated::iterator first_page = allocated_pages.begin() + address / page_size;
+        const Generation current = *first_page;
+        const Allocated::iterator last_page = std::find_if(first_page, allocated_pages.end(), [current](Generation g) { return g != current; });
+        std::fill(first_page, last_page, 0);
+    }
+};
+
+template <typename Alloc, typename Free>
+static double run(Alloc alloc, Free free) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> size_dist(1, MAX_ALLOCATION_SIZE);
+    std::vector<Address> live;
+    live.reserve(MAX_LIVE_ALLOCATIONS);
+
+    // Leave single-page holes between resident allocations so that the scan has to skip over them.
+    std::vector<Address> holes;
+    holes.reserve(RESIDENT_ALLOCATIONS);
+    for (size_t i = 0; i < RESIDENT_ALLOCATIONS; ++i) {
+        alloc(RESIDENT_ALLOCATION_SIZE);
+        holes.push_back(alloc(1));
+    }
+    for (const Address address : holes)
+        free(address);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        if (live.size() == MAX_LIVE_ALLOCATIONS || (!live.empty() && (rng() & 1))) {
+            const size_t index = rng() % live.size();
+            free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        } else {
+            live.push_back(alloc(size_dist(rng)));
+        }
+    }
+    for (const Address address : live)
+        free(address);
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+    MemState mem;
+    if (!init(mem)) {
+        std::fprintf(stderr, "Failed to initialise memory.\n");
+        return 1;
+    }
+
+    const double mem_seconds = run([&](size_t size) { return alloc(mem, size, "benchmark"); }, [&](Address address) { free(mem, address); });
+
+    // Reuse the same reservation; the linear allocator keeps its own page table.
+    LinearPages linear(mem.page_size, mem.memory.get());
+    const double linear_seconds = run([&](size_t size) { return linear.alloc(size); }, [&](Address address) { linear.free(address); });
+
+    std::printf("%zu alloc/free operations\n", ITERATIONS);
+    std::printf("linear search_n: %8.3f s (%10.0f ops/s)\n", linear_seconds, ITERATIONS / linear_seconds);
+    std::printf("free ranges:     %8.3f s (%10.0f ops/s)\n", mem_seconds, ITERATIONS / mem_seconds);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <mem/mem.h>
+
+#include <gtest/gtest.h>
+
+class MemTest : public testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(init(mem));
+        page = mem.page_size;
+    }
+
+    MemState mem;
+    size_t page = 0;
+};
+
+TEST_F(MemTest, null_page_is_reserved) {
+    EXPECT_STREQ(mem_name(0, mem), "NULL");
+    EXPECT_EQ(alloc(mem, 1, "first"), page);
+}
+
+TEST_F(MemTest, alloc_is_first_fit) {
+    const Address a = alloc(mem, page, "a");
+    const Address b = alloc(mem, page * 4, "b");
+    const Address c = alloc(mem, page, "c");
+    const Address d = alloc(mem, page * 2, "d");
+    alloc(mem, page, "e");
+    EXPECT_EQ(b, a + page);
+    EXPECT_EQ(c, b + page * 4);
+
+    // Both holes fit two pages. The lower one wins even though the other fits exactly.
+    free(mem, b);
+    free(mem, d);
+    EXPECT_EQ(alloc(mem, page * 2, "f"), b);
+    EXPECT_EQ(alloc(mem, page * 2, "g"), b + page * 2);
+    EXPECT_EQ(alloc(mem, page * 2, "h"), d);
+    EXPECT_EQ(mem_name(c, mem), std::string("c"));
+}
+
+TEST_F(MemTest, free_coalesces_neighbours) {
+    const Address a = alloc(mem, page, "a");
+    const Address b = alloc(mem, page, "b");
+    const Address c = alloc(mem, page, "c");
+    alloc(mem, page, "guard");
+
+    free(mem, a);
+    free(mem, c);
+    free(mem, b);
+    EXPECT_EQ(alloc(mem, page * 3, "abc"), a);
+}
+
+TEST_F(MemTest, free_releases_whole_allocation) {
+    const Address a = alloc(mem, page * 3 + 1, "a");
+    const Address b = alloc(mem, page, "b");
+    EXPECT_EQ(b, a + page * 4);
+
+    free(mem, a);
+    EXPECT_EQ(mem_name(a + page * 3, mem), std::string("UNALLOCATED"));
+    EXPECT_EQ(alloc(mem, page * 4, "c"), a);
+}
+
+TEST_F(MemTest, alloc_at_splits_free_ranges) {
+    const Address base = alloc(mem, page, "base");
+    const Address fixed = base + page * 8;
+    EXPECT_EQ(alloc_at(mem, fixed, page * 2, "fixed"), fixed);
+
+    // The pages below the fixed allocation stay free, and the next large block goes above it.
+    EXPECT_EQ(alloc(mem, page * 7, "below"), base + page);
+    EXPECT_EQ(alloc(mem, page * 2, "above"), fixed + page * 2);
+
+    free(mem, fixed);
+    EXPECT_EQ(alloc(mem, page * 2, "again"), fixed);
+}
+
+TEST_F(MemTest, alloc_at_takes_over_live_pages) {
+    const Address a = alloc(mem, page * 4, "a");
+    EXPECT_EQ(alloc_at(mem, a + page * 2, page * 2, "b"), a + page * 2);
+    EXPECT_EQ(mem_name(a + page * 2, mem), std::string("b"));
+
+    // Freeing the older allocation leaves the pages that were taken over alone.
+    free(mem, a);
+    EXPECT_EQ(mem_name(a + page, mem), std::string("UNALLOCATED"));
+    EXPECT_EQ(mem_name(a + page * 2, mem), std::string("b"));
+    EXPECT_EQ(alloc(mem, page * 3, "c"), a + page * 4);
+}
+
+TEST_F(MemTest, mem_available_counts_from_lowest_free_page) {
+    const uint32_t before = mem_available(mem);
+    const Address a = alloc(mem, page * 2, "a");
+    EXPECT_EQ(mem_available(mem), before - page * 2);
+
+    free(mem, a);
+    EXPECT_EQ(mem_available(mem), before);
+}
+
+TEST_F(MemTest, write_tracking_up_to_top_of_memory) {
+    const Address top = static_cast<Address>(GB(4) - page);
+    EXPECT_EQ(alloc_at(mem, top, page, "top"), top);
+
+    track_writes(mem, top, page);
+    EXPECT_FALSE(is_written(mem, top, page));
+}
+
+TEST_F(MemTest, write_tracking_past_top_of_memory) {
+    const Address top = static_cast<Address>(GB(4) - page);
+    EXPECT_EQ(alloc_at(mem, top, page, "top"), top);
+
+    // The part past the end is ignored when tracking and always counts as written.
+    track_writes(mem, top, page * 2);
+    EXPECT_FALSE(is_written(mem, top, page));
+    EXPECT_TRUE(is_written(mem, top, page * 2));
+}
@@ -42,13 +42,9 @@ void call(void (*export_fn)(HostState &, SceUID, const char *, Args...), const c
 }
 
 template <typename Ret, typename... Args>
-ImportFn bridge(Ret (*export_fn)(HostState &, SceUID, const char *, Args...), const char *export_name) {
+void bridge(Ret (*export_fn)(HostState &, SceUID, const char *, Args...), const char *export_name, HostState &host, CPUState &cpu, SceUID thread_id) {
     constexpr std::tuple<ArgsLayout<Args...>, LayoutArgsState> args_layout = lay_out<typename BridgeTypes<Args>::ArmType...>();
 
-    return [export_fn, export_name, args_layout](HostState &host, CPUState &cpu, SceUID thread_id) {
-        MICROPROFILE_SCOPEI("HLE", export_name, MP_YELLOW);
-
-        using Indices = std::index_sequence_for<Args...>;
-        call(export_fn, export_name, std::get<0>(args_layout), std::get<1>(args_layout), Indices(), thread_id, cpu, host);
-    };
+    using Indices = std::index_sequence_for<Args...>;
+    call(export_fn, export_name, std::get<0>(args_layout), std::get<1>(args_layout), Indices(), thread_id, cpu, host);
 }
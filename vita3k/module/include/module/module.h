@@ -28,7 +28,13 @@ int stubbed_impl(const char *name, const char *info);
 #define STUBBED(info) stubbed_impl(export_name, info)
 
 #define BRIDGE_DECL(name) extern const ImportFn import_##name;
-#define BRIDGE_IMPL(name) const ImportFn import_##name = bridge(&export_##name, #name);
+// The profiler scope has to live here: its token is a static local, so it must not be shared between
+// exports that happen to instantiate bridge() with the same signature.
+#define BRIDGE_IMPL(name)                                                                 \
+    const ImportFn import_##name = [](HostState &host, CPUState &cpu, SceUID thread_id) { \
+        MICROPROFILE_SCOPEI("HLE", #name, MP_YELLOW);                                     \
+        bridge(&export_##name, #name, host, cpu, thread_id);                              \
+    };
 
 #define EXPORT(ret, name, ...) ret export_##name(HostState &host, SceUID thread_id, const char *export_name, ##__VA_ARGS__)
 
@@ -369,8 +369,7 @@ EXPORT(SceInt32, sceAppMgrLoadExec, const char *appPath, Ptr<char> const argv[],
             host.kernel.running_threads[thread_id].swap(run_exec_thread);
             host.kernel.running_threads.erase(thread_id);
 
-            auto exec_thread = util::find(exec_thread_id, host.kernel.threads);
-            host.kernel.threads[thread_id].swap(exec_thread);
+            const ThreadStatePtr current_thread = host.kernel.threads.get(thread_id);
             host.kernel.threads.erase(thread_id);
 
             host.kernel.loaded_modules.erase(thread_id - 1);
@@ -17,13 +17,12 @@
 
 #include "SceDbg.h"
 
-#include <util/lock_and_find.h>
 #include <v3kprintf.h>
 
 #include <kernel/functions.h>
 
 EXPORT(int, sceDbgAssertionHandler, const char *filename, int line, bool do_stop, const char *component, module::vargs messages) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -19,7 +19,6 @@
 
 #include "cpu/functions.h"
 
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
 const static int DEFAULT_FIBER_STACK_SIZE = 4096;
@@ -104,7 +103,7 @@ void _initializeFiber(HostState &host, const ThreadStatePtr thread, SceFiber *fi
 }
 
 EXPORT(SceInt32, _sceFiberInitializeImpl, SceFiber *fiber, char *name, Ptr<SceFiberEntry> entry, SceUInt32 argOnInitialize, Ptr<void> addrContext, SceSize sizeContext, SceFiberOptParam *params) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
     }
@@ -115,7 +114,7 @@ EXPORT(SceInt32, _sceFiberInitializeImpl, SceFiber *fiber, char *name, Ptr<SceFi
 }
 
 EXPORT(int, _sceFiberInitializeWithInternalOptionImpl, SceFiber *fiber, char *name, Ptr<SceFiberEntry> entry, SceUInt32 argOnInitialize, Ptr<void> addrContext, SceSize sizeContext) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -138,7 +137,7 @@ EXPORT(SceUInt32, sceFiberGetSelf, Ptr<SceFiber> *fiber) {
     if (!fiber)
         return SCE_FIBER_ERROR_NULL;
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (thread->fiber)
         *fiber = thread->fiber.cast<SceFiber>();
@@ -165,7 +164,7 @@ EXPORT(int, sceFiberRenameSelf) {
 }
 
 EXPORT(SceInt32, sceFiberReturnToThread, SceUInt32 argOnReturn, Ptr<SceUInt32> argOnRun) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     auto fiber = thread->fiber.cast<SceFiber>().get(host.mem);
     save_context(*(thread->cpu), (thread->fiber.cast<SceFiber>().get(host.mem)->cpu));
     load_context(*(thread->cpu), *(thread->cpu_context));
@@ -181,7 +180,7 @@ EXPORT(SceInt32, sceFiberReturnToThread, SceUInt32 argOnReturn, Ptr<SceUInt32> a
 }
 
 EXPORT(SceUInt32, sceFiberRun, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<SceUInt32> argOnRun) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     auto res = _fiberSwitch(host, thread, fiber, *(thread->cpu_context), argOnRunTo, argOnRun, false);
     write_lr(*(thread->cpu), thread->cpu_context.get()->lr);
     return res;
@@ -196,7 +195,7 @@ EXPORT(int, sceFiberStopContextSizeCheck) {
 }
 
 EXPORT(SceUInt32, sceFiberSwitch, SceFiber *fiber, SceUInt32 argOnRunTo, Ptr<SceUInt32> argOnRun) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     auto old_fiber = thread->fiber.cast<SceFiber>().get(host.mem);
     return _fiberSwitch(host, thread, fiber, old_fiber->cpu, argOnRunTo, argOnRun, true);
 }
@@ -27,13 +27,45 @@
 #include <renderer/functions.h>
 #include <renderer/types.h>
 #include <util/bytes.h>
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
+#include <list>
+#include <unordered_map>
+
+struct IndexRangeKey {
+    Address address;
+    uint32_t count;
+    SceGxmIndexFormat format;
+
+    bool operator==(const IndexRangeKey &other) const {
+        return (address == other.address) && (count == other.count) && (format == other.format);
+    }
+};
+
+struct IndexRangeKeyHash {
+    size_t operator()(const IndexRangeKey &key) const {
+        return std::hash<uint64_t>()((static_cast<uint64_t>(key.address) << 32) | key.count) ^ key.format;
+    }
+};
+
+typedef std::list<IndexRangeKey> IndexRangeLru; // Most recently drawn with first.
+
+struct IndexRange {
+    size_t max_index;
+    IndexRangeLru::iterator lru;
+};
+
+// Highest index of each index buffer drawn with, valid while its pages have not been written.
+struct IndexRangeCache {
+    std::unordered_map<IndexRangeKey, IndexRange, IndexRangeKeyHash> ranges;
+    IndexRangeLru lru;
+};
+
 struct SceGxmContext {
     GxmContextState state;
     GXMRecordState record;
     std::unique_ptr<renderer::Context> renderer;
+    IndexRangeCache index_ranges;
 };
 
 struct SceGxmRenderTarget {
@@ -92,6 +124,86 @@ static bool operator<(const FragmentProgramCacheKey &a, const FragmentProgramCac
     return b.blend_info < a.blend_info;
 }
 
+static constexpr size_t MAX_INDEX_RANGE_CACHE_SIZE = 4096;
+
+static size_t scan_max_index(SceGxmIndexFormat format, const void *indices, unsigned int count) {
+    if (format == SCE_GXM_INDEX_FORMAT_U16) {
+        const uint16_t *const data = static_cast<const uint16_t *>(indices);
+        return *std::max_element(&data[0], &data[count]);
+    }
+
+    const uint32_t *const data = static_cast<const uint32_t *>(indices);
+    return *std::max_element(&data[0], &data[count]);
+}
+
+static size_t get_max_index(const MemState &mem, IndexRangeCache &cache, SceGxmIndexFormat format, const void *indices, unsigned int count) {
+    if (count == 0)
+        return 0;
+
+    // Scanning less than a page is cheaper than protecting it and taking a fault on the next write.
+    const size_t indices_size = count * ((format == SCE_GXM_INDEX_FORMAT_U16) ? sizeof(uint16_t) : sizeof(uint32_t));
+    if (indices_size < mem.page_size)
+        return scan_max_index(format, indices, count);
+
+    const IndexRangeKey key = { Ptr<const void>(indices, mem).address(), count, format };
+    const auto cached = cache.ranges.find(key);
+    if (cached != cache.ranges.end()) {
+        if (!is_written(mem, key.address, indices_size)) {
+            cache.lru.splice(cache.lru.begin(), cache.lru, cached->second.lru);
+            return cached->second.max_index;
+        }
+
+        // Stale, it is scanned again below.
+        cache.lru.erase(cached->second.lru);
+        cache.ranges.erase(cached);
+    }
+
+    if (cache.ranges.size() >= MAX_INDEX_RANGE_CACHE_SIZE) {
+        cache.ranges.erase(cache.lru.back());
+        cache.lru.pop_back();
+    }
+
+    // Protect before scanning, so a write that races with the scan invalidates the result.
+    track_writes(mem, key.address, indices_size);
+
+    const size_t max_index = scan_max_index(format, indices, count);
+    cache.lru.push_front(key);
+    cache.ranges.emplace(key, IndexRange{ max_index, cache.lru.begin() });
+
+    return max_index;
+}
+
+// Copy the vertex streams used by a program into staging memory and queue their upload.
+// The copies are needed because the guest may overwrite its buffers before the renderer
+// gets to this scene.
+static void upload_vertex_streams(HostState &host, SceGxmContext *context, const SceGxmVertexProgram &vertex_program, const StreamDatas &stream_data, size_t max_index) {
+    size_t max_data_length[SCE_GXM_MAX_VERTEX_STREAMS] = {};
+    std::uint32_t stream_used = 0;
+    for (const SceGxmVertexAttribute &attribute : vertex_program.attributes) {
+        const SceGxmAttributeFormat attribute_format = static_cast<SceGxmAttributeFormat>(attribute.format);
+        const size_t attribute_size = gxm::attribute_format_size(attribute_format) * attribute.componentCount;
+        const SceGxmVertexStream &stream = vertex_program.streams[attribute.streamIndex];
+        const size_t data_length = attribute.offset + (max_index * stream.stride) + attribute_size;
+        max_data_length[attribute.streamIndex] = std::max<size_t>(max_data_length[attribute.streamIndex], data_length);
+        stream_used |= (1 << attribute.streamIndex);
+    }
+
+    // Copy and queue upload
+    for (size_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; ++stream_index) {
+        // Upload it
+        if (stream_used & (1 << static_cast<std::uint16_t>(stream_index))) {
+            const size_t data_length = max_data_length[stream_index];
+            const std::uint8_t *const data = stream_data[stream_index].cast<const std::uint8_t>().get(host.mem);
+
+            void *const a_copy = renderer::alloc_staging(*context->renderer, data_length);
+            std::memcpy(a_copy, data, data_length);
+
+            renderer::set_vertex_stream(*host.renderer, context->renderer.get(), &context->state, stream_index,
+                data_length, a_copy);
+        }
+    }
+}
+
 EXPORT(int, sceGxmAddRazorGpuCaptureBuffer) {
     return UNIMPLEMENTED();
 }
@@ -543,40 +655,8 @@ EXPORT(int, sceGxmDraw, SceGxmContext *context, SceGxmPrimitiveType primType, Sc
 
     // Update vertex data. We should stores a copy of the data to pass it to GPU later, since another scene
     // may start to overwrite stuff when this scene is being processed in our queue (in case of OpenGL).
-    size_t max_index = 0;
-    if (indexType == SCE_GXM_INDEX_FORMAT_U16) {
-        const uint16_t *const data = static_cast<const uint16_t *>(indexData);
-        max_index = *std::max_element(&data[0], &data[indexCount]);
-    } else {
-        const uint32_t *const data = static_cast<const uint32_t *>(indexData);
-        max_index = *std::max_element(&data[0], &data[indexCount]);
-    }
-
-    size_t max_data_length[SCE_GXM_MAX_VERTEX_STREAMS] = {};
-    std::uint32_t stream_used = 0;
-    for (const SceGxmVertexAttribute &attribute : gxm_vertex_program.attributes) {
-        const SceGxmAttributeFormat attribute_format = static_cast<SceGxmAttributeFormat>(attribute.format);
-        const size_t attribute_size = gxm::attribute_format_size(attribute_format) * attribute.componentCount;
-        const SceGxmVertexStream &stream = gxm_vertex_program.streams[attribute.streamIndex];
-        const size_t data_length = attribute.offset + (max_index * stream.stride) + attribute_size;
-        max_data_length[attribute.streamIndex] = std::max<size_t>(max_data_length[attribute.streamIndex], data_length);
-        stream_used |= (1 << attribute.streamIndex);
-    }
-
-    // Copy and queue upload
-    for (size_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; ++stream_index) {
-        // Upload it
-        if (stream_used & (1 << static_cast<std::uint16_t>(stream_index))) {
-            const size_t data_length = max_data_length[stream_index];
-            const std::uint8_t *const data = context->state.stream_data[stream_index].cast<const std::uint8_t>().get(host.mem);
-
-            std::uint8_t *a_copy = new std::uint8_t[data_length];
-            std::copy(data, data + data_length, a_copy);
-
-            renderer::set_vertex_stream(*host.renderer, context->renderer.get(), &context->state, stream_index,
-                data_length, a_copy);
-        }
-    }
+    const size_t max_index = get_max_index(host.mem, context->index_ranges, indexType, indexData, indexCount);
+    upload_vertex_streams(host, context, gxm_vertex_program, context->state.stream_data, max_index);
 
     // Fragment texture is copied so no need to set it here.
     // Add draw command
@@ -638,14 +718,7 @@ EXPORT(int, sceGxmDrawPrecomputed, SceGxmContext *context, SceGxmPrecomputedDraw
 
     // Update vertex data. We should stores a copy of the data to pass it to GPU later, since another scene
     // may start to overwrite stuff when this scene is being processed in our queue (in case of OpenGL).
-    size_t max_index = 0;
-    if (draw->index_format == SCE_GXM_INDEX_FORMAT_U16) {
-        const uint16_t *const data = draw->index_data.cast<const uint16_t>().get(host.mem);
-        max_index = *std::max_element(&data[0], &data[draw->vertex_count]);
-    } else {
-        const uint32_t *const data = draw->index_data.cast<const uint32_t>().get(host.mem);
-        max_index = *std::max_element(&data[0], &data[draw->vertex_count]);
-    }
+    const size_t max_index = get_max_index(host.mem, context->index_ranges, draw->index_format, draw->index_data.get(host.mem), draw->vertex_count);
 
     const auto frag_paramters = gxp::program_parameters(fragment_program_gxp);
     auto &textures = *fragment_state->textures.get(host.mem);
@@ -657,34 +730,7 @@ EXPORT(int, sceGxmDrawPrecomputed, SceGxmContext *context, SceGxmPrecomputedDraw
         }
     }
 
-    size_t max_data_length[SCE_GXM_MAX_VERTEX_STREAMS] = {};
-    std::uint32_t stream_used = 0;
-    for (const SceGxmVertexAttribute &attribute : vertex_program->attributes) {
-        const SceGxmAttributeFormat attribute_format = static_cast<SceGxmAttributeFormat>(attribute.format);
-        const size_t attribute_size = gxm::attribute_format_size(attribute_format) * attribute.componentCount;
-        const SceGxmVertexStream &stream = vertex_program->streams[attribute.streamIndex];
-        const size_t data_length = attribute.offset + (max_index * stream.stride) + attribute_size;
-        max_data_length[attribute.streamIndex] = std::max<size_t>(max_data_length[attribute.streamIndex], data_length);
-        stream_used |= (1 << attribute.streamIndex);
-    }
-
-    auto &stream_data = *draw->stream_data.get(host.mem);
-    // Copy and queue upload
-    for (size_t stream_index = 0; stream_index < SCE_GXM_MAX_VERTEX_STREAMS; ++stream_index) {
-        //LOG_INFO("streams[{}] = {}", stream_index, log_hex(draw->vertex_streams.get(host.mem)[stream_index].address()));
-        // Upload it
-        if (stream_used & (1 << static_cast<std::uint16_t>(stream_index))) {
-            const size_t data_length = max_data_length[stream_index];
-
-            const std::uint8_t *const data = stream_data[stream_index].cast<const std::uint8_t>().get(host.mem);
-
-            std::uint8_t *a_copy = new std::uint8_t[data_length];
-            std::copy(data, data + data_length, a_copy);
-
-            renderer::set_vertex_stream(*host.renderer, context->renderer.get(), &context->state, stream_index,
-                data_length, a_copy);
-        }
-    }
+    upload_vertex_streams(host, context, *vertex_program, *draw->stream_data.get(host.mem), max_index);
 
     // Fragment texture is copied so no need to set it here.
     // Add draw command
@@ -722,6 +768,9 @@ EXPORT(int, sceGxmEndScene, SceGxmContext *context, const SceGxmNotification *ve
     renderer::add_command(context->renderer.get(), renderer::CommandOpcode::Nop, &context->renderer->render_finish_status,
         (int)0);
 
+    // Hand this scene's vertex copies back once the renderer is done with it
+    renderer::fence_staging(*context->renderer);
+
     if (context->state.fragment_sync_object) {
         // Add NOP for our sync object
         SceGxmSyncObject *sync = context->state.fragment_sync_object.get(mem);
@@ -842,12 +891,9 @@ static int SDLCALL thread_function(void *data) {
         renderer::wishlist(newBuffer, renderer::SyncObjectSubject::Fragment);
 
         // Now run callback
-        {
-            const ThreadStatePtr thread = lock_and_find(params.thid, params.kernel->threads, params.kernel->mutex);
-            if ((!thread) || thread->to_do == ThreadToDo::exit)
-                break;
-        }
-        const ThreadStatePtr display_thread = util::find(params.thid, params.kernel->threads);
+        const ThreadStatePtr display_thread = params.kernel->threads.get(params.thid);
+        if ((!display_thread) || display_thread->to_do == ThreadToDo::exit)
+            break;
         run_callback(*display_thread, display_callback->pc, display_callback->data);
 
         free(*params.mem, display_callback->data);
@@ -869,7 +915,7 @@ EXPORT(int, sceGxmInitialize, const SceGxmInitializeParams *params) {
     host.gxm.params = *params;
     host.gxm.display_queue.maxPendingCount_ = params->displayQueueMaxPendingCount;
 
-    const ThreadStatePtr main_thread = util::find(thread_id, host.kernel.threads);
+    const ThreadStatePtr main_thread = host.kernel.threads.get(thread_id);
 
     const auto stack_size = SCE_KERNEL_STACK_SIZE_USER_DEFAULT; // TODO: Verify this is the correct stack size
 
@@ -880,7 +926,7 @@ EXPORT(int, sceGxmInitialize, const SceGxmInitializeParams *params) {
         return RET_ERROR(SCE_GXM_ERROR_DRIVER);
     }
 
-    const ThreadStatePtr display_thread = util::find(host.gxm.display_queue_thread, host.kernel.threads);
+    const ThreadStatePtr display_thread = host.kernel.threads.get(host.gxm.display_queue_thread);
 
     const std::function<void(SDL_Thread *)> delete_thread = [display_thread](SDL_Thread *running_thread) {
         {
@@ -2056,7 +2102,7 @@ EXPORT(int, sceGxmSyncObjectDestroy, Ptr<SceGxmSyncObject> syncObject) {
 }
 
 EXPORT(int, sceGxmTerminate) {
-    const ThreadStatePtr thread = lock_and_find(host.gxm.display_queue_thread, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(host.gxm.display_queue_thread);
     std::unique_lock<std::mutex> thread_lock(thread->mutex);
 
     thread->to_do = ThreadToDo::exit;
@@ -2075,8 +2121,6 @@ EXPORT(int, sceGxmTerminate) {
     // need to unlock thread->mutex because thread destructor (delete_thread) will get called, and it locks that mutex
     thread_lock.unlock();
 
-    // TODO: This causes a deadlock
-    //const std::lock_guard<std::mutex> lock2(host.kernel.mutex);
     host.kernel.running_threads.erase(host.gxm.display_queue_thread);
     host.kernel.waiting_threads.erase(host.gxm.display_queue_thread);
     host.kernel.threads.erase(host.gxm.display_queue_thread);
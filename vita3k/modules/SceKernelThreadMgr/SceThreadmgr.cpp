@@ -412,7 +412,7 @@ EXPORT(int, sceKernelChangeThreadCpuAffinityMask) {
 EXPORT(int, sceKernelChangeThreadPriority, SceUID thid, int priority) {
     STUBBED("STUB");
 
-    const ThreadStatePtr thread = lock_and_find(thid ? thid : thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thid ? thid : thread_id);
     const std::lock_guard<std::mutex> lock(thread->mutex);
     thread.get()->priority = priority;
 
@@ -548,10 +548,8 @@ EXPORT(int, sceKernelDeleteSimpleEvent) {
 }
 
 EXPORT(int, sceKernelDeleteThread, SceUID thid) {
-    const ThreadStatePtr thread = lock_and_find(thid, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thid);
 
-    // TODO: This causes a deadlock
-    //const std::lock_guard<std::mutex> lock2(host.kernel.mutex);
     host.kernel.running_threads.erase(thid);
     host.kernel.waiting_threads.erase(thid);
     host.kernel.threads.erase(thid);
@@ -565,7 +563,7 @@ EXPORT(int, sceKernelDeleteTimer, SceUID timer_handle) {
 }
 
 EXPORT(int, sceKernelExitDeleteThread, int status) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     std::unique_lock<std::mutex> thread_lock(thread->mutex);
 
     thread->to_do = ThreadToDo::exit;
@@ -584,8 +582,6 @@ EXPORT(int, sceKernelExitDeleteThread, int status) {
     // need to unlock thread->mutex because thread destructor (delete_thread) will get called, and it locks that mutex
     thread_lock.unlock();
 
-    // TODO: This causes a deadlock
-    //const std::lock_guard<std::mutex> lock2(host.kernel.mutex);
     host.kernel.running_threads.erase(thread_id);
     host.kernel.waiting_threads.erase(thread_id);
     host.kernel.threads.erase(thread_id);
@@ -703,7 +699,7 @@ EXPORT(SceUID, sceKernelOpenTimer, const char *name) {
 
 EXPORT(int, sceKernelPollSema, SceUID semaid, int32_t needCount) {
     assert(needCount >= 0);
-    const SemaphorePtr semaphore = lock_and_find(semaid, host.kernel.semaphores, host.kernel.mutex);
+    const SemaphorePtr semaphore = host.kernel.semaphores.get(semaid);
     if (!semaphore) {
         return RET_ERROR(SCE_KERNEL_ERROR_UNKNOWN_SEMA_ID);
     }
@@ -729,7 +725,7 @@ EXPORT(int, sceKernelResumeThreadForVM) {
 
 EXPORT(int, sceKernelSendSignal, SceUID target_thread_id) {
     STUBBED("sceKernelSendSignal");
-    const auto thread = lock_and_find(target_thread_id, host.kernel.threads, host.kernel.mutex);
+    const auto thread = host.kernel.threads.get(target_thread_id);
     LOG_TRACE("signaling thread {}", target_thread_id);
     thread->signal.notify();
     return SCE_KERNEL_OK;
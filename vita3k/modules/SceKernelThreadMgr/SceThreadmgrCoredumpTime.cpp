@@ -17,10 +17,9 @@
 
 #include "SceThreadmgrCoredumpTime.h"
 
-#include <util/lock_and_find.h>
 
 EXPORT(int, sceKernelExitThread, int status) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     const std::lock_guard<std::mutex> lock(thread->mutex);
 
     thread->to_do = ThreadToDo::exit;
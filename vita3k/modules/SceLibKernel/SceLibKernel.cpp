@@ -77,8 +77,7 @@ EXPORT(int, _sceKernelCreateLwMutex, Ptr<SceKernelLwMutexWork> workarea, const c
     assert(name != nullptr);
     assert(init_count >= 0);
 
-    auto uid_out = &workarea.get(host.mem)->uid;
-    return mutex_create(uid_out, host.kernel, export_name, name, thread_id, attr, init_count, SyncWeight::Light);
+    return lwmutex_create(host.kernel, export_name, name, thread_id, *workarea.get(host.mem), attr, init_count);
 }
 
 EXPORT(int, sceClibAbort) {
@@ -193,7 +192,7 @@ EXPORT(int, sceClibMspaceReallocalign) {
 EXPORT(int, sceClibPrintf, const char *fmt, module::vargs args) {
     std::vector<char> buffer(KB(1));
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -211,7 +210,7 @@ EXPORT(int, sceClibPrintf, const char *fmt, module::vargs args) {
 }
 
 EXPORT(int, sceClibSnprintf, char *dst, SceSize dst_max_size, const char *fmt, module::vargs args) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -330,7 +329,7 @@ EXPORT(int, sceClibVprintf) {
 }
 
 EXPORT(int, sceClibVsnprintf, char *dst, SceSize dst_max_size, const char *fmt, module::vargs args) {
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -885,8 +884,7 @@ EXPORT(int, sceKernelCreateLwMutex, Ptr<SceKernelLwMutexWork> workarea, const ch
     assert(name);
     assert(init_count >= 0);
 
-    const auto uid_out = &workarea.get(host.mem)->uid;
-    return mutex_create(uid_out, host.kernel, export_name, name, thread_id, attr, init_count, SyncWeight::Light);
+    return lwmutex_create(host.kernel, export_name, name, thread_id, *workarea.get(host.mem), attr, init_count);
 }
 
 EXPORT(int, sceKernelCreateMsgPipe) {
@@ -1127,7 +1125,7 @@ EXPORT(int, sceKernelGetThreadInfo, SceUID thid, SceKernelThreadInfo *info) {
     if (info->size > 0x80)
         return SCE_KERNEL_ERROR_NOSYS;
 
-    const ThreadStatePtr thread = lock_and_find(thid ? thid : thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thid ? thid : thread_id);
 
     strncpy(info->name, thread->name.c_str(), 0x1f);
     info->stack = reinterpret_cast<void *>(thread->stack.get()->get());
@@ -1263,7 +1261,7 @@ EXPORT(int, sceKernelLoadStartModule, char *path, SceSize args, Ptr<void> argp,
     const SceUID thid = create_thread(entry_point.cast<const void>(), host.kernel, host.mem, module->module_name, SCE_KERNEL_DEFAULT_PRIORITY_USER,
         static_cast<int>(SCE_KERNEL_STACK_SIZE_USER_DEFAULT), inject, nullptr);
 
-    const ThreadStatePtr thread = lock_and_find(thid, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thid);
 
     uint32_t result = run_on_current(*thread, entry_point, args, argp);
     char *module_name = module->module_name;
@@ -1282,14 +1280,12 @@ EXPORT(int, sceKernelLoadStartModule, char *path, SceSize args, Ptr<void> argp,
 }
 
 EXPORT(int, sceKernelLockLwMutex, Ptr<SceKernelLwMutexWork> workarea, int lock_count, unsigned int *ptimeout) {
-    const auto lwmutexid = workarea.get(host.mem)->uid;
-    return mutex_lock(host.kernel, export_name, thread_id, lwmutexid, lock_count, ptimeout, SyncWeight::Light);
+    return lwmutex_lock(host.kernel, export_name, thread_id, *workarea.get(host.mem), lock_count, ptimeout);
 }
 
 EXPORT(int, sceKernelLockLwMutexCB, Ptr<SceKernelLwMutexWork> workarea, int lock_count, unsigned int *ptimeout) {
     STUBBED("no CB");
-    const auto lwmutexid = workarea.get(host.mem)->uid;
-    return mutex_lock(host.kernel, export_name, thread_id, lwmutexid, lock_count, ptimeout, SyncWeight::Light);
+    return lwmutex_lock(host.kernel, export_name, thread_id, *workarea.get(host.mem), lock_count, ptimeout);
 }
 
 EXPORT(int, sceKernelLockMutex, SceUID mutexid, int lock_count, unsigned int *timeout) {
@@ -1448,8 +1444,7 @@ EXPORT(int, sceKernelStopUnloadModule) {
 }
 
 EXPORT(int, sceKernelTryLockLwMutex, Ptr<SceKernelLwMutexWork> workarea, int lock_count) {
-    const auto lwmutexid = workarea.get(host.mem)->uid;
-    return mutex_try_lock(host.kernel, export_name, thread_id, lwmutexid, lock_count, SyncWeight::Light);
+    return lwmutex_try_lock(host.kernel, export_name, thread_id, *workarea.get(host.mem), lock_count);
 }
 
 EXPORT(int, sceKernelTryReceiveMsgPipe) {
@@ -1473,13 +1468,11 @@ EXPORT(int, sceKernelUnloadModule) {
 }
 
 EXPORT(int, sceKernelUnlockLwMutex, Ptr<SceKernelLwMutexWork> workarea, int unlock_count) {
-    const auto lwmutexid = workarea.get(host.mem)->uid;
-    return mutex_unlock(host.kernel, export_name, thread_id, lwmutexid, unlock_count, SyncWeight::Light);
+    return lwmutex_unlock(host.kernel, export_name, thread_id, *workarea.get(host.mem), unlock_count);
 }
 
 EXPORT(int, sceKernelUnlockLwMutex2, Ptr<SceKernelLwMutexWork> workarea, int unlock_count) {
-    const auto lwmutexid = workarea.get(host.mem)->uid;
-    return mutex_unlock(host.kernel, export_name, thread_id, lwmutexid, unlock_count, SyncWeight::Light);
+    return lwmutex_unlock(host.kernel, export_name, thread_id, *workarea.get(host.mem), unlock_count);
 }
 
 EXPORT(int, sceKernelWaitCond, SceUID cond_id, SceUInt32 *timeout) {
@@ -1558,7 +1551,7 @@ struct SceKernelWaitSignalParams {
 
 EXPORT(int, sceKernelWaitSignal, uint32_t unknown, uint32_t delay, uint32_t timeout, SceKernelWaitSignalParams *params) {
     STUBBED("sceKernelWaitSignal");
-    const auto thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const auto thread = host.kernel.threads.get(thread_id);
     LOG_TRACE("thread {} is waiting to get signaled", thread_id);
     thread->signal.wait();
     LOG_TRACE("thread {} gets signaled", thread_id);
@@ -1573,12 +1566,12 @@ EXPORT(int, sceKernelWaitSignalCB) {
 }
 
 int wait_thread_end(HostState &host, SceUID thread_id, SceUID thid) {
-    const ThreadStatePtr current_thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr current_thread = host.kernel.threads.get(thread_id);
 
     const std::lock_guard<std::mutex> current_thread_lock(current_thread->mutex);
 
     {
-        const ThreadStatePtr thread = lock_and_find(thid, host.kernel.threads, host.kernel.mutex);
+        const ThreadStatePtr thread = host.kernel.threads.get(thid);
         const std::lock_guard<std::mutex> thread_lock(thread->mutex);
 
         if (thread->to_do == ThreadToDo::exit) {
@@ -18,7 +18,7 @@
 #include "SceLibc.h"
 
 #include <io/functions.h>
-#include <util/lock_and_find.h>
+#include <mem/heap.h>
 #include <util/log.h>
 
 #include <dlmalloc.h>
@@ -360,8 +360,8 @@ EXPORT(int, c32rtomb) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, calloc) {
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, calloc, uint32_t nelem, uint32_t size) {
+    return Ptr<void>(heap_calloc(host.heap, host.mem, nelem, size));
 }
 
 EXPORT(int, clearerr) {
@@ -474,7 +474,7 @@ EXPORT(int, fread) {
 }
 
 EXPORT(void, free, Address mem) {
-    free(host.mem, mem);
+    LOG_WARN_IF(!heap_free(host.heap, host.mem, mem), "Freeing {} which was not allocated by malloc.", log_hex(mem));
 }
 
 EXPORT(int, freopen) {
@@ -701,8 +701,8 @@ EXPORT(int, longjmp) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, malloc, SceSize size) {
-    return alloc(host.mem, size, __FUNCTION__);
+EXPORT(Ptr<void>, malloc, SceSize size) {
+    return Ptr<void>(heap_alloc(host.heap, host.mem, size));
 }
 
 EXPORT(int, malloc_stats) {
@@ -713,8 +713,8 @@ EXPORT(int, malloc_stats_fast) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, malloc_usable_size) {
-    return UNIMPLEMENTED();
+EXPORT(uint32_t, malloc_usable_size, Address mem) {
+    return heap_usable_size(host.heap, mem);
 }
 
 EXPORT(int, mblen) {
@@ -762,12 +762,7 @@ EXPORT(int, mbtowc) {
 }
 
 EXPORT(Ptr<void>, memalign, uint32_t alignment, uint32_t size) {
-    Address address = alloc(host.mem, size, "memalign", alignment);
-
-    STUBBED("No actual alignment.");
-    LOG_WARN_IF(address % alignment != 0, "Address {} does not fit alignment of {}.", log_hex(address), alignment);
-
-    return Ptr<void>(address);
+    return Ptr<void>(heap_alloc(host.heap, host.mem, size, alignment));
 }
 
 EXPORT(int, memchr) {
@@ -861,7 +856,7 @@ EXPORT(int, perror) {
 EXPORT(int, printf, const char *format, module::vargs args) {
     std::vector<char> buffer(1024);
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
 
     if (!thread) {
         return SCE_KERNEL_ERROR_UNKNOWN_THREAD_ID;
@@ -922,12 +917,12 @@ EXPORT(int, rand_r) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, realloc) {
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, realloc, Address mem, uint32_t size) {
+    return Ptr<void>(heap_realloc(host.heap, host.mem, mem, size));
 }
 
-EXPORT(int, reallocalign) {
-    return UNIMPLEMENTED();
+EXPORT(Ptr<void>, reallocalign, Address mem, uint32_t size, uint32_t alignment) {
+    return Ptr<void>(heap_realloc(host.heap, host.mem, mem, size, alignment));
 }
 
 EXPORT(int, remove) {
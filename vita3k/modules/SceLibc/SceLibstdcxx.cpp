@@ -17,6 +17,9 @@
 
 #include "SceLibstdcxx.h"
 
+#include <mem/heap.h>
+#include <util/log.h>
+
 EXPORT(int, _Atomic_compare_exchange_strong) {
     return UNIMPLEMENTED();
 }
@@ -4453,8 +4456,8 @@ EXPORT(int, _ZZNSt13basic_filebufIwSt11char_traitsIwEE5_InitEPSt10_Dnk_filetNS2_
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, _ZdaPv) {
-    return UNIMPLEMENTED();
+EXPORT(void, _ZdaPv, Address ptr) {
+    LOG_WARN_IF(!heap_free(host.heap, host.mem, ptr), "Deleting {} which was not allocated by operator new.", log_hex(ptr));
 }
 
 EXPORT(int, _ZdaPvRKSt9nothrow_t) {
@@ -4465,8 +4468,8 @@ EXPORT(int, _ZdaPvS_) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, _ZdlPv) {
-    return UNIMPLEMENTED();
+EXPORT(void, _ZdlPv, Address ptr) {
+    LOG_WARN_IF(!heap_free(host.heap, host.mem, ptr), "Deleting {} which was not allocated by operator new.", log_hex(ptr));
 }
 
 EXPORT(int, _ZdlPvRKSt9nothrow_t) {
@@ -4477,16 +4480,16 @@ EXPORT(int, _ZdlPvS_) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, _Znaj, int test) {
-    return alloc(host.mem, test, __FUNCTION__);
+EXPORT(Ptr<void>, _Znaj, uint32_t size) {
+    return Ptr<void>(heap_alloc(host.heap, host.mem, size));
 }
 
 EXPORT(int, _ZnajRKSt9nothrow_t) {
     return UNIMPLEMENTED();
 }
 
-EXPORT(int, _Znwj, int test) {
-    return alloc(host.mem, test, __FUNCTION__);
+EXPORT(Ptr<void>, _Znwj, uint32_t size) {
+    return Ptr<void>(heap_alloc(host.heap, host.mem, size));
 }
 
 EXPORT(int, _ZnwjRKSt9nothrow_t) {
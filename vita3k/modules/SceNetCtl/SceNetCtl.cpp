@@ -18,7 +18,6 @@
 #include "SceNetCtl.h"
 
 #include <kernel/thread/thread_functions.h>
-#include <util/lock_and_find.h>
 
 #define SCE_NETCTL_INFO_SSID_LEN_MAX 32
 #define SCE_NETCTL_INFO_CONFIG_NAME_LEN_MAX 64
@@ -115,7 +114,7 @@ EXPORT(int, sceNetCtlCheckCallback) {
 
     host.net.state = 1;
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     for (auto &callback : host.net.cbs) {
         Ptr<void> argp = Ptr<void>(callback.second.data);
         run_on_current(*thread, Ptr<void>(callback.second.pc), 1, argp);
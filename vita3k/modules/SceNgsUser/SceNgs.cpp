@@ -114,7 +114,7 @@ EXPORT(int, sceNgsPatchRemoveRouting, SceNgsPatchHandle patch_handle) {
 }
 
 EXPORT(int, sceNgsRackGetRequiredMemorySize, SceNgsSynthSystemHandle sys_handle, ngs::RackDescription *description, uint32_t *size) {
-    *size = ngs::Rack::get_required_memspace_size(host.mem, description);
+    *size = ngs::Rack::get_required_memspace_size(host.mem, sys_handle.get(host.mem), description);
     return 0;
 }
 
@@ -296,7 +296,7 @@ EXPORT(int, sceNgsVoiceGetParamsOutOfRange) {
 
 EXPORT(int, sceNgsVoiceGetStateData, SceNgsVoiceHandle voice_handle, const std::uint32_t unk, void *mem, const std::uint32_t space_size) {
     ngs::Voice *voice = voice_handle.get(host.mem);
-    std::memcpy(mem, voice->voice_state_data.data(), std::min<std::size_t>(space_size, voice->voice_state_data.size()));
+    std::memcpy(mem, voice->voice_state_data, std::min<std::size_t>(space_size, voice->voice_state_size));
 
     return SCE_NGS_OK;
 }
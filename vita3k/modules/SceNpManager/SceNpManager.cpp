@@ -18,7 +18,6 @@
 #include "SceNpManager.h"
 
 #include <kernel/thread/thread_functions.h>
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
 #include <np/functions.h>
@@ -45,7 +44,7 @@ EXPORT(int, sceNpCheckCallback) {
 
     host.np.state = 0;
 
-    const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
     for (auto &callback : host.np.cbs) {
         Ptr<void> argp = Ptr<void>(callback.second.data);
         run_on_current(*thread, Ptr<void>(callback.second.pc), host.np.state, argp);
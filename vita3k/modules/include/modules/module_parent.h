@@ -27,6 +27,7 @@ struct KernelState;
 struct CPUDepInject;
 
 void call_import(HostState &host, CPUState &cpu, uint32_t nid, SceUID thread_id);
+void call_svc(HostState &host, CPUState &cpu, uint32_t imm, Address pc);
 bool load_module(HostState &host, SceSysmoduleModuleId module_id);
 Address resolve_export(KernelState &kernel, uint32_t nid);
 uint32_t resolve_nid(KernelState &kernel, Address addr);
@@ -27,8 +27,6 @@
 #include <kernel/functions.h>
 #include <module/load_module.h>
 #include <nids/functions.h>
-#include <util/find.h>
-#include <util/lock_and_find.h>
 #include <util/log.h>
 
 #include <unordered_set>
@@ -43,18 +41,20 @@ static constexpr bool LOG_UNK_NIDS_ALWAYS = false;
 
 struct HostState;
 
-static ImportFn resolve_import(uint32_t nid) {
-    switch (nid) {
+static const ImportFn import_fns[] = {
 #define VAR_NID(name, nid)
-#define NID(name, nid) \
-    case nid:          \
-        return import_##name;
+#define NID(name, nid) import_##name,
 #include <nids/nids.h>
 #undef NID
 #undef VAR_NID
-    }
+};
+
+static ImportFn resolve_import(uint32_t nid) {
+    const int32_t index = import_index(nid);
+    if (index < 0)
+        return nullptr;
 
-    return ImportFn();
+    return import_fns[index];
 }
 
 const std::array<VarExport, var_exports_size> &get_var_exports() {
@@ -117,45 +117,77 @@ static void log_import_call(char emulation_level, uint32_t nid, SceUID thread_id
     }
 }
 
+static void call_hle(HostState &host, CPUState &cpu, uint32_t nid, ImportFn fn, SceUID thread_id) {
+    if (is_returning(cpu))
+        return;
+    if (host.kernel.watch_import_calls) {
+        static const std::unordered_set<uint32_t> hle_nid_blacklist = {
+            0xB295EB61, // sceKernelGetTLSAddr
+            0x46E7BE7B, // sceKernelLockLwMutex
+            0x91FA6614, // sceKernelUnlockLwMutex
+        };
+        auto lr = read_lr(cpu);
+        log_import_call('H', nid, thread_id, hle_nid_blacklist, lr);
+    }
+    if (fn) {
+        fn(host, cpu, thread_id);
+    } else if (host.missing_nids.count(nid) == 0 || LOG_UNK_NIDS_ALWAYS) {
+        const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
+        LOG_ERROR("Import function for NID {} not found (thread name: {}, thread ID: {})", log_hex(nid), thread->name, thread_id);
+
+        if (!LOG_UNK_NIDS_ALWAYS)
+            host.missing_nids.insert(nid);
+    }
+}
+
+static void call_lle(HostState &host, CPUState &cpu, uint32_t nid, Address export_pc, SceUID thread_id) {
+    if (is_returning(cpu)) {
+        LOG_TRACE("[LLE] TID: {:<3} FUNC: {} returned {}", thread_id, import_name(nid), log_hex(read_reg(cpu, 0)));
+        return;
+    }
+
+    static const std::unordered_set<uint32_t> lle_nid_blacklist = {};
+    auto pc = read_pc(cpu);
+    log_import_call('L', nid, thread_id, lle_nid_blacklist, pc);
+    const ThreadStatePtr thread = host.kernel.threads.get(thread_id);
+    const std::lock_guard<std::mutex> lock(thread->mutex);
+    write_pc(*thread->cpu, export_pc);
+}
+
 void call_import(HostState &host, CPUState &cpu, uint32_t nid, SceUID thread_id) {
     Address export_pc = resolve_export(host.kernel, nid);
 
     if (!export_pc) {
         // HLE - call our C++ function
-        if (is_returning(cpu))
-            return;
-        if (host.kernel.watch_import_calls) {
-            const std::unordered_set<uint32_t> hle_nid_blacklist = {
-                0xB295EB61, // sceKernelGetTLSAddr
-                0x46E7BE7B, // sceKernelLockLwMutex
-                0x91FA6614, // sceKernelUnlockLwMutex
-            };
-            auto lr = read_lr(cpu);
-            log_import_call('H', nid, thread_id, hle_nid_blacklist, lr);
-        }
-        const ImportFn fn = resolve_import(nid);
-        if (fn) {
-            fn(host, cpu, thread_id);
-        } else if (host.missing_nids.count(nid) == 0 || LOG_UNK_NIDS_ALWAYS) {
-            const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
-            LOG_ERROR("Import function for NID {} not found (thread name: {}, thread ID: {})", log_hex(nid), thread->name, thread_id);
-
-            if (!LOG_UNK_NIDS_ALWAYS)
-                host.missing_nids.insert(nid);
-        }
+        call_hle(host, cpu, nid, resolve_import(nid), thread_id);
     } else {
         // LLE - directly run ARM code imported from some loaded module
-        if (is_returning(cpu)) {
-            LOG_TRACE("[LLE] TID: {:<3} FUNC: {} returned {}", thread_id, import_name(nid), log_hex(read_reg(cpu, 0)));
-            return;
-        }
+        call_lle(host, cpu, nid, export_pc, thread_id);
+    }
+}
+
+void call_svc(HostState &host, CPUState &cpu, uint32_t imm, Address pc) {
+    const SceUID thread_id = get_thread_id(cpu);
 
-        const std::unordered_set<uint32_t> lle_nid_blacklist = {};
-        auto pc = read_pc(cpu);
-        log_import_call('L', nid, thread_id, lle_nid_blacklist, pc);
-        const ThreadStatePtr thread = lock_and_find(thread_id, host.kernel.threads, host.kernel.mutex);
-        const std::lock_guard<std::mutex> lock(thread->mutex);
-        write_pc(*thread->cpu, export_pc);
+    if (IMPORT_CALL_LOG_LEVEL != None || imm == 0) {
+        // The stub carries the NID after the svc, see load_func_imports.
+        const uint32_t nid = is_returning(cpu) ? *Ptr<uint32_t>(pc).get(host.mem) : *Ptr<uint32_t>(pc + 4).get(host.mem);
+        call_import(host, cpu, nid, thread_id);
+        return;
+    }
+
+    if (imm >= host.kernel.import_slot_count.load(std::memory_order_acquire)) {
+        LOG_ERROR("SVC {} at {} is not an import stub (thread ID: {})", log_hex(imm), log_hex(pc), thread_id);
+        return;
+    }
+
+    // Everything was resolved when the stub was written, no lookup left to do here.
+    const ImportSlot &slot = host.kernel.import_slots[imm];
+    const Address export_pc = slot.export_pc.load(std::memory_order_acquire);
+    if (export_pc) {
+        call_lle(host, cpu, slot.nid, export_pc, thread_id);
+    } else {
+        call_hle(host, cpu, slot.nid, slot.hle_index < 0 ? nullptr : import_fns[slot.hle_index], thread_id);
     }
 }
 
@@ -192,7 +224,7 @@ bool load_module(HostState &host, SceSysmoduleModuleId module_id) {
                 auto inject = create_cpu_dep_inject(host);
                 const SceUID module_thread_id = create_thread(lib_entry_point, host.kernel, host.mem, module_name, SCE_KERNEL_DEFAULT_PRIORITY_USER,
                     static_cast<int>(SCE_KERNEL_STACK_SIZE_USER_DEFAULT), inject, nullptr);
-                const ThreadStatePtr module_thread = util::find(module_thread_id, host.kernel.threads);
+                const ThreadStatePtr module_thread = host.kernel.threads.get(module_thread_id);
                 const auto ret = run_on_current(*module_thread, lib_entry_point, 0, argp);
 
                 module_thread->to_do = ThreadToDo::exit;
@@ -215,8 +247,8 @@ bool load_module(HostState &host, SceSysmoduleModuleId module_id) {
 }
 
 CPUDepInject create_cpu_dep_inject(HostState &host) {
-    const CallImport call_import = [&host](CPUState &cpu, uint32_t nid, SceUID main_thread_id) {
-        ::call_import(host, cpu, nid, main_thread_id);
+    const CallSVC call_svc = [&host](CPUState &cpu, uint32_t imm, Address pc) {
+        ::call_svc(host, cpu, imm, pc);
     };
     const ResolveNIDName resolve_nid_name = [&host](Address addr) {
         return ::resolve_nid_name(host.kernel, addr);
@@ -226,10 +258,12 @@ CPUDepInject create_cpu_dep_inject(HostState &host) {
     };
 
     CPUDepInject inject;
-    inject.call_import = call_import;
+    inject.call_svc = call_svc;
     inject.resolve_nid_name = resolve_nid_name;
     inject.trace_stack = host.cfg.stack_traceback;
     inject.get_watch_memory_addr = get_watch_memory_addr;
     inject.module_regions = host.kernel.module_regions;
+    inject.jit_cache = host.kernel.jit_cache;
+    inject.cpu_backend = host.kernel.cpu_backend;
     return inject;
 }
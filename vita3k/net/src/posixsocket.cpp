@@ -1,5 +1,6 @@
 
 #include <cstring>
+#include <mem/mem.h>
 #include <net/socket.h>
 
 // NOTE: This should be SCE_NET_##errname but it causes vitaQuake to softlock in online games
@@ -146,6 +147,8 @@ int PosixSocket::get_socket_address(SceNetSockaddr *name, unsigned int *namelen)
     if (name != nullptr) {
         *namelen = sizeof(sockaddr_in);
     }
+    if (namelen != nullptr)
+        prepare_host_write(namelen, sizeof(*namelen));
     int res = getsockname(sock, &addr, (socklen_t *)namelen);
     if (res >= 0) {
         convertPosixSockaddrToSce(&addr, name);
@@ -165,6 +168,8 @@ int PosixSocket::close() {
 
 SocketPtr PosixSocket::accept(SceNetSockaddr *addr, unsigned int *addrlen) {
     struct sockaddr addr2;
+    if (addrlen != nullptr)
+        prepare_host_write(addrlen, sizeof(*addrlen));
     abs_socket new_socket = ::accept(sock, &addr2, (socklen_t *)addrlen);
     if (new_socket >= 0) {
         convertPosixSockaddrToSce(&addr2, addr);
@@ -190,8 +195,10 @@ int PosixSocket::set_socket_options(int level, int optname, const void *optval,
 }
 
 int PosixSocket::recv_packet(void *buf, unsigned int len, int flags, SceNetSockaddr *from, unsigned int *fromlen) {
+    prepare_host_write(buf, len);
     if (from != nullptr) {
         struct sockaddr addr;
+        prepare_host_write(fromlen, sizeof(*fromlen));
         int res = recvfrom(sock, (char *)buf, len, flags, &addr, (socklen_t *)fromlen);
         convertPosixSockaddrToSce(&addr, from);
         *fromlen = sizeof(SceNetSockaddrIn);
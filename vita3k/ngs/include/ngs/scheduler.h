@@ -1,6 +1,10 @@
 #pragma once
 
 #include <mem/ptr.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 struct MemState;
@@ -10,19 +14,46 @@ struct PatchSetupInfo;
 struct Voice;
 struct Patch;
 
+// Voices of one rack share its module, so they are always processed in order by one thread.
+typedef std::vector<Voice *> VoiceGroup;
+
+// Voices that don't feed each other, grouped by rack. The groups are processed in parallel.
+typedef std::vector<VoiceGroup> VoiceLevel;
+
 struct VoiceScheduler {
     std::vector<Voice *> queue;
     std::mutex lock;
 
+    VoiceScheduler() = default;
+    VoiceScheduler(const VoiceScheduler &) = delete;
+    VoiceScheduler &operator=(const VoiceScheduler &) = delete;
+    ~VoiceScheduler();
+
 protected:
+    // Every voice comes after the voices patched into it. Rebuilt on update after the queue or a patch changed.
+    std::vector<VoiceLevel> levels;
+    bool levels_dirty = true;
+
+    // Threads helping with the groups of the level being processed.
+    std::vector<std::thread> workers;
+    std::mutex work_mutex;
+    std::condition_variable work_available;
+    std::condition_variable level_done;
+    const VoiceLevel *work_level = nullptr;
+    const MemState *work_mem = nullptr;
+    size_t next_group = 0;
+    size_t groups_left = 0;
+    bool quit = false;
+
     bool deque_voice(Voice *voice);
 
     /**
-         * \brief Sort the voice queue so that dependencies between them are respected.
+         * \brief Sort the queued voices into levels so that dependencies between them are respected.
          */
-    bool resort_to_respect_dependencies(const MemState &mem, Voice *source);
+    void rebuild_levels(const MemState &mem);
 
-    std::int32_t get_position(Voice *v);
+    void process_level(const MemState &mem, const VoiceLevel &level);
+    void work();
 
 public:
     bool play(const MemState &mem, Voice *voice);
@@ -33,4 +64,4 @@ public:
 
     Ptr<Patch> patch(const MemState &mem, PatchSetupInfo *info);
 };
-} // namespace ngs
\ No newline at end of file
+} // namespace ngs
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -52,6 +54,15 @@ struct SystemInitParameters {
 
 struct Voice;
 
+// Voices get slots of this size from their rack's memspace for their state and each of their inputs.
+// Enough for one granule of 16-bit stereo PCM.
+inline std::uint32_t get_voice_slot_size(const std::int32_t granularity) {
+    return static_cast<std::uint32_t>(granularity) * sizeof(std::int16_t) * 2;
+}
+
+// Only one input per voice is emulated for now.
+static constexpr std::uint16_t VOICE_INPUT_COUNT = 1;
+
 struct PatchSetupInfo {
     Ptr<Voice> source;
     std::int32_t source_output_index;
@@ -100,15 +111,15 @@ enum VoiceState {
 };
 
 struct VoiceInputManager {
-    using PCMInput = std::vector<std::uint8_t>;
-    using PCMInputs = std::vector<PCMInput>;
-
-    PCMInputs inputs;
+    std::uint8_t *buffers; ///< One voice slot per input, carved from the rack's memspace.
+    std::uint16_t input_count;
+    std::uint32_t buffer_size;
+    std::mutex lock; ///< Sources in the same scheduler level deliver from several threads.
 
-    void init(const std::uint32_t granularity, const std::uint16_t total_input);
+    bool init(const MemState &mem, Rack *rack, const std::uint16_t total_input);
     void reset_inputs();
 
-    PCMInput *get_input_buffer_queue(const std::int32_t index);
+    std::uint8_t *get_input_buffer(const std::int32_t index);
     std::int32_t receive(Patch *patch, const std::uint8_t **data);
 };
 
@@ -132,13 +143,13 @@ struct Voice {
     using Patches = std::vector<Ptr<Patch>>;
 
     std::array<Patches, MAX_OUTPUT_PORT> patches;
-    std::vector<std::uint8_t> voice_state_data; ///< Voice state.
-    std::vector<std::uint8_t> extra_voice_data; ///< Local data storage for module.
+    std::uint8_t *voice_state_data; ///< Voice state, a voice slot of the rack's memspace.
+    std::uint32_t voice_state_size;
 
     VoiceInputManager inputs;
-    std::unique_ptr<std::mutex> voice_lock;
+    std::mutex voice_lock;
 
-    void init(Rack *mama);
+    bool init(const MemState &mem, Rack *mama);
 
     BufferParamsInfo *lock_params(const MemState &mem);
     bool unlock_params();
@@ -148,11 +159,8 @@ struct Voice {
 
     template <typename T>
     T *get_state() {
-        if (voice_state_data.size() == 0) {
-            voice_state_data.resize(sizeof(T));
-        }
-
-        return reinterpret_cast<T *>(&voice_state_data[0]);
+        assert(sizeof(T) <= voice_state_size);
+        return reinterpret_cast<T *>(voice_state_data);
     }
 
     template <typename T>
@@ -179,7 +187,7 @@ struct Rack : public MempoolObject {
 
     explicit Rack(System *mama, const Ptr<void> memspace, const std::uint32_t memspace_size);
 
-    static std::uint32_t get_required_memspace_size(MemState &mem, RackDescription *description);
+    static std::uint32_t get_required_memspace_size(MemState &mem, const System *system, RackDescription *description);
 };
 
 struct System : public MempoolObject {
@@ -1,6 +1,8 @@
 #include <ngs/modules/master.h>
 #include <util/log.h>
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 
 namespace ngs::master {
@@ -19,19 +21,16 @@ void Module::get_expectation(AudioDataType *expect_audio_type, std::int16_t *exp
 
 void Module::process(const MemState &mem, Voice *voice) {
     // Lock voice to avoid resource modificiation from other thread
-    const std::lock_guard<std::mutex> guard(*voice->voice_lock);
+    const std::lock_guard<std::mutex> guard(voice->voice_lock);
 
     // Merge all voices. This buss manually outputs 2 channels
-    if (voice->voice_state_data.empty()) {
-        voice->voice_state_data.resize(voice->rack->system->granularity * sizeof(std::uint16_t) * 2);
-    }
-
-    std::fill(voice->voice_state_data.begin(), voice->voice_state_data.end(), 0);
+    const std::uint8_t *input = voice->inputs.get_input_buffer(0);
 
-    if (voice->inputs.inputs.empty()) {
+    if (!input) {
+        std::memset(voice->voice_state_data, 0, voice->voice_state_size);
         return;
     }
 
-    std::copy(voice->inputs.inputs[0].data(), voice->inputs.inputs[0].data() + voice->voice_state_data.size(), voice->voice_state_data.data());
+    std::memcpy(voice->voice_state_data, input, std::min(voice->voice_state_size, voice->inputs.buffer_size));
 }
 }; // namespace ngs::master
\ No newline at end of file
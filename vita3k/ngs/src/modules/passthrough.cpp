@@ -18,14 +18,9 @@ Module::Module()
     : ngs::Module(ngs::BussType::BUSS_REVERB) {}
 
 void Module::process(const MemState &mem, Voice *voice) {
-    const std::lock_guard<std::mutex> guard(*voice->voice_lock);
+    const std::lock_guard<std::mutex> guard(voice->voice_lock);
 
-    if (voice->inputs.inputs.size() < 1) {
-        return;
-    }
-
-    assert(voice->inputs.inputs.size() == 1);
-    uint8_t *output_data = voice->inputs.inputs[0].data();
+    uint8_t *output_data = voice->inputs.get_input_buffer(0);
 
     deliver_data(mem, voice, 0, output_data);
 }
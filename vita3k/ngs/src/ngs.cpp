@@ -8,6 +8,16 @@
 
 #include <util/log.h>
 
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NGS_MIX_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NGS_MIX_NEON
+#endif
+
 namespace ngs {
 Rack::Rack(System *mama, const Ptr<void> memspace, const std::uint32_t memspace_size)
     : MempoolObject(memspace, memspace_size)
@@ -19,44 +29,103 @@ System::System(const Ptr<void> memspace, const std::uint32_t memspace_size)
     , granularity(0)
     , sample_rate(0) {}
 
-void VoiceInputManager::init(const std::uint32_t granularity, const std::uint16_t total_input) {
-    inputs.resize(total_input);
+bool VoiceInputManager::init(const MemState &mem, Rack *rack, const std::uint16_t total_input) {
+    input_count = total_input;
+    buffer_size = get_voice_slot_size(rack->system->granularity);
+    buffers = nullptr;
+
+    if (total_input != 0) {
+        const Ptr<std::uint8_t> space = rack->alloc_raw(buffer_size * total_input).cast<std::uint8_t>();
+
+        if (!space) {
+            return false;
+        }
 
-    for (auto &input : inputs) {
-        // PCM16 and maximum channel count
-        input.resize(granularity * 4);
+        buffers = space.get(mem);
     }
 
     reset_inputs();
+    return true;
 }
 
 void VoiceInputManager::reset_inputs() {
-    for (auto &input : inputs) {
-        std::fill(input.begin(), input.end(), 0);
+    if (buffers) {
+        std::memset(buffers, 0, buffer_size * input_count);
     }
 }
 
-VoiceInputManager::PCMInput *VoiceInputManager::get_input_buffer_queue(const std::int32_t index) {
-    if (index >= inputs.size()) {
+std::uint8_t *VoiceInputManager::get_input_buffer(const std::int32_t index) {
+    if (index < 0 || index >= input_count) {
         return nullptr;
     }
 
-    return &inputs[index];
+    return buffers + index * buffer_size;
+}
+
+// Same channel count on both sides, so every sample is scaled by the diagonal of the volume matrix.
+static std::size_t mix_same_channels(std::int16_t *dest, const std::int16_t *src, const std::size_t sample_count, const Patch &patch) {
+    std::size_t i = 0;
+
+#if defined(NGS_MIX_SSE2)
+    // Stereo samples alternate between the two volumes, mono uses the first one only.
+    const float right_volume = (patch.dest_channels == 2) ? patch.volume_matrix[1][1] : patch.volume_matrix[0][0];
+    const __m128 volumes = _mm_setr_ps(patch.volume_matrix[0][0], right_volume, patch.volume_matrix[0][0], right_volume);
+    for (; i + 8 <= sample_count; i += 8) {
+        const __m128i src_samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&src[i]));
+        const __m128i dest_samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&dest[i]));
+
+        // Widen to 32 bits, then the volume is applied with the same truncation as the scalar code.
+        const __m128i src_low = _mm_srai_epi32(_mm_unpacklo_epi16(src_samples, src_samples), 16);
+        const __m128i src_high = _mm_srai_epi32(_mm_unpackhi_epi16(src_samples, src_samples), 16);
+        const __m128i scaled_low = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(src_low), volumes));
+        const __m128i scaled_high = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(src_high), volumes));
+
+        const __m128i mixed_low = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(dest_samples, dest_samples), 16), scaled_low);
+        const __m128i mixed_high = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(dest_samples, dest_samples), 16), scaled_high);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&dest[i]), _mm_packs_epi32(mixed_low, mixed_high));
+    }
+#elif defined(NGS_MIX_NEON)
+    const float right_volume = (patch.dest_channels == 2) ? patch.volume_matrix[1][1] : patch.volume_matrix[0][0];
+    const float volume_values[] = { patch.volume_matrix[0][0], right_volume, patch.volume_matrix[0][0], right_volume };
+    const float32x4_t volumes = vld1q_f32(volume_values);
+    for (; i + 8 <= sample_count; i += 8) {
+        const int16x8_t src_samples = vld1q_s16(&src[i]);
+        const int16x8_t dest_samples = vld1q_s16(&dest[i]);
+
+        const int32x4_t scaled_low = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(src_samples))), volumes));
+        const int32x4_t scaled_high = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(src_samples))), volumes));
+
+        const int32x4_t mixed_low = vaddq_s32(vmovl_s16(vget_low_s16(dest_samples)), scaled_low);
+        const int32x4_t mixed_high = vaddq_s32(vmovl_s16(vget_high_s16(dest_samples)), scaled_high);
+        vst1q_s16(&dest[i], vcombine_s16(vqmovn_s32(mixed_low), vqmovn_s32(mixed_high)));
+    }
+#endif
+
+    return i;
 }
 
 std::int32_t VoiceInputManager::receive(ngs::Patch *patch, const std::uint8_t **data) {
-    PCMInput *input = get_input_buffer_queue(patch->dest_index);
+    std::uint8_t *input = get_input_buffer(patch->dest_index);
 
     if (!input) {
         return -1;
     }
 
-    std::int16_t *dest_buffer = reinterpret_cast<std::int16_t *>(input->data());
+    const std::lock_guard<std::mutex> guard(lock);
+    std::int16_t *dest_buffer = reinterpret_cast<std::int16_t *>(input);
     const std::int16_t *data_to_mix_in = reinterpret_cast<const std::int16_t *>(*data);
 
+    const std::int32_t granularity = patch->dest->rack->system->granularity;
+    std::int32_t first_frame = 0;
+
+    if (patch->output_channels == patch->dest_channels) {
+        const std::size_t sample_count = static_cast<std::size_t>(granularity) * patch->dest_channels;
+        first_frame = static_cast<std::int32_t>(mix_same_channels(dest_buffer, data_to_mix_in, sample_count, *patch) / patch->dest_channels);
+    }
+
     // Try mixing, also with the use of this volume matrix
     // Dest is our voice to receive this data.
-    for (std::int32_t k = 0; k < patch->dest->rack->system->granularity; k++) {
+    for (std::int32_t k = first_frame; k < granularity; k++) {
         // General mixing case, pretty straight foward
         for (std::uint8_t i = 0; i < patch->dest_channels; i++) {
             std::int32_t sample_to_be_mixed = static_cast<std::int32_t>(data_to_mix_in[k * patch->output_channels + i]
@@ -85,7 +154,7 @@ std::int32_t VoiceInputManager::receive(ngs::Patch *patch, const std::uint8_t **
     return 0;
 }
 
-void Voice::init(Rack *mama) {
+bool Voice::init(const MemState &mem, Rack *mama) {
     rack = mama;
     state = VoiceState::VOICE_STATE_AVAILABLE;
     flags = 0;
@@ -94,12 +163,21 @@ void Voice::init(Rack *mama) {
     for (std::uint32_t i = 0; i < MAX_OUTPUT_PORT; i++)
         patches[i].resize(mama->patches_per_output);
 
-    inputs.init(rack->system->granularity, 1);
-    voice_lock = std::make_unique<std::mutex>();
+    voice_state_size = get_voice_slot_size(rack->system->granularity);
+    const Ptr<std::uint8_t> state_space = rack->alloc_raw(voice_state_size).cast<std::uint8_t>();
+
+    if (!state_space) {
+        return false;
+    }
+
+    voice_state_data = state_space.get(mem);
+    std::memset(voice_state_data, 0, voice_state_size);
+
+    return inputs.init(mem, rack, VOICE_INPUT_COUNT);
 }
 
 BufferParamsInfo *Voice::lock_params(const MemState &mem) {
-    const std::lock_guard<std::mutex> guard(*voice_lock);
+    const std::lock_guard<std::mutex> guard(voice_lock);
 
     // Save a copy of previous set of data
     if (flags & PARAMS_LOCK) {
@@ -118,13 +196,13 @@ BufferParamsInfo *Voice::lock_params(const MemState &mem) {
 }
 
 bool Voice::unlock_params() {
-    const std::lock_guard<std::mutex> guard(*voice_lock);
+    const std::lock_guard<std::mutex> guard(voice_lock);
 
     if (flags & PARAMS_LOCK) {
         flags &= ~PARAMS_LOCK;
 
         // Reset the state, empty them out
-        voice_state_data.clear();
+        std::memset(voice_state_data, 0, voice_state_size);
         return true;
     }
 
@@ -132,7 +210,7 @@ bool Voice::unlock_params() {
 }
 
 Ptr<Patch> Voice::patch(const MemState &mem, const std::int32_t index, std::int32_t subindex, std::int32_t dest_index, Voice *dest) {
-    const std::lock_guard<std::mutex> guard(*voice_lock);
+    const std::lock_guard<std::mutex> guard(voice_lock);
 
     if (index >= MAX_OUTPUT_PORT) {
         // We don't have enough port for you!
@@ -193,7 +271,7 @@ Ptr<Patch> Voice::patch(const MemState &mem, const std::int32_t index, std::int3
 }
 
 bool Voice::remove_patch(const MemState &mem, const Ptr<Patch> patch) {
-    const std::lock_guard<std::mutex> guard(*voice_lock);
+    const std::lock_guard<std::mutex> guard(voice_lock);
     for (std::uint8_t i = 0; i < patches.size(); i++) {
         auto iterator = std::find(patches[i].begin(), patches[i].end(), patch);
 
@@ -218,12 +296,15 @@ std::uint32_t System::get_required_memspace_size(SystemInitParameters *parameter
     return sizeof(System);
 }
 
-std::uint32_t Rack::get_required_memspace_size(MemState &mem, RackDescription *description) {
+std::uint32_t Rack::get_required_memspace_size(MemState &mem, const System *system, RackDescription *description) {
     uint32_t buffer_size = 0;
     if (description->definition)
         buffer_size = static_cast<std::uint32_t>(description->definition.get(mem)->get_buffer_parameter_size() * description->voice_count);
 
-    return sizeof(ngs::Rack) + description->voice_count * sizeof(ngs::Voice) + buffer_size + description->patches_per_output * MAX_OUTPUT_PORT * description->voice_count * sizeof(ngs::Patch);
+    // State and inputs of every voice
+    const uint32_t voice_slots_size = description->voice_count * (VOICE_INPUT_COUNT + 1) * get_voice_slot_size(system->granularity);
+
+    return sizeof(ngs::Rack) + description->voice_count * sizeof(ngs::Voice) + buffer_size + voice_slots_size + description->patches_per_output * MAX_OUTPUT_PORT * description->voice_count * sizeof(ngs::Patch);
 }
 
 bool init(State &ngs, MemState &mem) {
@@ -292,8 +373,10 @@ bool init_rack(State &ngs, const MemState &mem, System *system, BufferParamsInfo
             return false;
         }
 
-        Voice *v = voice.get(mem);
-        v->init(rack);
+        Voice *v = new (voice.get(mem)) Voice();
+        if (!v->init(mem, rack)) {
+            return false;
+        }
 
         // Allocate parameter buffer info for each voice
         if (description->definition)
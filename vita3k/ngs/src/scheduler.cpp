@@ -2,8 +2,20 @@
 #include <ngs/system.h>
 
 #include <algorithm>
+#include <unordered_map>
 
 namespace ngs {
+VoiceScheduler::~VoiceScheduler() {
+    {
+        const std::lock_guard<std::mutex> guard(work_mutex);
+        quit = true;
+    }
+
+    work_available.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
 bool VoiceScheduler::deque_voice(Voice *voice) {
     const std::lock_guard<std::mutex> guard(lock);
     auto voice_in = std::find(queue.begin(), queue.end(), voice);
@@ -13,6 +25,7 @@ bool VoiceScheduler::deque_voice(Voice *voice) {
     }
 
     queue.erase(voice_in);
+    levels_dirty = true;
     return true;
 }
 
@@ -29,28 +42,9 @@ bool VoiceScheduler::play(const MemState &mem, Voice *voice) {
     }
 
     if (should_enqueue) {
-        std::int32_t lowest_dest_pos = static_cast<std::int32_t>(queue.size());
-
-        // Check its dependencies position
-        for (std::uint8_t i = 0; i < voice->patches.size(); i++) {
-            for (const auto &patch : voice->patches[i]) {
-                if (!patch) {
-                    continue;
-                }
-
-                Voice *dest = patch.get(mem)->dest;
-                const std::int32_t pos = get_position(dest);
-
-                if (pos == -1) {
-                    continue;
-                }
-
-                lowest_dest_pos = std::min<std::int32_t>(lowest_dest_pos, pos);
-            }
-        }
-
         const std::lock_guard<std::mutex> guard(lock);
-        queue.insert(queue.begin() + lowest_dest_pos, voice);
+        queue.push_back(voice);
+        levels_dirty = true;
     }
 
     return true;
@@ -84,72 +78,162 @@ bool VoiceScheduler::stop(Voice *voice) {
     return true;
 }
 
-void VoiceScheduler::update(const MemState &mem) {
-    const std::lock_guard<std::mutex> guard(lock);
+void VoiceScheduler::rebuild_levels(const MemState &mem) {
+    levels.clear();
+    levels_dirty = false;
 
-    // Do a first routine to clear inputs from previous update session
-    for (ngs::Voice *voice : queue) {
-        voice->inputs.reset_inputs();
+    std::unordered_map<const Voice *, size_t> indices;
+    for (size_t i = 0; i < queue.size(); i++) {
+        indices.emplace(queue[i], i);
     }
 
-    for (ngs::Voice *voice : queue) {
-        voice->state = ngs::VOICE_STATE_ACTIVE;
+    // Edges go from every voice to the queued voices it is patched into.
+    std::vector<std::vector<size_t>> dests(queue.size());
+    std::vector<size_t> source_counts(queue.size(), 0);
+    for (size_t i = 0; i < queue.size(); i++) {
+        for (const Voice::Patches &patches : queue[i]->patches) {
+            for (const Ptr<Patch> &patch : patches) {
+                if (!patch || patch.get(mem)->output_sub_index == -1) {
+                    continue;
+                }
+
+                const auto dest = indices.find(patch.get(mem)->dest);
+                if (dest == indices.end() || dest->second == i) {
+                    continue;
+                }
+
+                dests[i].push_back(dest->second);
+                source_counts[dest->second]++;
+            }
+        }
+    }
+
+    // Kahn's algorithm, one level at a time. Voices of a rack keep their queue order.
+    std::vector<size_t> current;
+    std::vector<size_t> next;
+    for (size_t i = 0; i < queue.size(); i++) {
+        if (source_counts[i] == 0) {
+            current.push_back(i);
+        }
+    }
+
+    size_t sorted_count = 0;
+    while (!current.empty()) {
+        std::sort(current.begin(), current.end());
+
+        VoiceLevel &level = levels.emplace_back();
+        for (const size_t i : current) {
+            const auto group = std::find_if(level.begin(), level.end(), [&](const VoiceGroup &group) {
+                return group.front()->rack == queue[i]->rack;
+            });
+
+            if (group == level.end()) {
+                level.push_back({ queue[i] });
+            } else {
+                group->push_back(queue[i]);
+            }
+
+            for (const size_t dest : dests[i]) {
+                if (--source_counts[dest] == 0) {
+                    next.push_back(dest);
+                }
+            }
+        }
+
+        sorted_count += current.size();
+        current.swap(next);
+        next.clear();
+    }
+
+    if (sorted_count < queue.size()) {
+        // Voices patched in a loop can't be ordered, process them last one after another.
+        VoiceGroup &group = levels.emplace_back().emplace_back();
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (source_counts[i] != 0) {
+                group.push_back(queue[i]);
+            }
+        }
+    }
+}
+
+static void process_group(const MemState &mem, const VoiceGroup &group) {
+    for (ngs::Voice *voice : group) {
         voice->rack->module->process(mem, voice);
     }
 }
 
-std::int32_t VoiceScheduler::get_position(Voice *v) {
-    const std::lock_guard<std::mutex> guard(lock);
-    auto result = std::find(queue.begin(), queue.end(), v);
+void VoiceScheduler::work() {
+    std::unique_lock<std::mutex> guard(work_mutex);
+    while (!quit) {
+        if (!work_level || next_group == work_level->size()) {
+            work_available.wait(guard);
+            continue;
+        }
 
-    if (result != queue.end()) {
-        return static_cast<std::int32_t>(std::distance(queue.begin(), result));
-    }
+        const VoiceGroup &group = (*work_level)[next_group++];
+        const MemState &mem = *work_mem;
+        guard.unlock();
+        process_group(mem, group);
+        guard.lock();
 
-    return -1;
+        if (--groups_left == 0) {
+            level_done.notify_one();
+        }
+    }
 }
 
-bool VoiceScheduler::resort_to_respect_dependencies(const MemState &mem, Voice *source) {
-    // Get my position
-    std::int32_t position = get_position(source);
+void VoiceScheduler::process_level(const MemState &mem, const VoiceLevel &level) {
+    if (level.size() == 1) {
+        process_group(mem, level.front());
+        return;
+    }
 
-    if (position == -1) {
-        return false;
+    if (workers.empty()) {
+        const size_t worker_count = std::min<size_t>(std::thread::hardware_concurrency(), 4);
+        for (size_t i = 1; i < worker_count; i++) {
+            workers.emplace_back(&VoiceScheduler::work, this);
+        }
     }
 
-    // Check all dependencies, could be optimized- @sunho suggested dfs topological sort
-    for (size_t i = 0; i < source->patches.size(); i++) {
-        for (const auto &patch : source->patches[i]) {
-            if (!patch) {
-                continue;
-            }
+    std::unique_lock<std::mutex> guard(work_mutex);
+    work_level = &level;
+    work_mem = &mem;
+    next_group = 0;
+    groups_left = level.size();
+    work_available.notify_all();
+
+    // Take groups too rather than sit idle.
+    while (next_group < level.size()) {
+        const VoiceGroup &group = level[next_group++];
+        guard.unlock();
+        process_group(mem, group);
+        guard.lock();
+        groups_left--;
+    }
 
-            Voice *dest = patch.get(mem)->dest;
-            const std::int32_t dest_pos = get_position(dest);
+    level_done.wait(guard, [this] { return groups_left == 0; });
+    work_level = nullptr;
+}
 
-            if (position == -1) {
-                // Maybe not scheduled yet. Continue
-                continue;
-            }
+void VoiceScheduler::update(const MemState &mem) {
+    const std::lock_guard<std::mutex> guard(lock);
 
-            if (dest_pos < position) {
-                // Switch to the end. Resort dependencies for this one that just got sorted too.
-                {
-                    const std::lock_guard<std::mutex> guard(lock);
-                    std::rotate(queue.begin() + dest_pos, queue.begin() + dest_pos + 1, queue.end());
-                }
+    if (levels_dirty) {
+        rebuild_levels(mem);
+    }
 
-                resort_to_respect_dependencies(mem, dest);
-                position = get_position(source);
-            }
-        }
+    // Do a first routine to clear inputs from previous update session
+    for (ngs::Voice *voice : queue) {
+        voice->inputs.reset_inputs();
+        voice->state = ngs::VOICE_STATE_ACTIVE;
     }
 
-    return true;
+    for (const VoiceLevel &level : levels) {
+        process_level(mem, level);
+    }
 }
 
 Ptr<Patch> VoiceScheduler::patch(const MemState &mem, PatchSetupInfo *info) {
-    // First, check if these two voices are scheduled yet
     Voice *source = info->source.get(mem);
     Voice *dest = info->dest.get(mem);
 
@@ -159,15 +243,8 @@ Ptr<Patch> VoiceScheduler::patch(const MemState &mem, PatchSetupInfo *info) {
         return patch;
     }
 
-    const std::int32_t source_pos = get_position(source);
-    const std::int32_t dest_pos = get_position(dest);
-
-    if (source_pos == -1 || dest_pos == -1) {
-        // Later
-        return patch;
-    }
-
-    resort_to_respect_dependencies(mem, source);
+    const std::lock_guard<std::mutex> guard(lock);
+    levels_dirty = true;
     return patch;
 }
 } // namespace ngs
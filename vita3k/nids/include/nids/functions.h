@@ -3,3 +3,6 @@
 #include <cstdint>
 
 const char *import_name(uint32_t nid);
+
+// Position of a function NID among the NID() entries of nids.h, -1 if it has none.
+int32_t import_index(uint32_t nid);
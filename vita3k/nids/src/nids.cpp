@@ -6,6 +6,14 @@
 #undef NID
 #undef VAR_NID
 
+enum ImportIndex : int32_t {
+#define VAR_NID(name, nid)
+#define NID(name, nid) import_index_##name,
+#include <nids/nids.h>
+#undef NID
+#undef VAR_NID
+};
+
 const char *import_name(uint32_t nid) {
     switch (nid) {
 #define VAR_NID(name, nid) \
@@ -21,3 +29,17 @@ const char *import_name(uint32_t nid) {
         return "UNRECOGNISED";
     }
 }
+
+int32_t import_index(uint32_t nid) {
+    switch (nid) {
+#define VAR_NID(name, nid)
+#define NID(name, nid) \
+    case nid:          \
+        return import_index_##name;
+#include <nids/nids.h>
+#undef NID
+#undef VAR_NID
+    default:
+        return -1;
+    }
+}
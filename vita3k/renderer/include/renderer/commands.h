@@ -70,7 +70,12 @@ enum class CommandOpcode : std::uint16_t {
          */
     SignalSyncObject = 9,
 
-    DestroyRenderTarget = 10
+    DestroyRenderTarget = 10,
+
+    /**
+         * Hand a staging buffer back to the client once nothing reads from it anymore.
+         */
+    FenceStaging = 11
 };
 
 enum CommandErrorCode {
@@ -89,8 +94,6 @@ struct Command {
     Command *next;
 };
 
-using CommandPool = std::vector<Command>;
-
 // This somehow looks like vulkan
 // It's to split a command list easier when ExecuteCommandList is used.
 struct CommandList {
@@ -152,9 +155,15 @@ bool do_command_push_data(CommandHelper &helper, Head arg1, Args... args2) {
     return true;
 }
 
+// Command nodes are recycled instead of going back to the heap. Each recording thread takes
+// nodes from its own free list, which refills in bulk from a shared pool that process_batch
+// returns whole command lists to.
+Command *alloc_command();
+void free_commands(Command *first, Command *last);
+
 template <typename... Args>
 Command *make_command(const CommandOpcode opcode, int *status, Args... arguments) {
-    Command *new_command = new Command;
+    Command *new_command = alloc_command();
     new_command->opcode = opcode;
     new_command->status = status;
     new_command->next = nullptr;
@@ -163,7 +172,7 @@ Command *make_command(const CommandOpcode opcode, int *status, Args... arguments
 
     if constexpr (sizeof...(arguments) > 0) {
         if (!do_command_push_data(helper, arguments...)) {
-            delete new_command;
+            free_commands(new_command, new_command);
             return nullptr;
         }
     }
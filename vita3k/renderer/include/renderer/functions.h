@@ -8,7 +8,7 @@ struct MemState;
 struct FeatureState;
 struct Config;
 
-typedef uint32_t TextureCacheHash;
+typedef uint64_t TextureCacheHash;
 
 namespace renderer {
 struct Context;
@@ -39,12 +39,36 @@ void subject_done(SceGxmSyncObject *sync_object, const SyncObjectSubject subject
 void subject_in_progress(SceGxmSyncObject *sync_object, const SyncObjectSubject subjects);
 
 int wait_for_status(State &state, int *result_code);
+
+/**
+ * \brief Get memory that stays valid until the renderer has processed the current scene.
+ * \param host_read The renderer reads the data on the CPU rather than handing it to the GPU.
+ */
+void *alloc_staging(Context &context, std::size_t size, bool host_read = false);
+
+/**
+ * \brief Queue the fences that hand the current scene's staging memory back once it is processed.
+ */
+void fence_staging(Context &context);
+
 void reset_command_list(CommandList &command_list);
 void submit_command_list(State &state, renderer::Context *context, GxmContextState *gxm_context_state, CommandList &command_list);
 void process_batch(State &state, MemState &mem, Config &config, CommandList &command_list, const char *base_path, const char *title_id);
 void process_batches(State &state, const FeatureState &features, MemState &mem, Config &config, const char *base_path, const char *title_id);
 bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend);
 
+/**
+ * \brief Restore the linked programs cached on disk for a title, and keep caching new ones.
+ */
+void prewarm_program_cache(State &state, const char *pref_path, const char *title_id);
+
+/**
+ * \brief Pick what draws do while their shaders are translated and linked, and start translating them in the background if they don't wait.
+ *
+ * The title's entry in the title shader compile policies, written "<title id>:<policy>", takes precedence over the default policy.
+ */
+void init_shader_compiler(State &state, const Config &cfg, const char *title_id);
+
 /**
  * \brief Copy uniform data and queue it to available command list.
  * 
@@ -135,13 +159,26 @@ int send_single_command(State &state, Context *ctx, GxmContextState *gxm_state,
 bool sync_state(State &state, Context &context, const MemState &mem);
 
 struct TextureCacheState;
+struct TextureDecodeJob;
+struct TextureDecodeState;
 
 namespace texture {
 
+// Instruction sets the palette and block compression decoders are built for.
+enum class DecoderIsa {
+    Scalar,
+    AVX2,
+};
+
+// The best instruction set supported by the host is used by default. Returns false if the host does not support it.
+bool set_decoder_isa(DecoderIsa isa);
+DecoderIsa get_decoder_isa();
+
 // Paletted textures.
 void palette_texture_to_rgba_4(uint32_t *dst, const uint8_t *src, size_t width, size_t height, const uint32_t *palette);
 void palette_texture_to_rgba_8(uint32_t *dst, const uint8_t *src, size_t width, size_t height, const uint32_t *palette);
-void yuv420_texture_to_rgb(uint8_t *dst, const uint8_t *src, size_t width, size_t height);
+// Any YUV420 or YUV422 format. Safe to call from several threads at once.
+void yuv_texture_to_rgba(uint8_t *dst, const uint8_t *src, size_t width, size_t height, SceGxmTextureFormat format);
 const uint32_t *get_texture_palette(const SceGxmTexture &texture, const MemState &mem);
 
 /**
@@ -165,6 +202,17 @@ size_t bits_per_pixel(SceGxmTextureBaseFormat base_format);
 bool is_compressed_format(SceGxmTextureBaseFormat base_format, std::uint32_t width, std::uint32_t height, size_t &source_size);
 TextureCacheHash hash_texture_data(const SceGxmTexture &texture, const MemState &mem);
 
+// Texture decoding.
+bool can_texture_be_unswizzled_without_decode(SceGxmTextureBaseFormat fmt);
+// Lays out the mips of the texture in the job. Returns false if they can be uploaded straight from guest memory.
+bool prepare_texture_decode(TextureDecodeJob &job, const SceGxmTexture &texture, const MemState &mem);
+void decode_texture_mip(TextureDecodeJob &job, size_t mip_index);
+bool init(TextureDecodeState &state, size_t worker_count);
+std::shared_ptr<TextureDecodeJob> create_texture_decode_job(TextureDecodeState &state);
+void submit_texture_decode(TextureDecodeState &state, const std::shared_ptr<TextureDecodeJob> &job);
+void take_decoded_textures(TextureDecodeState &state, std::vector<std::shared_ptr<TextureDecodeJob>> &jobs);
+void recycle_texture_decode_job(TextureDecodeState &state, TextureDecodeJob &job);
+
 } // namespace texture
 
 } // namespace renderer
@@ -36,20 +36,27 @@ struct FeatureState;
 namespace renderer::gl {
 
 // Compile program.
-SharedGLObject compile_program(ProgramCache &program_cache, ShaderCache &vertex_cache, ShaderCache &fragment_cache,
-    const GxmContextState &state, const FeatureState &features, const MemState &mem, bool maskupdate, const char *base_path, const char *title_id);
+// Sets pending if the program is still being translated or linked, the result is then null or a stand-in.
+SharedGLProgram compile_program(GLState &renderer, const GxmContextState &state, const FeatureState &features, const MemState &mem,
+    bool maskupdate, const char *base_path, const char *title_id, bool &pending);
+void prewarm_program_cache(GLState &renderer, const char *pref_path, const char *title_id);
+void init_shader_compiler(GLState &renderer, ShaderCompilePolicy policy);
 
 // Shaders.
 std::string load_shader(const SceGxmProgram &program, const FeatureState &features, bool maskupdate, const char *base_path, const char *title_id);
 
+// Shader translation.
+bool init_shader_translator(ShaderTranslateState &state, size_t worker_count);
+void submit_shader_translate(ShaderTranslateState &state, const ShaderTranslateJobPtr &job);
+void take_translated_shaders(ShaderTranslateState &state, ShaderTranslateJobs &jobs);
+
 // Uniforms.
-bool set_uniform(GLuint program, const SceGxmProgram &shader_program, GLShaderStatics &statics, const MemState &mem,
-    const SceGxmProgramParameter *parameter, const void *data, bool log_uniforms);
+bool set_uniform(const UniformLocation &uniform, const SceGxmProgramParameter &parameter, const void *data, bool log_uniforms);
 
 bool set_uniform_buffer(GLContext &context, const bool vertex_shader, const int block_num, const int size, const void *data, bool log_active_shader);
 
 bool create(SDL_Window *window, std::unique_ptr<renderer::State> &state);
-bool create(std::unique_ptr<Context> &context);
+bool create(std::unique_ptr<Context> &context, GLState &state);
 bool create(std::unique_ptr<RenderTarget> &rt, const SceGxmRenderTargetParams &params, const FeatureState &features);
 bool create(std::unique_ptr<FragmentProgram> &fp, GLState &state, const SceGxmProgram &program, const SceGxmBlendInfo *blend, GXPPtrMap &gxp_ptr_map, const char *base_path, const char *title_id);
 bool create(std::unique_ptr<VertexProgram> &vp, GLState &state, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map, const char *base_path, const char *title_id);
@@ -61,22 +68,26 @@ void draw(GLState &renderer, GLContext &context, GxmContextState &state, const F
     const void *indices, size_t count, const MemState &mem, const char *base_path, const char *title_id,
     const bool log_active_shaders, const bool log_uniforms, const bool do_hardware_flip, const bool texture_cache);
 
+// Returns false if data was not allocated from the context's persistently mapped staging memory.
+bool get_staging_offset(const GLContext &context, const void *data, GLintptr &offset);
 void upload_vertex_stream(GLContext &context, const std::size_t stream_index, const std::size_t length, const void *data);
+void fence_staging_buffer(GLContext &context, renderer::StagingBuffer &buffer);
+void poll_staging_fences(GLContext &context);
 
 // State
 void sync_viewport(GLContext &context, const GxmContextState &state, const bool hardware_flip);
 void sync_clipping(GLContext &context, const GxmContextState &state, const bool hardware_flip);
 void sync_cull(GLContext &context, const GxmContextState &state);
-void sync_front_depth_func(const GxmContextState &state);
-void sync_front_depth_write_enable(const GxmContextState &state);
-bool sync_depth_data(const GxmContextState &state);
-bool sync_stencil_data(const GxmContextState &state, const MemState &mem);
-void sync_stencil_func(const GxmContextState &state, const MemState &mem, bool is_back_stencil);
+void sync_front_depth_func(GLContext &context, const GxmContextState &state);
+void sync_front_depth_write_enable(GLContext &context, const GxmContextState &state);
+bool sync_depth_data(GLContext &context, const GxmContextState &state);
+bool sync_stencil_data(GLContext &context, const GxmContextState &state, const MemState &mem);
+void sync_stencil_func(GLContext &context, const GxmContextState &state, const MemState &mem, bool is_back_stencil);
 void sync_mask(GLContext &context, const GxmContextState &state, const MemState &mem);
-void sync_front_polygon_mode(const GxmContextState &state);
-void sync_front_point_line_width(const GxmContextState &state);
-void sync_front_depth_bias(const GxmContextState &state);
-void sync_blending(const GxmContextState &state, const MemState &mem);
+void sync_front_polygon_mode(GLContext &context, const GxmContextState &state);
+void sync_front_point_line_width(GLContext &context, const GxmContextState &state);
+void sync_front_depth_bias(GLContext &context, const GxmContextState &state);
+void sync_blending(GLContext &context, const GxmContextState &state, const MemState &mem);
 void sync_texture(GLContext &context, const GxmContextState &state, const MemState &mem, std::size_t index,
     bool enable_texture_cache, const std::string &base_path, const std::string &title_id);
 void sync_vertex_attributes(GLContext &context, const GxmContextState &state, const MemState &mem);
@@ -90,6 +101,40 @@ size_t attribute_format_size(SceGxmAttributeFormat format);
 GLenum attribute_format_to_gl_type(SceGxmAttributeFormat format);
 GLboolean attribute_format_normalised(SceGxmAttributeFormat format);
 
+namespace state_cache {
+
+// Forgets what the driver was told, for when something else may have used the GL context since.
+// Texture binds are queued again so draws still find their textures.
+void invalidate(GLStateCache &cache);
+
+void use_program(GLStateCache &cache, GLuint program);
+void set_capability(GLStateCache &cache, GLenum capability, bool enabled);
+void set_color_mask(GLStateCache &cache, GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void set_blend_equation(GLStateCache &cache, GLenum color, GLenum alpha);
+void set_blend_func(GLStateCache &cache, GLenum color_src, GLenum color_dst, GLenum alpha_src, GLenum alpha_dst);
+void set_depth_func(GLStateCache &cache, GLenum func);
+void set_depth_mask(GLStateCache &cache, GLboolean mask);
+void set_cull_face(GLStateCache &cache, GLenum mode);
+void set_stencil_op(GLStateCache &cache, GLenum face, GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass);
+void set_stencil_func(GLStateCache &cache, GLenum face, GLenum func, GLint ref, GLuint compare_mask);
+void set_stencil_write_mask(GLStateCache &cache, GLenum face, GLuint mask);
+void set_polygon_mode(GLStateCache &cache, GLenum mode);
+void set_line_width(GLStateCache &cache, GLfloat width);
+void set_point_size(GLStateCache &cache, GLfloat size);
+void set_polygon_offset(GLStateCache &cache, GLfloat factor, GLfloat units);
+void set_viewport(GLStateCache &cache, GLfloat x, GLfloat y, GLfloat w, GLfloat h);
+void set_depth_range(GLStateCache &cache, GLdouble near_val, GLdouble far_val);
+void set_scissor(GLStateCache &cache, GLint x, GLint y, GLsizei w, GLsizei h);
+void set_active_texture(GLStateCache &cache, GLuint unit);
+
+// Binds at the next flush, a later bind to the same unit replaces this one.
+void queue_texture_bind(GLStateCache &cache, GLuint unit, GLuint texture);
+// Binds right away and makes the unit active, for textures about to be configured or uploaded to.
+void bind_texture_now(GLStateCache &cache, GLuint unit, GLuint texture);
+void flush_texture_binds(GLStateCache &cache);
+
+} // namespace state_cache
+
 namespace texture {
 
 // Textures.
@@ -108,6 +153,9 @@ size_t bits_per_pixel(SceGxmTextureBaseFormat base_format);
 
 // Texture cache.
 bool init(GLTextureCacheState &cache);
+// Decodes the texture on the worker threads and uploads it to the slot later. Returns false if there is nothing to decode.
+bool queue_texture_upload(GLTextureCacheState &cache, std::size_t index, const SceGxmTexture &gxm_texture, const MemState &mem);
+void upload_decoded_textures(GLTextureCacheState &cache);
 void dump(const SceGxmTexture &gxm_texture, const MemState &mem, const std::string &name, const std::string &base_path, const std::string &title_id, Sha256Hash hash);
 
 } // namespace texture
@@ -26,6 +26,7 @@
 #include <SDL.h>
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,23 @@ struct GLState : public renderer::State {
     ShaderCache fragment_shader_cache;
     ShaderCache vertex_shader_cache;
     ProgramCache program_cache;
+
+    // Programs restored from the on-disk binary cache, waiting for their first use to redo the
+    // per-program binding setup and location lookups before moving to program_cache.
+    ProgramCache preloaded_programs;
+    std::string program_binary_path; // Empty when the on-disk program cache is disabled.
+    std::set<std::string> unloaded_program_binaries; // File names left on disk by the prewarm limits, loaded on first use.
+    ProgramBinaryWriterState program_binary_writer;
+    Sha256Hash driver_id = {};
+
+    ShaderCompilePolicy shader_compile_policy = ShaderCompilePolicy::Sync;
+    ShaderTranslateState shader_translator; // Only has workers if draws don't wait for their programs.
+    PendingShaders pending_shaders; // By hash, of both stages.
+    PendingPrograms pending_programs;
+    std::map<std::string, SharedGLProgram> fallback_programs; // Last program linked with each vertex shader.
+
+    GLStateCounters state_counters; // Of the frame being processed.
+    GLStateCounters last_frame_state_counters;
 };
 
 } // namespace renderer::gl
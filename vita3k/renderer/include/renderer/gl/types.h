@@ -18,15 +18,23 @@
 #pragma once
 
 #include <crypto/hash.h>
+#include <features/state.h>
 #include <glutil/object.h>
 #include <glutil/object_array.h>
 #include <renderer/types.h>
 
 #include <renderer/texture_cache_state.h>
+#include <renderer/texture_decode_state.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -37,34 +45,182 @@ typedef std::unique_ptr<void, std::function<void(SDL_GLContext)>> GLContextPtr;
 struct SceGxmProgramParameter;
 
 namespace renderer::gl {
-struct ExcludedUniform {
-    std::string name;
-    GLuint program;
+// Where a gxp uniform parameter lives in a linked program.
+struct UniformLocation {
+    GLint location = -1; // -1 if the shader compiler optimized it away.
+    bool is_matrix = false;
 };
 
-inline bool operator==(const ExcludedUniform &lhs, const ExcludedUniform &rhs) {
-    return (lhs.name == rhs.name) && (lhs.program == rhs.program);
-}
+// Indexed like the parameters of the gxp program.
+typedef std::vector<UniformLocation> UniformLocations;
 
+// A linked program, with the locations of everything set on it per draw resolved once at link time.
+struct GLProgram {
+    SharedGLObject program;
+
+    GLint color_attachment_location = -1;
+    GLint mask_location = -1;
+    GLint flip_vec_location = -1;
+
+    // Only resolved when uniforms are not set through uniform buffers.
+    UniformLocations vertex_uniforms;
+    UniformLocations fragment_uniforms;
+};
+
+typedef std::shared_ptr<GLProgram> SharedGLProgram;
 typedef std::map<GLuint, std::string> AttributeLocations;
 typedef std::map<std::string, SharedGLObject> ShaderCache;
 typedef std::tuple<std::string, std::string> ProgramHashes;
-typedef std::map<ProgramHashes, SharedGLObject> ProgramCache;
-typedef std::vector<ExcludedUniform> ExcludedUniforms; // vector instead of unordered_set since it's much faster for few elements
-typedef std::map<GLuint, GLenum> UniformTypes;
+typedef std::map<ProgramHashes, SharedGLProgram> ProgramCache;
+
+// GLSL translation of one gxp shader, done on the shader translation workers.
+struct ShaderTranslateJob {
+    std::string hash;
+    GLenum type = GL_VERTEX_SHADER;
+    std::vector<uint8_t> gxp; // Copied, the guest may free its program before the translation is done.
+    FeatureState features;
+    bool maskupdate = false;
+    std::string base_path;
+    std::string title_id;
+    std::string glsl;
+};
+
+typedef std::shared_ptr<ShaderTranslateJob> ShaderTranslateJobPtr;
+typedef std::vector<ShaderTranslateJobPtr> ShaderTranslateJobs;
+
+// Worker threads that translate shaders to GLSL. Compiling and linking stays on the render thread.
+struct ShaderTranslateState {
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<ShaderTranslateJobPtr> queue;
+    ShaderTranslateJobs done;
+    std::atomic<size_t> done_count{ 0 };
+    std::vector<std::thread> workers;
+    bool quit = false;
+
+    ShaderTranslateState() = default;
+    ShaderTranslateState(const ShaderTranslateState &) = delete;
+    ShaderTranslateState &operator=(const ShaderTranslateState &) = delete;
+    ~ShaderTranslateState();
+};
+
+// Writes program binaries to the on-disk program cache, off the render thread.
+struct ProgramBinaryWriterState {
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<std::pair<std::string, std::vector<char>>> queue; // File contents by path.
+    std::thread worker;
+    bool quit = false;
+
+    ProgramBinaryWriterState() = default;
+    ProgramBinaryWriterState(const ProgramBinaryWriterState &) = delete;
+    ProgramBinaryWriterState &operator=(const ProgramBinaryWriterState &) = delete;
+    ~ProgramBinaryWriterState();
+};
+
+// A shader on its way to the shader cache of its stage.
+struct PendingShader {
+    GLenum type = GL_VERTEX_SHADER;
+    SharedGLObject shader; // Set once the GLSL is handed to the driver.
+};
+
+// A program waiting for its shaders, then for its link.
+struct PendingProgram {
+    AttributeLocations attribute_locations;
+    std::vector<uint8_t> vertex_gxp;
+    std::vector<uint8_t> fragment_gxp;
+    SharedGLObject program; // Set once the link is started.
+};
+
+typedef std::map<std::string, PendingShader> PendingShaders;
+typedef std::map<ProgramHashes, PendingProgram> PendingPrograms;
 
 struct UniformSetRequest {
     const SceGxmProgramParameter *parameter;
     const void *data;
 };
 
+// State calls sent to the driver and those dropped because they would not have changed anything.
+struct GLStateCounters {
+    uint64_t issued = 0;
+    uint64_t filtered = 0;
+};
+
+template <typename T>
+struct GLShadowed {
+    T value{};
+    bool known = false; // False until set through the cache, and again whenever something else may have changed it.
+};
+
+typedef std::tuple<GLenum, GLenum, GLenum> GLStencilOp;
+typedef std::tuple<GLenum, GLint, GLuint> GLStencilFunc;
+
+// What the driver was last told, indexed by face where it can differ between front and back.
+struct GLShadowState {
+    GLShadowed<GLuint> program;
+    GLShadowed<GLuint> active_texture_unit;
+    std::array<GLShadowed<GLuint>, SCE_GXM_MAX_TEXTURE_UNITS> textures;
+
+    GLShadowed<bool> blend;
+    GLShadowed<bool> cull_face;
+    GLShadowed<bool> depth_test;
+    GLShadowed<bool> stencil_test;
+    GLShadowed<bool> scissor_test;
+
+    GLShadowed<std::array<GLboolean, 4>> color_mask;
+    GLShadowed<std::array<GLenum, 2>> blend_equation;
+    GLShadowed<std::array<GLenum, 4>> blend_func;
+    GLShadowed<GLenum> depth_func;
+    GLShadowed<GLboolean> depth_mask;
+    GLShadowed<GLenum> cull_face_mode;
+    std::array<GLShadowed<GLStencilOp>, 2> stencil_op;
+    std::array<GLShadowed<GLStencilFunc>, 2> stencil_func;
+    std::array<GLShadowed<GLuint>, 2> stencil_write_mask;
+    GLShadowed<GLenum> polygon_mode;
+    GLShadowed<GLfloat> line_width;
+    GLShadowed<GLfloat> point_size;
+    GLShadowed<std::array<GLfloat, 2>> polygon_offset;
+    GLShadowed<std::array<GLfloat, 4>> viewport;
+    GLShadowed<std::array<GLdouble, 2>> depth_range;
+    GLShadowed<std::array<GLint, 4>> scissor;
+};
+
+// Sits between the renderer and the driver, dropping state changes that would not change anything.
+// Texture binds are held back until the next draw, so only the last bind of each unit is issued.
+struct GLStateCache {
+    GLShadowState shadow;
+    std::array<GLuint, SCE_GXM_MAX_TEXTURE_UNITS> pending_textures = {};
+    uint32_t pending_texture_units = 0; // Bit per unit with a bind waiting in pending_textures.
+    bool multi_bind = false; // Pending binds go out in one glBindTextures call.
+    GLStateCounters *counters = nullptr;
+};
+
 struct GLTextureCacheState : public renderer::TextureCacheState {
     GLObjectArray<TextureCacheSize> textures;
+    GLStateCache *state_cache = nullptr;
+    GLuint unit = 0; // Texture unit the selected slot is bound to.
+    renderer::TextureDecodeState decoder;
+    // Decode job whose pixels each slot is waiting for, 0 if none. Older jobs are dropped when they finish.
+    std::array<uint64_t, TextureCacheSize> pending_decodes = {};
+    // False from when a slot's storage is (re)allocated until its first upload. Such a slot has no contents
+    // to show while a decode is pending, so its upload is done synchronously.
+    std::array<bool, TextureCacheSize> has_contents = {};
+    uint64_t next_decode_id = 1;
+    renderer::TextureDecodeJobs decoded; // Reused by upload_decoded_textures.
 };
 
 struct GLRenderTarget;
 
+// Where the data of a vertex stream was uploaded for the current draw.
+struct VertexStreamBinding {
+    GLuint buffer = 0;
+    GLintptr offset = 0;
+};
+
+typedef std::vector<std::pair<renderer::StagingBuffer *, GLsync>> StagingFences;
+
 struct GLContext : public renderer::Context {
+    GLStateCache state_cache;
     GLTextureCacheState texture_cache;
     GLObjectArray<1> vertex_array;
     GLObjectArray<1> element_buffer;
@@ -74,7 +230,16 @@ struct GLContext : public renderer::Context {
     std::map<int, std::vector<uint8_t>> ubo_data;
 
     GLObjectArray<SCE_GXM_MAX_VERTEX_STREAMS> stream_vertex_buffers;
-    GLuint last_draw_program{ 0 };
+    std::array<VertexStreamBinding, SCE_GXM_MAX_VERTEX_STREAMS> stream_bindings;
+
+    // Persistently mapped, split into the staging buffers the GXM thread writes scene data into.
+    // Empty without buffer storage support, the data is then uploaded from heap staging buffers.
+    GLObjectArray<1> staging_buffer;
+    const std::uint8_t *staging_memory = nullptr;
+    std::size_t staging_memory_size = 0;
+    StagingFences staging_fences; ///< Oldest first.
+    SharedGLProgram last_draw_program;
+    bool last_draw_program_pending = false; // It stands in for a program that is not linked yet.
 
     float viewport_flip[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
@@ -84,13 +249,7 @@ struct GLContext : public renderer::Context {
     std::vector<UniformSetRequest> fragment_set_requests;
 };
 
-struct GLShaderStatics {
-    ExcludedUniforms excluded_uniforms;
-    UniformTypes uniform_types;
-};
-
 struct GLFragmentProgram : public renderer::FragmentProgram {
-    GLShaderStatics statics;
     GLboolean color_mask_red = GL_TRUE;
     GLboolean color_mask_green = GL_TRUE;
     GLboolean color_mask_blue = GL_TRUE;
@@ -105,7 +264,6 @@ struct GLFragmentProgram : public renderer::FragmentProgram {
 };
 
 struct GLVertexProgram : public renderer::VertexProgram {
-    GLShaderStatics statics;
     AttributeLocations attribute_locations;
 };
 
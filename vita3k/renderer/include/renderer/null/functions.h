@@ -0,0 +1,40 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <gxm/types.h>
+#include <renderer/null/state.h>
+#include <renderer/types.h>
+
+#include <chrono>
+#include <memory>
+
+namespace renderer::null {
+bool create(std::unique_ptr<State> &state);
+bool create(std::unique_ptr<Context> &context);
+bool create(std::unique_ptr<RenderTarget> &rt);
+bool create(std::unique_ptr<FragmentProgram> &fp, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map);
+bool create(std::unique_ptr<VertexProgram> &vp, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map);
+
+void record_command(NullState &state, CommandOpcode opcode, std::chrono::steady_clock::duration time);
+
+/**
+ * \brief Log how many commands of each opcode were processed, how long they took, and the draws per second.
+ */
+void log_command_stats(const NullState &state);
+} // namespace renderer::null
@@ -0,0 +1,42 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <renderer/commands.h>
+#include <renderer/state.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace renderer::null {
+// Commands of one opcode processed so far, and the time spent handling them.
+struct CommandStats {
+    std::atomic<std::uint64_t> count{ 0 };
+    std::atomic<std::uint64_t> nanoseconds{ 0 };
+};
+
+constexpr std::size_t COMMAND_OPCODE_COUNT = static_cast<std::size_t>(CommandOpcode::FenceStaging) + 1;
+
+// Consumes the command stream without a GPU, so the cost of the GXM front end can be measured on its own.
+struct NullState : public renderer::State {
+    std::array<CommandStats, COMMAND_OPCODE_COUNT> command_stats;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+};
+} // namespace renderer::null
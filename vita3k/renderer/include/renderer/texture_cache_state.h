@@ -6,28 +6,57 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <unordered_map>
 
 struct MemState;
 
 namespace renderer {
 constexpr size_t TextureCacheSize = KB(1);
-typedef uint64_t TextureCacheTimestamp;
-typedef uint32_t TextureCacheHash;
+constexpr size_t TextureCacheNoIndex = SIZE_MAX;
+typedef uint64_t TextureCacheHash;
+
+// Links of the least recently used list, threaded through the cache slots.
+struct TextureCacheLink {
+    size_t prev = TextureCacheNoIndex;
+    size_t next = TextureCacheNoIndex;
+};
+
+struct TextureCacheKeyHash {
+    size_t operator()(const SceGxmTexture &texture) const {
+        static_assert(sizeof(SceGxmTexture) == 2 * sizeof(uint64_t));
+        uint64_t words[2];
+        std::memcpy(words, &texture, sizeof(words));
+        uint64_t h = words[0] ^ (words[1] * 0x9E3779B185EBCA87ULL);
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+struct TextureCacheKeyEqual {
+    bool operator()(const SceGxmTexture &a, const SceGxmTexture &b) const {
+        return std::memcmp(&a, &b, sizeof(SceGxmTexture)) == 0;
+    }
+};
 
 typedef std::array<SceGxmTexture, TextureCacheSize> TextureCacheGxmTextures;
-typedef std::array<TextureCacheTimestamp, TextureCacheSize> TextureCacheTimestamps;
 typedef std::array<TextureCacheHash, TextureCacheSize> TextureCacheHashes;
+typedef std::array<TextureCacheLink, TextureCacheSize> TextureCacheLinks;
+typedef std::unordered_map<SceGxmTexture, size_t, TextureCacheKeyHash, TextureCacheKeyEqual> TextureCacheIndices;
 typedef std::function<void(std::size_t)> TextureCacheStateSelectCallback;
 typedef std::function<void(std::size_t, const void *)> TextureCacheStateConfigureTextureCallback;
 typedef std::function<void(std::size_t, const void *, const MemState &)> TextureCacheStateUploadTextureCallback;
 
 struct TextureCacheState {
     size_t used = 0;
-    TextureCacheTimestamp timestamp = 1;
+    size_t lru_head = TextureCacheNoIndex; // Most recently used slot.
+    size_t lru_tail = TextureCacheNoIndex; // Least recently used slot, evicted first.
     TextureCacheGxmTextures gxm_textures;
-    TextureCacheTimestamps timestamps;
     TextureCacheHashes hashes;
+    TextureCacheLinks lru_links;
+    TextureCacheIndices indices;
     TextureCacheStateSelectCallback select_callback;
     TextureCacheStateConfigureTextureCallback configure_texture_callback;
     TextureCacheStateUploadTextureCallback upload_texture_callback;
@@ -0,0 +1,93 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <gxm/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+// One mip level of a texture upload.
+struct TextureDecodeMip {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Size of the swizzled or tiled source. Arbitrary swizzled textures are padded to powers of two.
+    uint32_t decode_width = 0;
+    uint32_t decode_height = 0;
+    const uint8_t *source = nullptr;
+    size_t staging_offset = 0;
+    size_t pixels_per_stride = 0;
+    size_t compressed_size = 0; // Non-zero if the mip is uploaded in its block compressed form.
+    const void *pixels = nullptr; // What the backend uploads, either guest memory or the staging buffer.
+};
+
+typedef std::vector<uint8_t> TextureStagingBuffer;
+typedef std::vector<TextureDecodeMip> TextureDecodeMips;
+
+// Conversions run on the CPU before a texture can be uploaded, in this order.
+enum TextureDecodeStage : uint32_t {
+    TEXTURE_DECODE_DECOMPRESS = 1 << 0,
+    TEXTURE_DECODE_LINEARIZE = 1 << 1,
+    TEXTURE_DECODE_PALETTE = 1 << 2,
+    TEXTURE_DECODE_YUV = 1 << 3,
+};
+
+struct TextureDecodeJob {
+    SceGxmTexture texture;
+    uint32_t stages = 0;
+    bool rgba = false; // Decompressed to 8-bit RGBA rather than uploaded in the texture's own format.
+    const uint32_t *palette = nullptr;
+    TextureDecodeMips mips;
+    TextureStagingBuffer staging;
+
+    size_t slot = 0; // Texture cache slot the pixels are uploaded to.
+    uint64_t id = 0;
+    std::atomic<size_t> remaining_mips{ 0 };
+};
+
+typedef std::shared_ptr<TextureDecodeJob> TextureDecodeJobPtr;
+typedef std::vector<TextureDecodeJobPtr> TextureDecodeJobs;
+
+// Worker threads that decode texture mips. Mips of one texture are decoded in parallel, and the
+// texture is handed back to the render thread once all of them are done.
+struct TextureDecodeState {
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<std::pair<TextureDecodeJobPtr, size_t>> queue; // Job and mip index.
+    TextureDecodeJobs done;
+    std::atomic<size_t> done_count{ 0 };
+    std::vector<TextureStagingBuffer> free_staging;
+    std::vector<std::thread> workers;
+    bool quit = false;
+
+    TextureDecodeState() = default;
+    TextureDecodeState(const TextureDecodeState &) = delete;
+    TextureDecodeState &operator=(const TextureDecodeState &) = delete;
+    ~TextureDecodeState();
+};
+
+} // namespace renderer
@@ -7,7 +7,9 @@
 #include <renderer/commands.h>
 
 #include <array>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -40,6 +42,14 @@ enum class Backend {
 #ifdef USE_VULKAN
     Vulkan,
 #endif
+    Null,
+};
+
+// What a draw does while its shaders are still being translated and linked.
+enum class ShaderCompilePolicy {
+    Sync, // Waits for them on the render thread.
+    Skip, // Is dropped.
+    Fallback, // Uses a program linked earlier with the same vertex shader, or is dropped if there is none.
 };
 
 enum class GXMState : std::uint16_t {
@@ -70,10 +80,26 @@ enum SyncObjectSubject : std::uint32_t {
 
 struct RenderTarget;
 
+// Linear scratch memory for scene data that must outlive the guest copy until the renderer
+// has consumed it. A buffer is recycled once the FenceStaging queued behind its scene has completed.
+// Backends can provide buffers in memory the GPU reads directly, those complete once the GPU is done.
+struct StagingBuffer {
+    std::unique_ptr<std::uint8_t[]> heap; ///< Null when the memory belongs to the backend.
+    std::uint8_t *memory = nullptr;
+    std::size_t size = 0;
+    std::size_t used = 0;
+    std::size_t offset = 0; ///< Of memory in the backend's buffer object.
+    bool host_read = false; ///< Holds data the renderer reads on the CPU this scene, so it is a heap buffer.
+    std::atomic<int> status{ CommandErrorCodeNone }; ///< Set on the render thread, polled by the GXM thread.
+};
+
 struct Context {
     const RenderTarget *current_render_target{};
     CommandList command_list;
     int render_finish_status = 0;
+    std::size_t staging_alignment = 16; ///< Of every staging allocation.
+    std::vector<std::unique_ptr<StagingBuffer>> staging_buffers; ///< Backend provided buffers come first.
+    std::vector<StagingBuffer *> scene_staging_buffers; ///< Buffers written by the scene being recorded.
 };
 
 struct ShaderProgram {
@@ -5,12 +5,103 @@
 
 #include "driver_functions.h"
 
-#include <functional>
+#include <renderer/gl/functions.h>
+#include <renderer/null/functions.h>
+
 #include <util/log.h>
 
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 struct FeatureState;
 
 namespace renderer {
+namespace {
+constexpr size_t COMMAND_CHUNK_SIZE = 256;
+
+struct CommandPool {
+    std::mutex mutex;
+    Command *free_list = nullptr;
+    std::vector<std::unique_ptr<Command[]>> chunks;
+};
+
+CommandPool &command_pool() {
+    static CommandPool pool;
+    return pool;
+}
+
+struct ThreadCommandCache {
+    Command *free_list = nullptr;
+
+    ~ThreadCommandCache() {
+        if (free_list == nullptr)
+            return;
+
+        Command *last = free_list;
+        while (last->next != nullptr)
+            last = last->next;
+        free_commands(free_list, last);
+    }
+};
+
+thread_local ThreadCommandCache thread_commands;
+
+using CommandHandlerFunc = void (*)(renderer::State &, MemState &, Config &, CommandHelper &, const FeatureState &, Context *,
+    GxmContextState *, const char *, const char *);
+
+// Indexed by CommandOpcode.
+const CommandHandlerFunc command_handlers[] = {
+    cmd_handle_create_context, // CreateContext
+    cmd_handle_create_render_target, // CreateRenderTarget
+    cmd_handle_draw, // Draw
+    cmd_handle_nop, // Nop
+    cmd_handle_set_state, // SetState
+    cmd_handle_set_context, // SetContext
+    cmd_handle_sync_surface_data, // SyncSurfaceData
+    nullptr, // JumpWithLink
+    nullptr, // JumpBack
+    cmd_handle_signal_sync_object, // SignalSyncObject
+    cmd_handle_destroy_render_target, // DestroyRenderTarget
+    cmd_handle_fence_staging, // FenceStaging
+};
+
+static_assert(std::size(command_handlers) == static_cast<size_t>(CommandOpcode::FenceStaging) + 1);
+} // namespace
+
+Command *alloc_command() {
+    ThreadCommandCache &cache = thread_commands;
+    if (cache.free_list == nullptr) {
+        CommandPool &pool = command_pool();
+        const std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.free_list == nullptr) {
+            pool.chunks.push_back(std::make_unique<Command[]>(COMMAND_CHUNK_SIZE));
+            Command *const chunk = pool.chunks.back().get();
+            for (size_t i = 0; i < COMMAND_CHUNK_SIZE - 1; ++i)
+                chunk[i].next = &chunk[i + 1];
+            chunk[COMMAND_CHUNK_SIZE - 1].next = nullptr;
+            pool.free_list = chunk;
+        }
+
+        // Take the whole shared list, so the lock is only taken once per refill.
+        cache.free_list = pool.free_list;
+        pool.free_list = nullptr;
+    }
+
+    Command *const cmd = cache.free_list;
+    cache.free_list = cmd->next;
+    return cmd;
+}
+
+void free_commands(Command *first, Command *last) {
+    CommandPool &pool = command_pool();
+    const std::lock_guard<std::mutex> lock(pool.mutex);
+    last->next = pool.free_list;
+    pool.free_list = first;
+}
+
 void complete_command(State &state, CommandHelper &helper, const int code) {
     helper.complete(code);
     state.command_finish_one.notify_all();
@@ -18,49 +109,58 @@ void complete_command(State &state, CommandHelper &helper, const int code) {
 
 void process_batch(renderer::State &state, const FeatureState &features, MemState &mem, Config &config, CommandList &command_list, const char *base_path,
     const char *title_id) {
-    using CommandHandlerFunc = std::function<void(renderer::State &, MemState &, Config &,
-        CommandHelper &, const FeatureState &, Context *, GxmContextState *, const char *, const char *)>;
-
-    static std::map<CommandOpcode, CommandHandlerFunc> handlers = {
-        { CommandOpcode::SetContext, cmd_handle_set_context },
-        { CommandOpcode::SyncSurfaceData, cmd_handle_sync_surface_data },
-        { CommandOpcode::CreateContext, cmd_handle_create_context },
-        { CommandOpcode::CreateRenderTarget, cmd_handle_create_render_target },
-        { CommandOpcode::Draw, cmd_handle_draw },
-        { CommandOpcode::Nop, cmd_handle_nop },
-        { CommandOpcode::SetState, cmd_handle_set_state },
-        { CommandOpcode::SignalSyncObject, cmd_handle_signal_sync_object },
-        { CommandOpcode::DestroyRenderTarget, cmd_handle_destroy_render_target }
-    };
-
     Command *cmd = command_list.first;
+    Command *last_cmd = nullptr;
 
-    // Take a batch, and execute it. Hope it's not too large
-    do {
-        if (cmd == nullptr) {
-            break;
-        }
+    if ((state.current_backend == Backend::OpenGL) && command_list.context) {
+        gl::GLContext &gl_context = *reinterpret_cast<gl::GLContext *>(command_list.context);
+
+        // The GL context is shared with the other contexts and the UI, what it was left with is unknown.
+        gl::state_cache::invalidate(gl_context.state_cache);
+
+        // Staging memory of earlier scenes may be free by now, don't wait for this scene's fences to find out.
+        gl::poll_staging_fences(gl_context);
+    }
 
-        auto handler = handlers.find(cmd->opcode);
-        if (handler == handlers.end()) {
-            LOG_ERROR("Unimplemented command opcode {}", static_cast<int>(cmd->opcode));
+    // The null backend times every command, the others don't pay for it.
+    null::NullState *const null_state = (state.current_backend == Backend::Null) ? static_cast<null::NullState *>(&state) : nullptr;
+
+    // Take a batch, and execute it. Hope it's not too large
+    while (cmd != nullptr) {
+        const size_t opcode = static_cast<size_t>(cmd->opcode);
+        const CommandHandlerFunc handler = (opcode < std::size(command_handlers)) ? command_handlers[opcode] : nullptr;
+        if (handler == nullptr) {
+            LOG_ERROR("Unimplemented command opcode {}", opcode);
         } else {
+            const auto start = null_state ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
             CommandHelper helper(cmd);
-            handler->second(state, mem, config, helper, features, command_list.context,
+            handler(state, mem, config, helper, features, command_list.context,
                 command_list.gxm_context, base_path, title_id);
+
+            if (null_state)
+                null::record_command(*null_state, cmd->opcode, std::chrono::steady_clock::now() - start);
         }
 
-        Command *last_cmd = cmd;
+        last_cmd = cmd;
         cmd = cmd->next;
+    }
 
-        delete last_cmd;
-    } while (true);
+    if (last_cmd != nullptr)
+        free_commands(command_list.first, last_cmd);
 }
 
 void process_batches(renderer::State &state, const FeatureState &features, MemState &mem, Config &config, const char *base_path,
     const char *title_id) {
     std::uint32_t processed_count = 0;
 
+    // Called once per host frame.
+    if (state.current_backend == Backend::OpenGL) {
+        gl::GLState &gl_state = static_cast<gl::GLState &>(state);
+        gl_state.last_frame_state_counters = gl_state.state_counters;
+        gl_state.state_counters = {};
+    }
+
     while (processed_count < state.average_scene_per_frame) {
         auto cmd_list = state.command_buffer_queue.pop(2);
 
@@ -22,6 +22,7 @@
 #include <renderer/types.h>
 
 #include <renderer/gl/functions.h>
+#include <renderer/null/functions.h>
 #ifdef USE_VULKAN
 #include <renderer/vulkan/functions.h>
 #endif
@@ -29,6 +30,7 @@
 
 #include "driver_functions.h"
 
+#include <config/state.h>
 #include <gxm/types.h>
 #include <renderer/functions.h>
 #include <util/log.h>
@@ -40,7 +42,12 @@ COMMAND(handle_create_context) {
 
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
-        result = gl::create(*ctx);
+        result = gl::create(*ctx, static_cast<gl::GLState &>(renderer));
+        break;
+    }
+
+    case Backend::Null: {
+        result = null::create(*ctx);
         break;
     }
 
@@ -65,6 +72,11 @@ COMMAND(handle_create_render_target) {
         break;
     }
 
+    case Backend::Null: {
+        result = null::create(*render_target);
+        break;
+    }
+
     default: {
         REPORT_MISSING(renderer.current_backend);
         break;
@@ -88,6 +100,10 @@ bool create(std::unique_ptr<FragmentProgram> &fp, State &state, const SceGxmProg
         return gl::create(fp, static_cast<gl::GLState &>(state), program, blend, gxp_ptr_map, base_path, title_id);
     }
 
+    case Backend::Null: {
+        return null::create(fp, program, gxp_ptr_map);
+    }
+
     default: {
         REPORT_MISSING(state.current_backend);
         break;
@@ -103,6 +119,10 @@ bool create(std::unique_ptr<VertexProgram> &vp, State &state, const SceGxmProgra
         return gl::create(vp, static_cast<gl::GLState &>(state), program, gxp_ptr_map, base_path, title_id);
     }
 
+    case Backend::Null: {
+        return null::create(vp, program, gxp_ptr_map);
+    }
+
     default: {
         REPORT_MISSING(state.current_backend);
         break;
@@ -126,6 +146,10 @@ bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend) {
             return false;
         break;
 #endif
+    case Backend::Null:
+        // Headless, the window is not used.
+        null::create(state);
+        break;
     default:
         LOG_ERROR("Cannot create a renderer with unsupported backend {}.", static_cast<int>(backend));
         return false;
@@ -138,4 +162,50 @@ bool init(SDL_Window *window, std::unique_ptr<State> &state, Backend backend) {
 
     return true;
 }
+
+void prewarm_program_cache(State &state, const char *pref_path, const char *title_id) {
+    switch (state.current_backend) {
+    case Backend::OpenGL:
+        gl::prewarm_program_cache(static_cast<gl::GLState &>(state), pref_path, title_id);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static bool parse_shader_compile_policy(const std::string &name, ShaderCompilePolicy &policy) {
+    if (name == "sync")
+        policy = ShaderCompilePolicy::Sync;
+    else if (name == "skip")
+        policy = ShaderCompilePolicy::Skip;
+    else if (name == "fallback")
+        policy = ShaderCompilePolicy::Fallback;
+    else
+        return false;
+
+    return true;
+}
+
+void init_shader_compiler(State &state, const Config &cfg, const char *title_id) {
+    std::string policy_name = cfg.shader_compile_policy;
+    for (const std::string &entry : cfg.title_shader_compile_policies) {
+        const std::size_t separator = entry.find(':');
+        if ((separator != std::string::npos) && (entry.compare(0, separator, title_id) == 0))
+            policy_name = entry.substr(separator + 1);
+    }
+
+    ShaderCompilePolicy policy = ShaderCompilePolicy::Sync;
+    if (!parse_shader_compile_policy(policy_name, policy))
+        LOG_WARN("Unknown shader compile policy {}, draws will wait for their shaders.", policy_name);
+
+    switch (state.current_backend) {
+    case Backend::OpenGL:
+        gl::init_shader_compiler(static_cast<gl::GLState &>(state), policy);
+        break;
+
+    default:
+        break;
+    }
+}
 } // namespace renderer
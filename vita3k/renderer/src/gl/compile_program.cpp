@@ -5,15 +5,26 @@
 #include <renderer/gl/types.h>
 
 #include <gxm/types.h>
+#include <util/fs.h>
 #include <util/log.h>
 
 #include <shader/spirv_recompiler.h>
 
 #include <gxm/functions.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <thread>
 #include <vector>
 
+// From KHR_parallel_shader_compile, missing from the GL loader.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace renderer::gl {
-static SharedGLObject compile_glsl(GLenum type, const std::string &source) {
+static SharedGLObject begin_compile_glsl(GLenum type, const std::string &source) {
     R_PROFILE(__func__);
 
     const SharedGLObject shader = std::make_shared<GLObject>();
@@ -27,32 +38,58 @@ static SharedGLObject compile_glsl(GLenum type, const std::string &source) {
 
     glCompileShader(shader->get());
 
+    return shader;
+}
+
+// Waits for the compile, unless the driver already reported it complete.
+static bool finish_compile_glsl(const GLObject &shader) {
+    R_PROFILE(__func__);
+
     GLint log_length = 0;
-    glGetShaderiv(shader->get(), GL_INFO_LOG_LENGTH, &log_length);
+    glGetShaderiv(shader.get(), GL_INFO_LOG_LENGTH, &log_length);
 
     // Intel driver returns an info log length of at least 1 even if it is empty.
     if (log_length > 1) {
         std::vector<GLchar> log;
         log.resize(log_length);
-        glGetShaderInfoLog(shader->get(), log_length, nullptr, log.data());
+        glGetShaderInfoLog(shader.get(), log_length, nullptr, log.data());
 
         LOG_ERROR("{}", log.data());
     }
 
     GLint is_compiled = GL_FALSE;
-    glGetShaderiv(shader->get(), GL_COMPILE_STATUS, &is_compiled);
+    glGetShaderiv(shader.get(), GL_COMPILE_STATUS, &is_compiled);
     assert(is_compiled != GL_FALSE);
-    if (!is_compiled) {
+    return is_compiled != GL_FALSE;
+}
+
+static SharedGLObject compile_glsl(GLenum type, const std::string &source) {
+    const SharedGLObject shader = begin_compile_glsl(type, source);
+    if (!shader || !finish_compile_glsl(*shader)) {
         return SharedGLObject();
     }
 
     return shader;
 }
 
-static void bind_attribute_locations(GLuint gl_program, const GLVertexProgram &program) {
+// Without KHR_parallel_shader_compile, finishing a compile or link is what waits for it.
+static bool is_compile_complete(GLuint object, bool is_program, const FeatureState &features) {
+    if (!features.support_parallel_shader_compile)
+        return true;
+
+    GLint complete = GL_FALSE;
+    if (is_program)
+        glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    else
+        glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+
+    return complete != GL_FALSE;
+}
+
+static void bind_attribute_locations(GLuint gl_program, const AttributeLocations &attribute_locations) {
     R_PROFILE(__func__);
 
-    for (const AttributeLocations::value_type &binding : program.attribute_locations) {
+    for (const AttributeLocations::value_type &binding : attribute_locations) {
         glBindAttribLocation(gl_program, binding.first / sizeof(uint32_t), binding.second.c_str());
     }
 }
@@ -104,104 +141,561 @@ static SharedGLObject get_or_compile_shader(const SceGxmProgram *program, const
     return cached->second;
 }
 
-SharedGLObject compile_program(ProgramCache &program_cache, ShaderCache &vertex_cache, ShaderCache &fragment_cache,
-    const GxmContextState &state, const FeatureState &features, const MemState &mem, bool maskupdate, const char *base_path, const char *title_id) {
-    R_PROFILE(__func__);
+static void bind_program_resources(GLuint gl_program, const SceGxmProgram &vertex_program, const SceGxmProgram &fragment_program) {
+    bind_uniform_block_locations(gl_program, vertex_program);
+    bind_uniform_block_locations(gl_program, fragment_program);
+
+    const auto parameters = gxp::program_parameters(fragment_program);
+    for (uint32_t i = 0; i < fragment_program.parameter_count; ++i) {
+        const auto parameter = &parameters[i];
+        if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_SAMPLER) {
+            const auto name = gxp::parameter_name_raw(*parameter);
+            GLint loc = glGetUniformLocation(gl_program, name.c_str());
+            glProgramUniform1i(gl_program, loc, parameter->resource_index);
+        }
+    }
+}
 
-    assert(state.fragment_program);
-    assert(state.vertex_program);
+static void resolve_uniform_locations(UniformLocations &locations, GLuint gl_program, const SceGxmProgram &program,
+    const std::map<std::string, GLenum> &uniform_types) {
+    const SceGxmProgramParameter *const parameters = gxp::program_parameters(program);
+    locations.resize(program.parameter_count);
 
-    const SceGxmVertexProgram &vertex_program_gxm = *state.vertex_program.get(mem);
-    const SceGxmFragmentProgram &fragment_program_gxm = *state.fragment_program.get(mem);
+    for (uint32_t i = 0; i < program.parameter_count; ++i) {
+        const SceGxmProgramParameter &parameter = parameters[i];
+        if (parameter.category != SCE_GXM_PARAMETER_CATEGORY_UNIFORM)
+            continue;
 
-    const GLFragmentProgram &fragment_program = *reinterpret_cast<GLFragmentProgram *>(
-        fragment_program_gxm.renderer_data.get());
+        const std::string name = gxp::parameter_name(parameter);
+        UniformLocation &location = locations[i];
+        location.location = glGetUniformLocation(gl_program, name.c_str());
 
-    const GLVertexProgram &vertex_program = *reinterpret_cast<GLVertexProgram *>(
-        vertex_program_gxm.renderer_data.get());
+        // This was added for compability with hand-written shaders. GXP shaders don't use matrix, but rather flatten them as array.
+        // Hand-written shaders usually convet them to matrix if possible. Until we get rid of hand-written shaders, this will stay here.
+        // TODO: Add more types
+        const auto type = uniform_types.find(name);
+        if (type != uniform_types.end())
+            location.is_matrix = (type->second == GL_FLOAT_MAT2) || (type->second == GL_FLOAT_MAT3) || (type->second == GL_FLOAT_MAT4);
+    }
+}
 
-    const ProgramHashes hashes(fragment_program.hash, vertex_program.hash);
+// Looks up everything draws set on the program by name, so they don't have to.
+static void resolve_program_locations(GLProgram &program, const FeatureState &features, const SceGxmProgram &vertex_program,
+    const SceGxmProgram &fragment_program) {
+    const GLuint gl_program = program.program->get();
 
-    // First pass, trying to find the program, since link is costly
-    const ProgramCache::const_iterator cached = program_cache.find(hashes);
-    if (cached != program_cache.end()) {
-        return cached->second;
+    // Missing from hand-written shaders.
+    program.color_attachment_location = glGetUniformLocation(gl_program, "f_colorAttachment");
+    program.mask_location = glGetUniformLocation(gl_program, "f_mask");
+    program.flip_vec_location = glGetUniformLocation(gl_program, "flip_vec");
+
+    if (features.use_ubo)
+        return;
+
+    GLint total_uniforms = 0;
+    glGetProgramiv(gl_program, GL_ACTIVE_UNIFORMS, &total_uniforms);
+
+    GLint max_uniform_name_length = 0;
+    glGetProgramiv(gl_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_uniform_name_length);
+
+    std::map<std::string, GLenum> uniform_types;
+    std::vector<GLchar> uname(std::max(max_uniform_name_length, 1));
+    for (GLint i = 0; i < total_uniforms; i++) {
+        GLsizei written_name_length = 0;
+        GLint usize = 0;
+        GLenum utype{};
+        glGetActiveUniform(gl_program, i, static_cast<GLsizei>(uname.size()), &written_name_length, &usize, &utype, uname.data());
+
+        // Arrays are reported as their first element.
+        std::string name(uname.data(), written_name_length);
+        const std::size_t subscript = name.find('[');
+        if (subscript != std::string::npos)
+            name.resize(subscript);
+
+        uniform_types.emplace(std::move(name), utype);
     }
 
-    // No... It doesn't exist. Now we try to find each object. If it doesn't exist then we can kind
-    // of compile it again.
-    const SharedGLObject fragment_shader = get_or_compile_shader(fragment_program_gxm.program.get(mem),
-        features, fragment_program.hash, fragment_cache, GL_FRAGMENT_SHADER, maskupdate, base_path, title_id);
+    resolve_uniform_locations(program.vertex_uniforms, gl_program, vertex_program, uniform_types);
+    resolve_uniform_locations(program.fragment_uniforms, gl_program, fragment_program, uniform_types);
+}
 
-    if (!fragment_shader) {
-        LOG_CRITICAL("Error in get/compile fragment vertex shader:\n{}", vertex_program.hash);
+// On-disk program cache. Each file holds one linked program binary together with the hashes of the
+// shaders it was linked from and the id of the driver that produced it.
+static constexpr uint32_t PROGRAM_BINARY_MAGIC = 0x42503356; // 'V3PB'
+static constexpr uint32_t PROGRAM_BINARY_VERSION = 2;
+static constexpr uint32_t PROGRAM_BINARY_MAX_HASH_SIZE = 64;
+static constexpr uint32_t PROGRAM_BINARY_MAX_SIZE = 64 * 1024 * 1024;
+
+// Past these, the remaining binaries are loaded when their program is first drawn with.
+static constexpr size_t PROGRAM_BINARY_PREWARM_MAX_COUNT = 2048;
+static constexpr uintmax_t PROGRAM_BINARY_PREWARM_MAX_BYTES = 128 * 1024 * 1024;
+
+struct ProgramBinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    Sha256Hash driver_id;
+    uint32_t format;
+    uint32_t fragment_hash_size;
+    uint32_t vertex_hash_size;
+    uint32_t binary_size;
+};
+
+static fs::path program_binary_path(const GLState &renderer, const ProgramHashes &hashes) {
+    const std::string name = fmt::format("{}-{}", hex_string(std::get<1>(hashes)), hex_string(std::get<0>(hashes)));
+    return fs_utils::construct_file_name(renderer.program_binary_path, "", name, ".bin");
+}
+
+static SharedGLObject load_program_binary(const GLState &renderer, const fs::path &path, ProgramHashes &hashes) {
+    fs::ifstream is(path, fs::ifstream::binary);
+    ProgramBinaryHeader header{};
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return SharedGLObject();
+
+    if ((header.magic != PROGRAM_BINARY_MAGIC) || (header.version != PROGRAM_BINARY_VERSION) || (header.driver_id != renderer.driver_id))
+        return SharedGLObject();
+
+    if ((header.fragment_hash_size > PROGRAM_BINARY_MAX_HASH_SIZE) || (header.vertex_hash_size > PROGRAM_BINARY_MAX_HASH_SIZE)
+        || (header.binary_size == 0) || (header.binary_size > PROGRAM_BINARY_MAX_SIZE))
+        return SharedGLObject();
+
+    std::string fragment_hash(header.fragment_hash_size, '\0');
+    std::string vertex_hash(header.vertex_hash_size, '\0');
+    std::vector<char> binary(header.binary_size);
+    is.read(fragment_hash.data(), fragment_hash.size());
+    is.read(vertex_hash.data(), vertex_hash.size());
+    is.read(binary.data(), binary.size());
+    if (!is)
+        return SharedGLObject();
+
+    const SharedGLObject program = std::make_shared<GLObject>();
+    if (!program->init(glCreateProgram(), glDeleteProgram)) {
         return SharedGLObject();
     }
 
-    const SharedGLObject vertex_shader = get_or_compile_shader(vertex_program_gxm.program.get(mem),
-        features, vertex_program.hash, vertex_cache, GL_VERTEX_SHADER, maskupdate, base_path, title_id);
+    // A driver update can reject the binary even with a matching id, so this has to be checked.
+    glProgramBinary(program->get(), header.format, binary.data(), static_cast<GLsizei>(binary.size()));
 
-    if (!vertex_shader) {
-        LOG_CRITICAL("Error in get/compiled vertex shader:\n{}", vertex_program.hash);
+    GLint is_linked = GL_FALSE;
+    glGetProgramiv(program->get(), GL_LINK_STATUS, &is_linked);
+    if (is_linked == GL_FALSE)
         return SharedGLObject();
+
+    hashes = ProgramHashes(std::move(fragment_hash), std::move(vertex_hash));
+    return program;
+}
+
+static void program_binary_writer(ProgramBinaryWriterState &state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (true) {
+        // Everything queued is still written when quitting.
+        state.work_available.wait(lock, [&state] { return state.quit || !state.queue.empty(); });
+        if (state.queue.empty())
+            return;
+
+        const std::pair<std::string, std::vector<char>> file = std::move(state.queue.front());
+        state.queue.pop_front();
+
+        lock.unlock();
+        {
+            R_PROFILE("write_program_binary");
+            fs::ofstream of(fs::path(file.first), fs::ofstream::binary);
+            of.write(file.second.data(), file.second.size());
+            if (!of)
+                LOG_WARN("Failed to write program binary {}", file.first);
+        }
+        lock.lock();
+    }
+}
+
+ProgramBinaryWriterState::~ProgramBinaryWriterState() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
     }
+    work_available.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+// Only the binary is fetched from the driver here, writing it out is left to the writer thread.
+static void save_program_binary(GLState &renderer, const ProgramHashes &hashes, GLuint program) {
+    R_PROFILE(__func__);
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    const std::string &fragment_hash = std::get<0>(hashes);
+    const std::string &vertex_hash = std::get<1>(hashes);
+
+    std::vector<char> file(sizeof(ProgramBinaryHeader) + fragment_hash.size() + vertex_hash.size() + length);
+    char *const binary = &file[sizeof(ProgramBinaryHeader) + fragment_hash.size() + vertex_hash.size()];
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary);
+    file.resize(sizeof(ProgramBinaryHeader) + fragment_hash.size() + vertex_hash.size() + length);
+
+    ProgramBinaryHeader header{};
+    header.magic = PROGRAM_BINARY_MAGIC;
+    header.version = PROGRAM_BINARY_VERSION;
+    header.driver_id = renderer.driver_id;
+    header.format = format;
+    header.fragment_hash_size = static_cast<uint32_t>(fragment_hash.size());
+    header.vertex_hash_size = static_cast<uint32_t>(vertex_hash.size());
+    header.binary_size = static_cast<uint32_t>(length);
+
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::copy(fragment_hash.begin(), fragment_hash.end(), &file[sizeof(header)]);
+    std::copy(vertex_hash.begin(), vertex_hash.end(), &file[sizeof(header) + fragment_hash.size()]);
+
+    ProgramBinaryWriterState &writer = renderer.program_binary_writer;
+    {
+        const std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.queue.emplace_back(program_binary_path(renderer, hashes).string(), std::move(file));
+    }
+    writer.work_available.notify_one();
+}
+
+void prewarm_program_cache(GLState &renderer, const char *pref_path, const char *title_id) {
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    if (format_count <= 0) {
+        LOG_INFO("Driver exposes no program binary formats, on-disk program cache disabled.");
+        return;
+    }
+
+    const fs::path cache_path{ fs::path(pref_path) / "cache" / "shaders" / title_id };
+    if (!fs::exists(cache_path))
+        fs::create_directories(cache_path);
+
+    renderer.program_binary_path = cache_path.generic_path().string();
+    renderer.program_binary_writer.worker = std::thread(program_binary_writer, std::ref(renderer.program_binary_writer));
+
+    std::size_t loaded = 0;
+    std::size_t stale = 0;
+    uintmax_t loaded_bytes = 0;
+    for (const auto &entry : fs::directory_iterator(cache_path)) {
+        if (entry.path().extension() != ".bin")
+            continue;
+
+        if ((loaded >= PROGRAM_BINARY_PREWARM_MAX_COUNT) || (loaded_bytes >= PROGRAM_BINARY_PREWARM_MAX_BYTES)) {
+            renderer.unloaded_program_binaries.insert(entry.path().filename().string());
+            continue;
+        }
+
+        ProgramHashes hashes;
+        const SharedGLObject program = load_program_binary(renderer, entry.path(), hashes);
+        if (!program) {
+            // Written by another driver or a different version, it will be linked and saved again.
+            fs::remove(entry.path());
+            ++stale;
+            continue;
+        }
+
+        const SharedGLProgram preloaded = std::make_shared<GLProgram>();
+        preloaded->program = program;
+        renderer.preloaded_programs.emplace(hashes, preloaded);
+        ++loaded;
+        loaded_bytes += fs::file_size(entry.path());
+    }
+
+    LOG_INFO("Loaded {} cached programs for {}, dropped {} stale ones, left {} for later.", loaded, title_id, stale, renderer.unloaded_program_binaries.size());
+}
+
+// Every program linked or restored goes through here, it may stand in for others with its vertex shader later.
+static void cache_program(GLState &renderer, const ProgramHashes &hashes, const SharedGLProgram &program) {
+    renderer.program_cache.emplace(hashes, program);
+    renderer.fallback_programs[std::get<1>(hashes)] = program;
+}
+
+static SharedGLObject begin_link(const GLState &renderer, GLuint fragment_shader, GLuint vertex_shader, const AttributeLocations &attribute_locations) {
+    R_PROFILE(__func__);
 
     const SharedGLObject program = std::make_shared<GLObject>();
     if (!program->init(glCreateProgram(), glDeleteProgram)) {
         return SharedGLObject();
     }
 
-    glAttachShader(program->get(), fragment_shader->get());
-    glAttachShader(program->get(), vertex_shader->get());
+    glAttachShader(program->get(), fragment_shader);
+    glAttachShader(program->get(), vertex_shader);
 
-    bind_attribute_locations(program->get(), vertex_program);
+    bind_attribute_locations(program->get(), attribute_locations);
+
+    if (!renderer.program_binary_path.empty())
+        glProgramParameteri(program->get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
     glLinkProgram(program->get());
 
-    if (!features.use_shader_binding) {
-        bind_uniform_block_locations(program->get(), *vertex_program_gxm.program.get(mem));
-        bind_uniform_block_locations(program->get(), *fragment_program_gxm.program.get(mem));
-    }
+    // The link took what it needs from them.
+    glDetachShader(program->get(), fragment_shader);
+    glDetachShader(program->get(), vertex_shader);
+
+    return program;
+}
+
+// Waits for the link, unless the driver already reported it complete.
+static bool finish_link(const GLObject &program) {
+    R_PROFILE(__func__);
 
     GLint log_length = 0;
-    glGetProgramiv(program->get(), GL_INFO_LOG_LENGTH, &log_length);
+    glGetProgramiv(program.get(), GL_INFO_LOG_LENGTH, &log_length);
 
     // Intel driver returns an info log length of at least 1 even if it is empty.
     if (log_length > 1) {
         std::vector<GLchar> log;
         log.resize(log_length);
-        glGetProgramInfoLog(program->get(), log_length, nullptr, log.data());
+        glGetProgramInfoLog(program.get(), log_length, nullptr, log.data());
 
         LOG_ERROR("{}\n", log.data());
     }
 
     GLint is_linked = GL_FALSE;
-    glGetProgramiv(program->get(), GL_LINK_STATUS, &is_linked);
+    glGetProgramiv(program.get(), GL_LINK_STATUS, &is_linked);
     assert(is_linked != GL_FALSE);
-    if (is_linked == GL_FALSE) {
-        return SharedGLObject();
+    return is_linked != GL_FALSE;
+}
+
+static SharedGLProgram finish_program(GLState &renderer, const FeatureState &features, const ProgramHashes &hashes, const SharedGLObject &program,
+    const SceGxmProgram &vertex_program_gxp, const SceGxmProgram &fragment_program_gxp) {
+    if (!renderer.program_binary_path.empty())
+        save_program_binary(renderer, hashes, program->get());
+
+    if (!features.use_shader_binding)
+        bind_program_resources(program->get(), vertex_program_gxp, fragment_program_gxp);
+
+    const SharedGLProgram linked = std::make_shared<GLProgram>();
+    linked->program = program;
+    resolve_program_locations(*linked, features, vertex_program_gxp, fragment_program_gxp);
+
+    cache_program(renderer, hashes, linked);
+
+    return linked;
+}
+
+static std::vector<uint8_t> copy_gxp(const SceGxmProgram &program) {
+    const uint8_t *const bytes = reinterpret_cast<const uint8_t *>(&program);
+    return std::vector<uint8_t>(bytes, bytes + program.size);
+}
+
+static void queue_shader(GLState &renderer, const FeatureState &features, const SceGxmProgram &program, const std::string &hash, GLenum type,
+    bool maskupdate, const char *base_path, const char *title_id) {
+    const ShaderCache &cache = (type == GL_VERTEX_SHADER) ? renderer.vertex_shader_cache : renderer.fragment_shader_cache;
+    if ((cache.find(hash) != cache.end()) || (renderer.pending_shaders.find(hash) != renderer.pending_shaders.end()))
+        return;
+
+    renderer.pending_shaders.emplace(hash, PendingShader{ type, SharedGLObject() });
+
+    const ShaderTranslateJobPtr job = std::make_shared<ShaderTranslateJob>();
+    job->hash = hash;
+    job->type = type;
+    job->gxp = copy_gxp(program);
+    job->features = features;
+    job->maskupdate = maskupdate;
+    job->base_path = base_path;
+    job->title_id = title_id;
+    submit_shader_translate(renderer.shader_translator, job);
+}
+
+// Compiles the shaders translated since the last call and links the programs whose shaders are ready.
+// Anything the driver is still working on is checked again on the next call.
+static void update_pending_programs(GLState &renderer, const FeatureState &features) {
+    R_PROFILE(__func__);
+
+    ShaderTranslateJobs translated;
+    take_translated_shaders(renderer.shader_translator, translated);
+    for (const ShaderTranslateJobPtr &job : translated) {
+        const PendingShaders::iterator pending = renderer.pending_shaders.find(job->hash);
+        pending->second.shader = begin_compile_glsl(job->type, job->glsl);
+        if (!pending->second.shader) {
+            ShaderCache &cache = (job->type == GL_VERTEX_SHADER) ? renderer.vertex_shader_cache : renderer.fragment_shader_cache;
+            cache.emplace(job->hash, SharedGLObject());
+            renderer.pending_shaders.erase(pending);
+        }
     }
 
-    glDetachShader(program->get(), fragment_shader->get());
-    glDetachShader(program->get(), vertex_shader->get());
+    for (PendingShaders::iterator it = renderer.pending_shaders.begin(); it != renderer.pending_shaders.end();) {
+        const PendingShader &pending = it->second;
+        if (!pending.shader || !is_compile_complete(pending.shader->get(), false, features)) {
+            ++it;
+            continue;
+        }
+
+        ShaderCache &cache = (pending.type == GL_VERTEX_SHADER) ? renderer.vertex_shader_cache : renderer.fragment_shader_cache;
+        cache.emplace(it->first, finish_compile_glsl(*pending.shader) ? pending.shader : SharedGLObject());
+        it = renderer.pending_shaders.erase(it);
+    }
 
-    if (!features.use_shader_binding) {
-        glUseProgram(program->get());
-        const auto fragment_program_gxp = fragment_program_gxm.program.get(mem);
-        const auto parameters = gxp::program_parameters(*fragment_program_gxp);
-        for (uint32_t i = 0; i < fragment_program_gxp->parameter_count; ++i) {
-            const auto parameter = &parameters[i];
-            if (parameter->category == SCE_GXM_PARAMETER_CATEGORY_SAMPLER) {
-                const auto name = gxp::parameter_name_raw(*parameter);
-                GLint loc = glGetUniformLocation(program->get(), name.c_str());
-                glUniform1i(loc, parameter->resource_index);
+    for (PendingPrograms::iterator it = renderer.pending_programs.begin(); it != renderer.pending_programs.end();) {
+        const ProgramHashes &hashes = it->first;
+        PendingProgram &pending = it->second;
+
+        if (!pending.program) {
+            const ShaderCache::const_iterator fragment_shader = renderer.fragment_shader_cache.find(std::get<0>(hashes));
+            const ShaderCache::const_iterator vertex_shader = renderer.vertex_shader_cache.find(std::get<1>(hashes));
+            if ((fragment_shader == renderer.fragment_shader_cache.end()) || (vertex_shader == renderer.vertex_shader_cache.end())) {
+                ++it;
+                continue;
+            }
+
+            if (fragment_shader->second && vertex_shader->second)
+                pending.program = begin_link(renderer, fragment_shader->second->get(), vertex_shader->second->get(), pending.attribute_locations);
+
+            if (!pending.program) {
+                // Cached as failed, so the draws using it don't queue it again.
+                LOG_CRITICAL("Error in compiling or linking program:\n{}\n{}", hex_string(std::get<1>(hashes)), hex_string(std::get<0>(hashes)));
+                renderer.program_cache.emplace(hashes, SharedGLProgram());
+                it = renderer.pending_programs.erase(it);
+                continue;
             }
         }
-        glUseProgram(0);
+
+        if (!is_compile_complete(pending.program->get(), true, features)) {
+            ++it;
+            continue;
+        }
+
+        if (finish_link(*pending.program)) {
+            const SceGxmProgram &vertex_program_gxp = *reinterpret_cast<const SceGxmProgram *>(pending.vertex_gxp.data());
+            const SceGxmProgram &fragment_program_gxp = *reinterpret_cast<const SceGxmProgram *>(pending.fragment_gxp.data());
+            finish_program(renderer, features, hashes, pending.program, vertex_program_gxp, fragment_program_gxp);
+        } else {
+            renderer.program_cache.emplace(hashes, SharedGLProgram());
+        }
+
+        it = renderer.pending_programs.erase(it);
+    }
+}
+
+void init_shader_compiler(GLState &renderer, ShaderCompilePolicy policy) {
+    renderer.shader_compile_policy = policy;
+    if (policy == ShaderCompilePolicy::Sync)
+        return;
+
+    const size_t translate_workers = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+    if (!init_shader_translator(renderer.shader_translator, translate_workers)) {
+        LOG_WARN("Failed to start the shader translation threads, draws will wait for their programs.");
+        renderer.shader_compile_policy = ShaderCompilePolicy::Sync;
     }
+}
 
-    program_cache.emplace(hashes, program);
+SharedGLProgram compile_program(GLState &renderer, const GxmContextState &state, const FeatureState &features, const MemState &mem,
+    bool maskupdate, const char *base_path, const char *title_id, bool &pending) {
+    R_PROFILE(__func__);
 
-    return program;
+    assert(state.fragment_program);
+    assert(state.vertex_program);
+
+    pending = false;
+
+    ProgramCache &program_cache = renderer.program_cache;
+
+    const SceGxmVertexProgram &vertex_program_gxm = *state.vertex_program.get(mem);
+    const SceGxmFragmentProgram &fragment_program_gxm = *state.fragment_program.get(mem);
+
+    const GLFragmentProgram &fragment_program = *reinterpret_cast<GLFragmentProgram *>(
+        fragment_program_gxm.renderer_data.get());
+
+    const GLVertexProgram &vertex_program = *reinterpret_cast<GLVertexProgram *>(
+        vertex_program_gxm.renderer_data.get());
+
+    const ProgramHashes hashes(fragment_program.hash, vertex_program.hash);
+
+    if (!renderer.pending_programs.empty())
+        update_pending_programs(renderer, features);
+
+    // First pass, trying to find the program, since link is costly
+    const ProgramCache::const_iterator cached = program_cache.find(hashes);
+    if (cached != program_cache.end()) {
+        return cached->second;
+    }
+
+    const SceGxmProgram &vertex_program_gxp = *vertex_program_gxm.program.get(mem);
+    const SceGxmProgram &fragment_program_gxp = *fragment_program_gxm.program.get(mem);
+
+    // Binaries the prewarm left on disk are restored now.
+    if (!renderer.unloaded_program_binaries.empty()) {
+        const fs::path path = program_binary_path(renderer, hashes);
+        const std::set<std::string>::iterator unloaded = renderer.unloaded_program_binaries.find(path.filename().string());
+        if (unloaded != renderer.unloaded_program_binaries.end()) {
+            ProgramHashes loaded_hashes;
+            const SharedGLObject program = load_program_binary(renderer, path, loaded_hashes);
+            if (program && (loaded_hashes == hashes)) {
+                const SharedGLProgram preloaded = std::make_shared<GLProgram>();
+                preloaded->program = program;
+                renderer.preloaded_programs.emplace(hashes, preloaded);
+            }
+            renderer.unloaded_program_binaries.erase(unloaded);
+        }
+    }
+
+    // Then the programs restored from disk, they only miss the bindings and locations that need the gxp.
+    const ProgramCache::iterator preloaded = renderer.preloaded_programs.find(hashes);
+    if (preloaded != renderer.preloaded_programs.end()) {
+        const SharedGLProgram program = preloaded->second;
+        renderer.preloaded_programs.erase(preloaded);
+
+        if (!features.use_shader_binding)
+            bind_program_resources(program->program->get(), vertex_program_gxp, fragment_program_gxp);
+
+        resolve_program_locations(*program, features, vertex_program_gxp, fragment_program_gxp);
+
+        cache_program(renderer, hashes, program);
+        return program;
+    }
+
+    if (renderer.shader_compile_policy != ShaderCompilePolicy::Sync) {
+        // Translate and link in the background, the draw does without meanwhile.
+        if (renderer.pending_programs.find(hashes) == renderer.pending_programs.end()) {
+            queue_shader(renderer, features, fragment_program_gxp, fragment_program.hash, GL_FRAGMENT_SHADER, maskupdate, base_path, title_id);
+            queue_shader(renderer, features, vertex_program_gxp, vertex_program.hash, GL_VERTEX_SHADER, maskupdate, base_path, title_id);
+
+            PendingProgram &program = renderer.pending_programs[hashes];
+            program.attribute_locations = vertex_program.attribute_locations;
+            program.vertex_gxp = copy_gxp(vertex_program_gxp);
+            program.fragment_gxp = copy_gxp(fragment_program_gxp);
+
+            // Both shaders may be compiled already.
+            update_pending_programs(renderer, features);
+
+            const ProgramCache::const_iterator linked = program_cache.find(hashes);
+            if (linked != program_cache.end())
+                return linked->second;
+        }
+
+        pending = true;
+        if (renderer.shader_compile_policy == ShaderCompilePolicy::Fallback) {
+            const auto fallback = renderer.fallback_programs.find(vertex_program.hash);
+            if (fallback != renderer.fallback_programs.end())
+                return fallback->second;
+        }
+
+        return SharedGLProgram();
+    }
+
+    // No... It doesn't exist. Now we try to find each object. If it doesn't exist then we can kind
+    // of compile it again.
+    const SharedGLObject fragment_shader = get_or_compile_shader(&fragment_program_gxp,
+        features, fragment_program.hash, renderer.fragment_shader_cache, GL_FRAGMENT_SHADER, maskupdate, base_path, title_id);
+
+    if (!fragment_shader) {
+        LOG_CRITICAL("Error in get/compile fragment vertex shader:\n{}", vertex_program.hash);
+        return SharedGLProgram();
+    }
+
+    const SharedGLObject vertex_shader = get_or_compile_shader(&vertex_program_gxp,
+        features, vertex_program.hash, renderer.vertex_shader_cache, GL_VERTEX_SHADER, maskupdate, base_path, title_id);
+
+    if (!vertex_shader) {
+        LOG_CRITICAL("Error in get/compiled vertex shader:\n{}", vertex_program.hash);
+        return SharedGLProgram();
+    }
+
+    const SharedGLObject program = begin_link(renderer, fragment_shader->get(), vertex_shader->get(), vertex_program.attribute_locations);
+    if (!program || !finish_link(*program)) {
+        return SharedGLProgram();
+    }
+
+    return finish_program(renderer, features, hashes, program, vertex_program_gxp, fragment_program_gxp);
 }
 } // namespace renderer::gl
@@ -7,6 +7,7 @@
 #include <renderer/state.h>
 #include <renderer/types.h>
 
+#include <cstddef>
 #include <sstream>
 
 #include <gxm/types.h>
@@ -39,34 +40,47 @@ static GLenum translate_primitive(SceGxmPrimitiveType primType) {
     return GL_TRIANGLES;
 }
 
+// Null if the request does not point at one of the given parameters, e.g. it was made for another program.
+static const UniformLocation *find_uniform_location(const UniformLocations &locations, const SceGxmProgramParameter *params, const UniformSetRequest &request) {
+    const std::ptrdiff_t index = request.parameter - params;
+    if (index < 0 || index >= static_cast<std::ptrdiff_t>(locations.size())) {
+        LOG_WARN("Uniform set request for parameter {} outside of the current program, skipped", index);
+        return nullptr;
+    }
+
+    return &locations[index];
+}
+
 void draw(GLState &renderer, GLContext &context, GxmContextState &state, const FeatureState &features, SceGxmPrimitiveType type, SceGxmIndexFormat format, const void *indices, size_t count, const MemState &mem,
     const char *base_path, const char *title_id, const bool log_active_shaders, const bool log_uniforms, const bool do_hardware_flip, const bool texture_cache) {
     R_PROFILE(__func__);
 
-    GLuint program_id = context.last_draw_program;
-
     const SceGxmFragmentProgram &gxm_fragment_program = *state.fragment_program.get(mem);
     const SceGxmProgram &fragment_program_gxp = *gxm_fragment_program.program.get(mem);
     const auto &gl_frag_program = reinterpret_cast<gl::GLFragmentProgram *>(gxm_fragment_program.renderer_data.get());
 
     // Trying to cache: the last time vs this time shader pair. Does it different somehow?
     // If it's different, we need to switch. Else just stick to it.
-    if (state.vertex_program.get(mem)->renderer_data->hash != state.last_draw_vertex_program_hash || state.fragment_program.get(mem)->renderer_data->hash != state.last_draw_fragment_program_hash) {
+    // A stand-in program is replaced as soon as the real one is linked.
+    if (state.vertex_program.get(mem)->renderer_data->hash != state.last_draw_vertex_program_hash || state.fragment_program.get(mem)->renderer_data->hash != state.last_draw_fragment_program_hash
+        || context.last_draw_program_pending) {
         // Need to recompile!
-        SharedGLObject program = gl::compile_program(renderer.program_cache, renderer.vertex_shader_cache,
-            renderer.fragment_shader_cache, state, features, mem, gxm_fragment_program.is_maskupdate, base_path, title_id);
+        context.last_draw_program = gl::compile_program(renderer, state, features, mem, gxm_fragment_program.is_maskupdate, base_path, title_id,
+            context.last_draw_program_pending);
+    }
 
-        if (!program) {
+    if (!context.last_draw_program) {
+        // Skipped until its program is ready.
+        if (!context.last_draw_program_pending)
             LOG_ERROR("Fail to get program!");
-        }
-
-        // Use it
-        program_id = (*program).get();
-        context.last_draw_program = program_id;
-    } else {
-        program_id = context.last_draw_program;
+        context.vertex_set_requests.clear();
+        context.fragment_set_requests.clear();
+        return;
     }
 
+    const GLProgram &program = *context.last_draw_program;
+    const GLuint program_id = program.program->get();
+
     if (log_active_shaders) {
         const std::string hash_text_f = hex_string(state.fragment_program.get(mem)->renderer_data->hash);
         const std::string hash_text_v = hex_string(state.vertex_program.get(mem)->renderer_data->hash);
@@ -82,10 +96,8 @@ void draw(GLState &renderer, GLContext &context, GxmContextState &state, const F
         LOG_DEBUG("Fragment default uniform buffer: \n{}", frag_ub.str());
     }
 
-    if (!program_id) {
-        assert(false && "Should never happen");
-        glGetIntegerv(GL_CURRENT_PROGRAM, reinterpret_cast<GLint *>(&program_id));
-    }
+    // Textures decoded since the last draw replace their old contents now.
+    texture::upload_decoded_textures(context.texture_cache);
 
     const SceGxmProgramParameter *const fragment_params = gxp::program_parameters(fragment_program_gxp);
     std::array<bool, SCE_GXM_MAX_TEXTURE_UNITS> sampler_slot_used = { false };
@@ -101,10 +113,9 @@ void draw(GLState &renderer, GLContext &context, GxmContextState &state, const F
         sampler_slot_used[param.resource_index] = true;
     }
 
-    glUseProgram(program_id);
+    state_cache::use_program(context.state_cache, program_id);
 
-    const auto bind_host_texture = [&](std::string uniform_name, int image_index, GLint texture) {
-        GLint loc = glGetUniformLocation(program_id, uniform_name.c_str());
+    const auto bind_host_texture = [&](GLint loc, int image_index, GLint texture) {
         // It maybe a hand-written shader. So colorAttachment didn't exist
         if (loc != -1) {
             if (features.should_use_shader_interlock()) {
@@ -118,60 +129,63 @@ void draw(GLState &renderer, GLContext &context, GxmContextState &state, const F
                 sampler_slot_used[index] = true;
                 context.need_resync_texture_slots.insert(index);
                 glUniform1i(loc, index);
-                glActiveTexture(GL_TEXTURE0 + index);
-                glBindTexture(GL_TEXTURE_2D, texture);
+                state_cache::queue_texture_bind(context.state_cache, static_cast<GLuint>(index), texture);
             }
         }
     };
 
     if (fragment_program_gxp.is_native_color() && features.is_programmable_blending_need_to_bind_color_attachment()) {
-        bind_host_texture("f_colorAttachment", shader::COLOR_ATTACHMENT_TEXTURE_SLOT_IMAGE, context.render_target->color_attachment[0]);
+        bind_host_texture(program.color_attachment_location, shader::COLOR_ATTACHMENT_TEXTURE_SLOT_IMAGE, context.render_target->color_attachment[0]);
     }
-    bind_host_texture("f_mask", shader::MASK_TEXTURE_SLOT_IMAGE, context.render_target->masktexture[0]);
+    bind_host_texture(program.mask_location, shader::MASK_TEXTURE_SLOT_IMAGE, context.render_target->masktexture[0]);
 
     if (!features.use_ubo) {
         const SceGxmVertexProgram &gxm_vertex_program = *state.vertex_program.get(mem);
-        const FragmentProgram &fragment_program = *gxm_fragment_program.renderer_data.get();
 
-        // Set uniforms
+        // Set uniforms. The requests point into the parameters of the program they were made for.
         const SceGxmProgram &vertex_program_gxp = *gxm_vertex_program.program.get(mem);
-
-        gl::GLShaderStatics &vertex_gl_statics = reinterpret_cast<gl::GLVertexProgram *>(gxm_vertex_program.renderer_data.get())->statics;
-        gl::GLShaderStatics &fragment_gl_statics = reinterpret_cast<gl::GLFragmentProgram *>(gxm_fragment_program.renderer_data.get())->statics;
+        const SceGxmProgramParameter *const vertex_params = gxp::program_parameters(vertex_program_gxp);
 
         for (auto &vertex_uniform : context.vertex_set_requests) {
-            gl::set_uniform(program_id, vertex_program_gxp, vertex_gl_statics, mem, vertex_uniform.parameter, vertex_uniform.data,
-                log_uniforms);
-
-            delete vertex_uniform.data;
+            const UniformLocation *const location = find_uniform_location(program.vertex_uniforms, vertex_params, vertex_uniform);
+            if (location)
+                gl::set_uniform(*location, *vertex_uniform.parameter, vertex_uniform.data, log_uniforms);
         }
 
-        for (auto &fragment_uniform : context.fragment_set_requests) {
-            gl::set_uniform(program_id, fragment_program_gxp, fragment_gl_statics, mem, fragment_uniform.parameter,
-                fragment_uniform.data, log_uniforms);
-
-            delete fragment_uniform.data;
+        // The locations of a stand-in program belong to another fragment program.
+        if (!context.last_draw_program_pending) {
+            for (auto &fragment_uniform : context.fragment_set_requests) {
+                const UniformLocation *const location = find_uniform_location(program.fragment_uniforms, fragment_params, fragment_uniform);
+                if (location)
+                    gl::set_uniform(*location, *fragment_uniform.parameter, fragment_uniform.data, log_uniforms);
+            }
         }
     }
 
     if (do_hardware_flip) {
         // Try to configure the vertex shader, to output coordinates suited for GXM viewport
-        GLuint flip_vec_loc = glGetUniformLocation(program_id, "flip_vec");
-
-        if (flip_vec_loc != -1) {
+        if (program.flip_vec_location != -1) {
             // Let's do flipping
-            glUniform4fv(flip_vec_loc, 1, context.viewport_flip);
+            glUniform4fv(program.flip_vec_location, 1, context.viewport_flip);
         }
     }
 
     context.vertex_set_requests.clear();
     context.fragment_set_requests.clear();
 
-    // Upload index data.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context.element_buffer[0]);
-    const GLsizeiptr index_size = (format == SCE_GXM_INDEX_FORMAT_U16) ? 2 : 4;
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size * count, nullptr, GL_DYNAMIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size * count, indices, GL_DYNAMIC_DRAW);
+    // Point the attributes at the streams uploaded for this draw.
+    sync_vertex_attributes(context, state, mem);
+
+    // Upload index data, unless the draw can read it where the GXM thread wrote it.
+    GLintptr index_offset = 0;
+    if (get_staging_offset(context, indices, index_offset)) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context.staging_buffer[0]);
+    } else {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, context.element_buffer[0]);
+        const GLsizeiptr index_size = (format == SCE_GXM_INDEX_FORMAT_U16) ? 2 : 4;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size * count, nullptr, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size * count, indices, GL_DYNAMIC_DRAW);
+    }
 
     if (fragment_program_gxp.is_native_color()) {
         if (features.should_use_texture_barrier()) {
@@ -182,10 +196,12 @@ void draw(GLState &renderer, GLContext &context, GxmContextState &state, const F
         }
     }
 
+    state_cache::flush_texture_binds(context.state_cache);
+
     // Draw.
     const GLenum mode = translate_primitive(type);
     const GLenum gl_type = format == SCE_GXM_INDEX_FORMAT_U16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
-    glDrawElements(mode, static_cast<GLsizei>(count), gl_type, nullptr);
+    glDrawElements(mode, static_cast<GLsizei>(count), gl_type, reinterpret_cast<const GLvoid *>(index_offset));
 
     state.last_draw_vertex_program_hash = state.vertex_program.get(mem)->renderer_data->hash;
     state.last_draw_fragment_program_hash = state.fragment_program.get(mem)->renderer_data->hash;
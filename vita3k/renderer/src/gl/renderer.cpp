@@ -18,25 +18,42 @@
 #include <SDL.h>
 #include <SDL_video.h>
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
+#include <thread>
 
 namespace renderer::gl {
 namespace texture {
 bool init(GLTextureCacheState &cache) {
+    // Selecting a slot only queues its bind, the driver sees it when the slot is worked on or drawn with.
     cache.select_callback = [&](const std::size_t index) {
-        const GLuint gl_texture = cache.textures[index];
-        glBindTexture(GL_TEXTURE_2D, gl_texture);
+        state_cache::queue_texture_bind(*cache.state_cache, cache.unit, cache.textures[index]);
     };
 
-    cache.configure_texture_callback = [](const std::size_t index, const void *texture) {
+    cache.configure_texture_callback = [&](const std::size_t index, const void *texture) {
+        // The slot now holds another texture, whatever was being decoded for it is stale.
+        cache.pending_decodes[index] = 0;
+        cache.has_contents[index] = false;
+        state_cache::bind_texture_now(*cache.state_cache, cache.unit, cache.textures[index]);
         configure_bound_texture(*reinterpret_cast<const SceGxmTexture *>(texture));
     };
 
-    cache.upload_texture_callback = [](const std::size_t index, const void *texture, const MemState &mem) {
-        upload_bound_texture(*reinterpret_cast<const SceGxmTexture *>(texture), mem);
+    cache.upload_texture_callback = [&](const std::size_t index, const void *texture, const MemState &mem) {
+        const SceGxmTexture &gxm_texture = *reinterpret_cast<const SceGxmTexture *>(texture);
+        // Decoding in the background keeps the old contents visible meanwhile, a fresh slot has none.
+        if (!cache.has_contents[index] || !queue_texture_upload(cache, index, gxm_texture, mem)) {
+            state_cache::bind_texture_now(*cache.state_cache, cache.unit, cache.textures[index]);
+            upload_bound_texture(gxm_texture, mem);
+            cache.pending_decodes[index] = 0;
+            cache.has_contents[index] = true;
+        }
     };
 
+    const size_t decode_workers = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, 4);
+    if (!renderer::texture::init(cache.decoder, decode_workers))
+        return false;
+
     return cache.textures.init(reinterpret_cast<renderer::Generator *>(glGenTextures), reinterpret_cast<renderer::Deleter *>(glDeleteTextures));
 }
 } // namespace texture
@@ -238,6 +255,11 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state) {
     LOG_INFO("GL_VERSION = {}", glGetString(GL_VERSION));
     LOG_INFO("GL_SHADING_LANGUAGE_VERSION = {}", version);
 
+    // Program binaries are only valid for the driver that produced them.
+    const std::string driver = fmt::format("{}|{}|{}", reinterpret_cast<const GLchar *>(glGetString(GL_VENDOR)), gpu_name,
+        reinterpret_cast<const GLchar *>(glGetString(GL_VERSION)));
+    gl_state.driver_id = sha256(driver.data(), driver.size());
+
     // Try to parse and get version
     const std::size_t dot_pos = version.find_first_of('.');
 
@@ -267,7 +289,10 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state) {
         { "GL_ARB_fragment_shader_interlock", &gl_state.features.support_shader_interlock },
         { "GL_ARB_texture_barrier", &gl_state.features.support_texture_barrier },
         { "GL_EXT_shader_framebuffer_fetch", &gl_state.features.direct_fragcolor },
-        { "GL_ARB_shading_language_packing", &gl_state.features.pack_unpack_half_through_ext }
+        { "GL_ARB_shading_language_packing", &gl_state.features.pack_unpack_half_through_ext },
+        { "GL_ARB_buffer_storage", &gl_state.features.support_buffer_storage },
+        { "GL_ARB_multi_bind", &gl_state.features.support_multi_bind },
+        { "GL_KHR_parallel_shader_compile", &gl_state.features.support_parallel_shader_compile }
     };
 
     for (int i = 0; i < total_extensions; i++) {
@@ -292,17 +317,72 @@ bool create(SDL_Window *window, std::unique_ptr<State> &state) {
         LOG_WARN("Consider updating your graphics drivers or upgrading your GPU.");
     }
 
+    if (gl_state.features.support_parallel_shader_compile) {
+        // Missing from the GL loader. Some drivers only compile in the background once a thread count is set.
+        typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+        const auto max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreadsProc>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (max_shader_compiler_threads)
+            max_shader_compiler_threads(0xFFFFFFFF);
+    }
+
     gl_state.features.use_ubo = true;
 
     return true;
 }
 
-bool create(std::unique_ptr<Context> &context) {
+// Enough for a few scenes in flight, past that scenes fall back to heap staging buffers.
+static constexpr std::size_t STAGING_SEGMENT_COUNT = 4;
+static constexpr std::size_t STAGING_SEGMENT_SIZE = 4 * 1024 * 1024;
+
+// Splits one persistently mapped buffer into staging buffers, which the GXM thread fills and draws read in place.
+static bool init_staging_memory(GLContext &context) {
+    if (!context.staging_buffer.init(reinterpret_cast<renderer::Generator *>(glGenBuffers), reinterpret_cast<renderer::Deleter *>(glDeleteBuffers)))
+        return false;
+
+    // Write only, data the renderer reads on the CPU is staged in heap buffers instead.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const std::size_t size = STAGING_SEGMENT_COUNT * STAGING_SEGMENT_SIZE;
+    glBindBuffer(GL_ARRAY_BUFFER, context.staging_buffer[0]);
+    glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+    std::uint8_t *const memory = static_cast<std::uint8_t *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!memory)
+        return false;
+
+    // Uniform buffers are bound straight from staging memory too.
+    GLint uniform_buffer_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+    context.staging_alignment = std::max<std::size_t>(context.staging_alignment, uniform_buffer_alignment);
+
+    context.staging_memory = memory;
+    context.staging_memory_size = size;
+    for (std::size_t i = 0; i < STAGING_SEGMENT_COUNT; i++) {
+        auto buffer = std::make_unique<renderer::StagingBuffer>();
+        buffer->memory = memory + i * STAGING_SEGMENT_SIZE;
+        buffer->size = STAGING_SEGMENT_SIZE;
+        buffer->offset = i * STAGING_SEGMENT_SIZE;
+        context.staging_buffers.push_back(std::move(buffer));
+    }
+
+    return true;
+}
+
+bool create(std::unique_ptr<Context> &context, GLState &state) {
     R_PROFILE(__func__);
 
+    const FeatureState &features = state.features;
+
     context = std::make_unique<GLContext>();
     GLContext *gl_context = reinterpret_cast<GLContext *>(context.get());
 
+    gl_context->state_cache.multi_bind = features.support_multi_bind;
+    gl_context->state_cache.counters = &state.state_counters;
+    gl_context->texture_cache.state_cache = &gl_context->state_cache;
+
+    if (features.support_buffer_storage && !init_staging_memory(*gl_context))
+        LOG_WARN("Failed to map staging memory, scene data will be uploaded with glBufferData.");
+
     return !(!texture::init(gl_context->texture_cache) || !gl_context->vertex_array.init(reinterpret_cast<renderer::Generator *>(glGenVertexArrays), reinterpret_cast<renderer::Deleter *>(glDeleteVertexArrays)) || !gl_context->element_buffer.init(reinterpret_cast<renderer::Generator *>(glGenBuffers), reinterpret_cast<renderer::Deleter *>(glDeleteBuffers)) || !gl_context->stream_vertex_buffers.init(reinterpret_cast<renderer::Generator *>(glGenBuffers), reinterpret_cast<renderer::Deleter *>(glDeleteBuffers))
         || !gl_context->uniform_buffer.init(reinterpret_cast<renderer::Generator *>(glGenBuffers), reinterpret_cast<renderer::Deleter *>(glDeleteBuffers)));
 }
@@ -440,24 +520,24 @@ void set_context(GLContext &context, GxmContextState &state, const MemState &mem
         glBindFramebuffer(GL_FRAMEBUFFER, context.render_target->framebuffer[0]);
     }
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, true);
+    state_cache::set_depth_mask(context.state_cache, GL_TRUE);
     glClearDepth(state.depth_stencil_surface.backgroundDepth);
     glClear(GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
+    state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, false);
 
     sync_mask(context, state, mem);
     // TODO: Take request to force load from given memory
 
     // Sync enable/disable depth/stencil based on depth stencil surface.
-    if (sync_depth_data(state)) {
-        sync_front_depth_func(state);
-        sync_front_depth_write_enable(state);
+    if (sync_depth_data(context, state)) {
+        sync_front_depth_func(context, state);
+        sync_front_depth_write_enable(context, state);
     }
 
-    if (sync_stencil_data(state, mem)) {
-        sync_stencil_func(state, mem, true);
-        sync_stencil_func(state, mem, false);
+    if (sync_stencil_data(context, state, mem)) {
+        sync_stencil_func(context, state, mem, true);
+        sync_stencil_func(context, state, mem, false);
     }
 }
 
@@ -514,11 +594,27 @@ void get_surface_data(GLContext &context, size_t width, size_t height, size_t st
     if (do_flip) {
         flip_vertically(pixels, width, height, stride_in_pixels);
     }
+}
+
+bool get_staging_offset(const GLContext &context, const void *data, GLintptr &offset) {
+    const std::uint8_t *const bytes = static_cast<const std::uint8_t *>(data);
+    if ((bytes < context.staging_memory) || (bytes >= context.staging_memory + context.staging_memory_size))
+        return false;
 
-    ++context.texture_cache.timestamp;
+    offset = bytes - context.staging_memory;
+    return true;
 }
 
 void upload_vertex_stream(GLContext &context, const std::size_t stream_index, const std::size_t length, const void *data) {
+    VertexStreamBinding &binding = context.stream_bindings[stream_index];
+    if (get_staging_offset(context, data, binding.offset)) {
+        binding.buffer = context.staging_buffer[0];
+        return;
+    }
+
+    binding.buffer = context.stream_vertex_buffers[stream_index];
+    binding.offset = 0;
+
     glBindBuffer(GL_ARRAY_BUFFER, context.stream_vertex_buffers[stream_index]);
 
     // Orphan the buffer, so we don't have to stall the pipeline, wait for last draw call to finish
@@ -529,4 +625,24 @@ void upload_vertex_stream(GLContext &context, const std::size_t stream_index, co
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void fence_staging_buffer(GLContext &context, renderer::StagingBuffer &buffer) {
+    context.staging_fences.emplace_back(&buffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    poll_staging_fences(context);
+}
+
+void poll_staging_fences(GLContext &context) {
+    // Hand back the buffers of the scenes the GPU is done with, without waiting for the others.
+    auto fence = context.staging_fences.begin();
+    for (; fence != context.staging_fences.end(); ++fence) {
+        const GLenum result = glClientWaitSync(fence->second, 0, 0);
+        if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+            break;
+
+        glDeleteSync(fence->second);
+        fence->first->status = CommandErrorCodeNone;
+    }
+
+    context.staging_fences.erase(context.staging_fences.begin(), fence);
+}
+
 } // namespace renderer::gl
@@ -0,0 +1,65 @@
+#include <renderer/profile.h>
+
+#include <renderer/gl/functions.h>
+#include <renderer/gl/types.h>
+
+#include <gxm/types.h>
+
+namespace renderer::gl {
+static void translate_worker(ShaderTranslateState &state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (true) {
+        state.work_available.wait(lock, [&state] { return state.quit || !state.queue.empty(); });
+        if (state.quit)
+            return;
+
+        const ShaderTranslateJobPtr job = std::move(state.queue.front());
+        state.queue.pop_front();
+
+        lock.unlock();
+        {
+            R_PROFILE("translate_shader");
+            const SceGxmProgram &program = *reinterpret_cast<const SceGxmProgram *>(job->gxp.data());
+            job->glsl = load_shader(program, job->features, job->maskupdate, job->base_path.c_str(), job->title_id.c_str());
+        }
+        lock.lock();
+
+        state.done.push_back(job);
+        ++state.done_count;
+    }
+}
+
+bool init_shader_translator(ShaderTranslateState &state, size_t worker_count) {
+    for (size_t i = 0; i < worker_count; i++)
+        state.workers.emplace_back(translate_worker, std::ref(state));
+
+    return !state.workers.empty();
+}
+
+void submit_shader_translate(ShaderTranslateState &state, const ShaderTranslateJobPtr &job) {
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    state.queue.push_back(job);
+    state.work_available.notify_one();
+}
+
+void take_translated_shaders(ShaderTranslateState &state, ShaderTranslateJobs &jobs) {
+    jobs.clear();
+    if (state.done_count == 0)
+        return;
+
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    jobs.swap(state.done);
+    state.done_count = 0;
+}
+
+ShaderTranslateState::~ShaderTranslateState() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    work_available.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
+} // namespace renderer::gl
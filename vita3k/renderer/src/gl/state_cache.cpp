@@ -0,0 +1,251 @@
+#include <renderer/profile.h>
+
+#include <renderer/gl/functions.h>
+#include <renderer/gl/types.h>
+
+namespace renderer::gl::state_cache {
+static void count(GLStateCache &cache, const bool issued) {
+    if (cache.counters == nullptr)
+        return;
+
+    if (issued)
+        ++cache.counters->issued;
+    else
+        ++cache.counters->filtered;
+}
+
+// Records the value, returns false if the driver already has it.
+template <typename T>
+static bool changes(GLStateCache &cache, GLShadowed<T> &shadowed, const T &value) {
+    const bool same = shadowed.known && (shadowed.value == value);
+    count(cache, !same);
+    if (same)
+        return false;
+
+    shadowed.value = value;
+    shadowed.known = true;
+    return true;
+}
+
+template <typename T>
+static bool changes(GLStateCache &cache, std::array<GLShadowed<T>, 2> &faces, const GLenum face, const T &value) {
+    const bool front = face != GL_BACK;
+    const bool back = face != GL_FRONT;
+    const bool same = (!front || (faces[0].known && faces[0].value == value)) && (!back || (faces[1].known && faces[1].value == value));
+    count(cache, !same);
+    if (same)
+        return false;
+
+    if (front)
+        faces[0] = { value, true };
+    if (back)
+        faces[1] = { value, true };
+    return true;
+}
+
+static GLShadowed<bool> *capability_shadow(GLShadowState &shadow, const GLenum capability) {
+    switch (capability) {
+    case GL_BLEND:
+        return &shadow.blend;
+    case GL_CULL_FACE:
+        return &shadow.cull_face;
+    case GL_DEPTH_TEST:
+        return &shadow.depth_test;
+    case GL_STENCIL_TEST:
+        return &shadow.stencil_test;
+    case GL_SCISSOR_TEST:
+        return &shadow.scissor_test;
+    default:
+        return nullptr;
+    }
+}
+
+void invalidate(GLStateCache &cache) {
+    // Draws still expect their textures on the units they were set to, whatever was bound there in between.
+    for (GLuint unit = 0; unit < SCE_GXM_MAX_TEXTURE_UNITS; unit++) {
+        const GLShadowed<GLuint> &texture = cache.shadow.textures[unit];
+        if (texture.known && !(cache.pending_texture_units & (1u << unit))) {
+            cache.pending_textures[unit] = texture.value;
+            cache.pending_texture_units |= 1u << unit;
+        }
+    }
+
+    cache.shadow = {};
+}
+
+void use_program(GLStateCache &cache, const GLuint program) {
+    if (changes(cache, cache.shadow.program, program))
+        glUseProgram(program);
+}
+
+void set_capability(GLStateCache &cache, const GLenum capability, const bool enabled) {
+    GLShadowed<bool> *const shadowed = capability_shadow(cache.shadow, capability);
+    if (shadowed == nullptr)
+        count(cache, true);
+    else if (!changes(cache, *shadowed, enabled))
+        return;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void set_color_mask(GLStateCache &cache, const GLboolean red, const GLboolean green, const GLboolean blue, const GLboolean alpha) {
+    if (changes(cache, cache.shadow.color_mask, { red, green, blue, alpha }))
+        glColorMask(red, green, blue, alpha);
+}
+
+void set_blend_equation(GLStateCache &cache, const GLenum color, const GLenum alpha) {
+    if (changes(cache, cache.shadow.blend_equation, { color, alpha }))
+        glBlendEquationSeparate(color, alpha);
+}
+
+void set_blend_func(GLStateCache &cache, const GLenum color_src, const GLenum color_dst, const GLenum alpha_src, const GLenum alpha_dst) {
+    if (changes(cache, cache.shadow.blend_func, { color_src, color_dst, alpha_src, alpha_dst }))
+        glBlendFuncSeparate(color_src, color_dst, alpha_src, alpha_dst);
+}
+
+void set_depth_func(GLStateCache &cache, const GLenum func) {
+    if (changes(cache, cache.shadow.depth_func, func))
+        glDepthFunc(func);
+}
+
+void set_depth_mask(GLStateCache &cache, const GLboolean mask) {
+    if (changes(cache, cache.shadow.depth_mask, mask))
+        glDepthMask(mask);
+}
+
+void set_cull_face(GLStateCache &cache, const GLenum mode) {
+    if (changes(cache, cache.shadow.cull_face_mode, mode))
+        glCullFace(mode);
+}
+
+void set_stencil_op(GLStateCache &cache, const GLenum face, const GLenum stencil_fail, const GLenum depth_fail, const GLenum depth_pass) {
+    if (changes(cache, cache.shadow.stencil_op, face, GLStencilOp{ stencil_fail, depth_fail, depth_pass }))
+        glStencilOpSeparate(face, stencil_fail, depth_fail, depth_pass);
+}
+
+void set_stencil_func(GLStateCache &cache, const GLenum face, const GLenum func, const GLint ref, const GLuint compare_mask) {
+    if (changes(cache, cache.shadow.stencil_func, face, GLStencilFunc{ func, ref, compare_mask }))
+        glStencilFuncSeparate(face, func, ref, compare_mask);
+}
+
+void set_stencil_write_mask(GLStateCache &cache, const GLenum face, const GLuint mask) {
+    if (changes(cache, cache.shadow.stencil_write_mask, face, mask))
+        glStencilMaskSeparate(face, mask);
+}
+
+void set_polygon_mode(GLStateCache &cache, const GLenum mode) {
+    if (changes(cache, cache.shadow.polygon_mode, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void set_line_width(GLStateCache &cache, const GLfloat width) {
+    if (changes(cache, cache.shadow.line_width, width))
+        glLineWidth(width);
+}
+
+void set_point_size(GLStateCache &cache, const GLfloat size) {
+    if (changes(cache, cache.shadow.point_size, size))
+        glPointSize(size);
+}
+
+void set_polygon_offset(GLStateCache &cache, const GLfloat factor, const GLfloat units) {
+    if (changes(cache, cache.shadow.polygon_offset, { factor, units }))
+        glPolygonOffset(factor, units);
+}
+
+void set_viewport(GLStateCache &cache, const GLfloat x, const GLfloat y, const GLfloat w, const GLfloat h) {
+    if (changes(cache, cache.shadow.viewport, { x, y, w, h }))
+        glViewportIndexedf(0, x, y, w, h);
+}
+
+void set_depth_range(GLStateCache &cache, const GLdouble near_val, const GLdouble far_val) {
+    if (changes(cache, cache.shadow.depth_range, { near_val, far_val }))
+        glDepthRange(near_val, far_val);
+}
+
+void set_scissor(GLStateCache &cache, const GLint x, const GLint y, const GLsizei w, const GLsizei h) {
+    if (changes(cache, cache.shadow.scissor, { x, y, w, h }))
+        glScissor(x, y, w, h);
+}
+
+void set_active_texture(GLStateCache &cache, const GLuint unit) {
+    if (changes(cache, cache.shadow.active_texture_unit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void queue_texture_bind(GLStateCache &cache, const GLuint unit, const GLuint texture) {
+    const uint32_t unit_bit = 1u << unit;
+
+    // The earlier bind never reached the driver.
+    if (cache.pending_texture_units & unit_bit)
+        count(cache, false);
+
+    cache.pending_textures[unit] = texture;
+    cache.pending_texture_units |= unit_bit;
+}
+
+void bind_texture_now(GLStateCache &cache, const GLuint unit, const GLuint texture) {
+    if (cache.pending_texture_units & (1u << unit)) {
+        cache.pending_texture_units &= ~(1u << unit);
+        count(cache, false);
+    }
+
+    set_active_texture(cache, unit);
+    if (changes(cache, cache.shadow.textures[unit], texture))
+        glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void flush_texture_binds(GLStateCache &cache) {
+    if (cache.pending_texture_units == 0)
+        return;
+
+    R_PROFILE(__func__);
+
+    uint32_t units = 0;
+    for (GLuint unit = 0; unit < SCE_GXM_MAX_TEXTURE_UNITS; unit++) {
+        if (!(cache.pending_texture_units & (1u << unit)))
+            continue;
+
+        GLShadowed<GLuint> &texture = cache.shadow.textures[unit];
+        if (texture.known && texture.value == cache.pending_textures[unit]) {
+            count(cache, false);
+            continue;
+        }
+
+        texture = { cache.pending_textures[unit], true };
+        units |= 1u << unit;
+    }
+    cache.pending_texture_units = 0;
+
+    if (cache.multi_bind) {
+        // One call per run of consecutive units, samplers are usually packed from unit 0.
+        GLuint unit = 0;
+        while (unit < SCE_GXM_MAX_TEXTURE_UNITS) {
+            if (!(units & (1u << unit))) {
+                unit++;
+                continue;
+            }
+
+            const GLuint first = unit;
+            while (unit < SCE_GXM_MAX_TEXTURE_UNITS && (units & (1u << unit)))
+                unit++;
+
+            glBindTextures(first, unit - first, &cache.pending_textures[first]);
+            count(cache, true);
+        }
+        return;
+    }
+
+    for (GLuint unit = 0; unit < SCE_GXM_MAX_TEXTURE_UNITS; unit++) {
+        if (!(units & (1u << unit)))
+            continue;
+
+        set_active_texture(cache, unit);
+        glBindTexture(GL_TEXTURE_2D, cache.pending_textures[unit]);
+        count(cache, true);
+    }
+}
+} // namespace renderer::gl::state_cache
@@ -91,13 +91,13 @@ static GLenum translate_stencil_func(SceGxmStencilFunc stencil_func) {
     return GL_ALWAYS;
 }
 
-static void set_stencil_state(GLenum face, const GxmStencilState &state) {
-    glStencilOpSeparate(face,
+static void set_stencil_state(GLStateCache &cache, GLenum face, const GxmStencilState &state) {
+    state_cache::set_stencil_op(cache, face,
         translate_stencil_op(state.stencil_fail),
         translate_stencil_op(state.depth_fail),
         translate_stencil_op(state.depth_pass));
-    glStencilFuncSeparate(face, translate_stencil_func(state.func), state.ref, state.compare_mask);
-    glStencilMaskSeparate(face, state.write_mask);
+    state_cache::set_stencil_func(cache, face, translate_stencil_func(state.func), state.ref, state.compare_mask);
+    state_cache::set_stencil_write_mask(cache, face, state.write_mask);
 }
 
 void sync_mask(GLContext &context, const GxmContextState &state, const MemState &mem) {
@@ -140,8 +140,8 @@ void sync_viewport(GLContext &context, const GxmContextState &state, const bool
             context.viewport_flip[3] = 1.0f;
         }
 
-        glViewportIndexedf(0, x, hardware_flip ? y : display_h - h - y, w, h);
-        glDepthRange(viewport.offset.z - viewport.scale.z, viewport.offset.z + viewport.scale.z);
+        state_cache::set_viewport(context.state_cache, x, hardware_flip ? y : display_h - h - y, w, h);
+        state_cache::set_depth_range(context.state_cache, viewport.offset.z - viewport.scale.z, viewport.offset.z + viewport.scale.z);
     } else {
         if (hardware_flip) {
             context.viewport_flip[0] = 1.0f;
@@ -150,8 +150,8 @@ void sync_viewport(GLContext &context, const GxmContextState &state, const bool
             context.viewport_flip[3] = 1.0f;
         }
 
-        glViewport(0, 0, display_w, display_h);
-        glDepthRange(0, 1);
+        state_cache::set_viewport(context.state_cache, 0, 0, static_cast<GLfloat>(display_w), static_cast<GLfloat>(display_h));
+        state_cache::set_depth_range(context.state_cache, 0, 1);
     }
 }
 
@@ -169,19 +169,19 @@ void sync_clipping(GLContext &context, const GxmContextState &state, const bool
     const GLsizei scissor_h = state.region_clip_max.y - state.region_clip_min.y + 1;
     switch (state.region_clip_mode) {
     case SCE_GXM_REGION_CLIP_NONE:
-        glDisable(GL_SCISSOR_TEST);
+        state_cache::set_capability(context.state_cache, GL_SCISSOR_TEST, false);
         break;
     case SCE_GXM_REGION_CLIP_ALL:
-        glEnable(GL_SCISSOR_TEST);
-        glScissor(0, 0, 0, 0);
+        state_cache::set_capability(context.state_cache, GL_SCISSOR_TEST, true);
+        state_cache::set_scissor(context.state_cache, 0, 0, 0, 0);
         break;
     case SCE_GXM_REGION_CLIP_OUTSIDE:
-        glEnable(GL_SCISSOR_TEST);
-        glScissor(scissor_x, scissor_y, scissor_w, scissor_h);
+        state_cache::set_capability(context.state_cache, GL_SCISSOR_TEST, true);
+        state_cache::set_scissor(context.state_cache, scissor_x, scissor_y, scissor_w, scissor_h);
         break;
     case SCE_GXM_REGION_CLIP_INSIDE:
         // TODO: Implement SCE_GXM_REGION_CLIP_INSIDE
-        glDisable(GL_SCISSOR_TEST);
+        state_cache::set_capability(context.state_cache, GL_SCISSOR_TEST, false);
         LOG_WARN("Unimplemented region clip mode used: SCE_GXM_REGION_CLIP_INSIDE");
         break;
     }
@@ -191,84 +191,84 @@ void sync_cull(GLContext &context, const GxmContextState &state) {
     // Culling.
     switch (state.cull_mode) {
     case SCE_GXM_CULL_CCW:
-        glEnable(GL_CULL_FACE);
-        glCullFace(context.viewport_flip[1] == 1.0f ? GL_FRONT : GL_BACK);
+        state_cache::set_capability(context.state_cache, GL_CULL_FACE, true);
+        state_cache::set_cull_face(context.state_cache, context.viewport_flip[1] == 1.0f ? GL_FRONT : GL_BACK);
         break;
     case SCE_GXM_CULL_CW:
-        glEnable(GL_CULL_FACE);
-        glCullFace(context.viewport_flip[1] == 1.0f ? GL_BACK : GL_FRONT);
+        state_cache::set_capability(context.state_cache, GL_CULL_FACE, true);
+        state_cache::set_cull_face(context.state_cache, context.viewport_flip[1] == 1.0f ? GL_BACK : GL_FRONT);
         break;
     case SCE_GXM_CULL_NONE:
-        glDisable(GL_CULL_FACE);
+        state_cache::set_capability(context.state_cache, GL_CULL_FACE, false);
         break;
     }
 }
 
-void sync_front_depth_func(const GxmContextState &state) {
-    glDepthFunc(translate_depth_func(state.front_depth_func));
+void sync_front_depth_func(GLContext &context, const GxmContextState &state) {
+    state_cache::set_depth_func(context.state_cache, translate_depth_func(state.front_depth_func));
 }
 
-void sync_front_depth_write_enable(const GxmContextState &state) {
-    glDepthMask(state.front_depth_write_enable == SCE_GXM_DEPTH_WRITE_ENABLED ? GL_TRUE : GL_FALSE);
+void sync_front_depth_write_enable(GLContext &context, const GxmContextState &state) {
+    state_cache::set_depth_mask(context.state_cache, state.front_depth_write_enable == SCE_GXM_DEPTH_WRITE_ENABLED ? GL_TRUE : GL_FALSE);
 }
 
-bool sync_depth_data(const GxmContextState &state) {
+bool sync_depth_data(GLContext &context, const GxmContextState &state) {
     // Depth test.
     if (state.depth_stencil_surface.depthData) {
-        glEnable(GL_DEPTH_TEST);
+        state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, true);
         return true;
     }
 
-    glDisable(GL_DEPTH_TEST);
+    state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, false);
     return false;
 }
 
-void sync_stencil_func(const GxmContextState &state, const MemState &mem, const bool is_back_stencil) {
-    set_stencil_state(is_back_stencil ? GL_BACK : GL_FRONT, is_back_stencil ? state.back_stencil : state.front_stencil);
+void sync_stencil_func(GLContext &context, const GxmContextState &state, const MemState &mem, const bool is_back_stencil) {
+    set_stencil_state(context.state_cache, is_back_stencil ? GL_BACK : GL_FRONT, is_back_stencil ? state.back_stencil : state.front_stencil);
 }
 
-bool sync_stencil_data(const GxmContextState &state, const MemState &mem) {
+bool sync_stencil_data(GLContext &context, const GxmContextState &state, const MemState &mem) {
     // Stencil.
     if (state.depth_stencil_surface.stencilData) {
-        glEnable(GL_STENCIL_TEST);
-        glStencilMask(GL_TRUE);
+        state_cache::set_capability(context.state_cache, GL_STENCIL_TEST, true);
+        state_cache::set_stencil_write_mask(context.state_cache, GL_FRONT_AND_BACK, GL_TRUE);
         glClearStencil(state.depth_stencil_surface.control.get(mem)->backgroundStencil);
         glClear(GL_STENCIL_BUFFER_BIT);
         return true;
     }
 
-    glDisable(GL_STENCIL_TEST);
+    state_cache::set_capability(context.state_cache, GL_STENCIL_TEST, false);
     return false;
 }
 
-void sync_front_polygon_mode(const GxmContextState &state) {
+void sync_front_polygon_mode(GLContext &context, const GxmContextState &state) {
     // Polygon Mode.
     switch (state.front_polygon_mode) {
     case SCE_GXM_POLYGON_MODE_POINT_10UV:
     case SCE_GXM_POLYGON_MODE_POINT:
     case SCE_GXM_POLYGON_MODE_POINT_01UV:
     case SCE_GXM_POLYGON_MODE_TRIANGLE_POINT:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+        state_cache::set_polygon_mode(context.state_cache, GL_POINT);
         break;
     case SCE_GXM_POLYGON_MODE_LINE:
     case SCE_GXM_POLYGON_MODE_TRIANGLE_LINE:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        state_cache::set_polygon_mode(context.state_cache, GL_LINE);
         break;
     case SCE_GXM_POLYGON_MODE_TRIANGLE_FILL:
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        state_cache::set_polygon_mode(context.state_cache, GL_FILL);
         break;
     }
 }
 
-void sync_front_point_line_width(const GxmContextState &state) {
+void sync_front_point_line_width(GLContext &context, const GxmContextState &state) {
     // Point Line Width
-    glLineWidth(static_cast<GLfloat>(state.front_point_line_width));
-    glPointSize(static_cast<GLfloat>(state.front_point_line_width));
+    state_cache::set_line_width(context.state_cache, static_cast<GLfloat>(state.front_point_line_width));
+    state_cache::set_point_size(context.state_cache, static_cast<GLfloat>(state.front_point_line_width));
 }
 
-void sync_front_depth_bias(const GxmContextState &state) {
+void sync_front_depth_bias(GLContext &context, const GxmContextState &state) {
     // Depth Bias
-    glPolygonOffset(static_cast<GLfloat>(state.front_depth_bias_factor), static_cast<GLfloat>(state.front_depth_bias_units));
+    state_cache::set_polygon_offset(context.state_cache, static_cast<GLfloat>(state.front_depth_bias_factor), static_cast<GLfloat>(state.front_depth_bias_units));
 }
 
 void sync_texture(GLContext &context, const GxmContextState &state, const MemState &mem, std::size_t index,
@@ -280,7 +280,7 @@ void sync_texture(GLContext &context, const GxmContextState &state, const MemSta
         return;
     }
 
-    glActiveTexture(static_cast<GLenum>(static_cast<std::size_t>(GL_TEXTURE0) + index));
+    context.texture_cache.unit = static_cast<GLuint>(index);
 
     if (enable_texture_cache) {
         renderer::texture::cache_and_bind_texture(context.texture_cache, texture, mem);
@@ -304,25 +304,26 @@ void sync_texture(GLContext &context, const GxmContextState &state, const MemSta
                 break;
             }
         }
+        state_cache::flush_texture_binds(context.state_cache);
+        state_cache::set_active_texture(context.state_cache, static_cast<GLuint>(index));
         renderer::gl::texture::dump(texture, mem, parameter_name, base_path, title_id, program_hash);
     }
-
-    glActiveTexture(GL_TEXTURE0);
 }
 
-void sync_blending(const GxmContextState &state, const MemState &mem) {
+void sync_blending(GLContext &context, const GxmContextState &state, const MemState &mem) {
     // Blending.
     const SceGxmFragmentProgram &gxm_fragment_program = *state.fragment_program.get(mem);
     const GLFragmentProgram &fragment_program = *reinterpret_cast<GLFragmentProgram *>(
         gxm_fragment_program.renderer_data.get());
 
-    glColorMask(fragment_program.color_mask_red, fragment_program.color_mask_green, fragment_program.color_mask_blue, fragment_program.color_mask_alpha);
+    GLStateCache &cache = context.state_cache;
+    state_cache::set_color_mask(cache, fragment_program.color_mask_red, fragment_program.color_mask_green, fragment_program.color_mask_blue, fragment_program.color_mask_alpha);
     if (fragment_program.blend_enabled) {
-        glEnable(GL_BLEND);
-        glBlendEquationSeparate(fragment_program.color_func, fragment_program.alpha_func);
-        glBlendFuncSeparate(fragment_program.color_src, fragment_program.color_dst, fragment_program.alpha_src, fragment_program.alpha_dst);
+        state_cache::set_capability(cache, GL_BLEND, true);
+        state_cache::set_blend_equation(cache, fragment_program.color_func, fragment_program.alpha_func);
+        state_cache::set_blend_func(cache, fragment_program.color_src, fragment_program.color_dst, fragment_program.alpha_src, fragment_program.alpha_dst);
     } else {
-        glDisable(GL_BLEND);
+        state_cache::set_capability(cache, GL_BLEND, false);
     }
 }
 
@@ -336,8 +337,9 @@ void sync_vertex_attributes(GLContext &context, const GxmContextState &state, co
         const GLboolean normalised = attribute_format_normalised(attribute_format);
         const int attrib_location = attribute.regIndex / sizeof(uint32_t);
 
-        glBindBuffer(GL_ARRAY_BUFFER, context.stream_vertex_buffers[attribute.streamIndex]);
-        glVertexAttribPointer(attrib_location, attribute.componentCount, type, normalised, stream.stride, reinterpret_cast<const GLvoid *>(attribute.offset));
+        const VertexStreamBinding &binding = context.stream_bindings[attribute.streamIndex];
+        glBindBuffer(GL_ARRAY_BUFFER, binding.buffer);
+        glVertexAttribPointer(attrib_location, attribute.componentCount, type, normalised, stream.stride, reinterpret_cast<const GLvoid *>(binding.offset + attribute.offset));
         glEnableVertexAttribArray(attrib_location);
     }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -356,27 +358,27 @@ bool sync_state(GLContext &context, const GxmContextState &state, const MemState
     sync_clipping(context, state, hardware_flip);
     sync_cull(context, state);
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
+    state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, true);
+    state_cache::set_depth_mask(context.state_cache, GL_TRUE);
     glClearDepth(state.depth_stencil_surface.backgroundDepth);
     glClear(GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
+    state_cache::set_capability(context.state_cache, GL_DEPTH_TEST, false);
 
     sync_mask(context, state, mem);
 
-    if (sync_depth_data(state)) {
-        sync_front_depth_func(state);
-        sync_front_depth_write_enable(state);
+    if (sync_depth_data(context, state)) {
+        sync_front_depth_func(context, state);
+        sync_front_depth_write_enable(context, state);
     }
 
-    if (sync_stencil_data(state, mem)) {
-        set_stencil_state(GL_BACK, state.back_stencil);
-        set_stencil_state(GL_FRONT, state.front_stencil);
+    if (sync_stencil_data(context, state, mem)) {
+        set_stencil_state(context.state_cache, GL_BACK, state.back_stencil);
+        set_stencil_state(context.state_cache, GL_FRONT, state.front_stencil);
     }
 
-    sync_front_polygon_mode(state);
-    sync_front_depth_bias(state);
-    sync_blending(state, mem);
+    sync_front_polygon_mode(context, state);
+    sync_front_depth_bias(context, state);
+    sync_blending(context, state, mem);
 
     // Textures.
     for (size_t i = 0; i < fragment_gxp.parameter_count; ++i) {
@@ -391,7 +393,6 @@ bool sync_state(GLContext &context, const GxmContextState &state, const MemState
         }
         sync_texture(context, state, mem, texture_unit, enable_texture_cache, base_path, title_id);
     }
-    glActiveTexture(GL_TEXTURE0);
 
     // Uniforms.
     sync_vertex_attributes(context, state, mem);
@@ -1,13 +1,11 @@
 #include <renderer/functions.h>
 #include <renderer/profile.h>
-#include <renderer/pvrt-dec.h>
 
 #include <renderer/gl/functions.h>
 #include <renderer/gl/types.h>
 
 #include <gxm/functions.h>
 #include <mem/ptr.h>
-#include <util/align.h>
 #include <util/log.h>
 
 #include <stb_image_write.h>
@@ -18,15 +16,11 @@ namespace renderer::gl {
 namespace texture {
 void bind_texture(GLTextureCacheState &cache, const SceGxmTexture &gxm_texture, const MemState &mem) {
     R_PROFILE(__func__);
-    glBindTexture(GL_TEXTURE_2D, cache.textures[0]);
+    state_cache::bind_texture_now(*cache.state_cache, cache.unit, cache.textures[0]);
     configure_bound_texture(gxm_texture);
     upload_bound_texture(gxm_texture, mem);
 }
 
-static bool can_texture_be_unswizzled_without_decode(SceGxmTextureBaseFormat fmt) {
-    return (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_P8 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8);
-}
-
 void configure_bound_texture(const SceGxmTexture &gxm_texture) {
     R_PROFILE(__func__);
 
@@ -59,7 +53,7 @@ void configure_bound_texture(const SceGxmTexture &gxm_texture) {
     while (mip_index < gxm_texture.mip_count + 1 && width && height) {
         if (!is_swizzled && renderer::texture::is_compressed_format(base_fmt, width, height, compressed_size)) {
             glCompressedTexImage2D(GL_TEXTURE_2D, mip_index, internal_format, width, height, 0, static_cast<GLsizei>(compressed_size), nullptr);
-        } else if (!is_swizzled || (is_swizzled && can_texture_be_unswizzled_without_decode(base_fmt))) {
+        } else if (!is_swizzled || (is_swizzled && renderer::texture::can_texture_be_unswizzled_without_decode(base_fmt))) {
             glTexImage2D(GL_TEXTURE_2D, mip_index, internal_format, width, height, 0, format, type, nullptr);
         } else {
             if (is_swizzled) {
@@ -74,215 +68,82 @@ void configure_bound_texture(const SceGxmTexture &gxm_texture) {
     }
 }
 
-/**
- * \brief Try to decompress texture to 32-bit RGBA.
- * 
- * \param fmt    Texture base format.
- * \param dest   Destination texture data. Size must be sufficient enough of align(width, 4) * height * 4 (bytes).
- * \param data   Source data to decompress.
- * \param width  Texture width.
- * \param height Texture height.
- * 
- * \return Size of source taken.
- */
-static size_t decompress_compressed_swizz_texture(SceGxmTextureBaseFormat fmt, void *dest, const void *data, const std::uint32_t width, const std::uint32_t height) {
-    int ubc_type = 0;
-
-    switch (fmt) {
-    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
-        ubc_type = 1;
-        break;
-
-    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC2:
-        ubc_type = 2;
-        break;
-
-    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC3:
-        ubc_type = 3;
-        break;
-
-    default:
-        break;
-    }
-
-    if (ubc_type) {
-        renderer::texture::decompress_bc_swizz_image(width, height, reinterpret_cast<const std::uint8_t *>(data),
-            reinterpret_cast<std::uint32_t *>(dest), ubc_type);
-        return (((width + 3) / 4) * ((height + 3) / 4) * ((ubc_type > 1) ? 16 : 8));
-    } else if ((fmt >= SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP) && (fmt <= SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP)) {
-        // TODO, is not perfect for PVRT-II.
-        pvr::PVRTDecompressPVRTC(data, (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP) || (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP), width, height,
-            (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP) || (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP), reinterpret_cast<uint8_t *>(dest));
-        // TODO, calcule return is not sur.
-        return ((width + 3) / 4) * ((height + 3) / 4);
-    }
-
-    return 0;
-}
-
-void upload_bound_texture(const SceGxmTexture &gxm_texture, const MemState &mem) {
+static void upload_decoded_texture(const renderer::TextureDecodeJob &job) {
     R_PROFILE(__func__);
 
-    const SceGxmTextureFormat fmt = gxm::get_format(&gxm_texture);
-    auto width = static_cast<uint32_t>(gxm::get_width(&gxm_texture));
-    auto height = static_cast<uint32_t>(gxm::get_height(&gxm_texture));
-    const Ptr<uint8_t> data(gxm_texture.data_addr << 2);
-    uint8_t *texture_data = data.get(mem);
-    std::vector<uint8_t> texture_data_decompressed;
-    std::vector<uint8_t> texture_pixels_lineared; // TODO Move to context to avoid frequent allocation?
-    std::vector<uint32_t> palette_texture_pixels;
-    std::vector<uint8_t> yuv_texture_pixels;
-
-    const void *pixels = nullptr;
-
-    size_t pixels_per_stride = 0;
-    const auto base_format = gxm::get_base_format(fmt);
-    size_t bpp = renderer::texture::bits_per_pixel(base_format);
-    size_t bytes_per_pixel = (bpp + 7) >> 3;
-
-    const auto texture_type = gxm_texture.texture_type();
-    const bool is_swizzled = (texture_type == SCE_GXM_TEXTURE_SWIZZLED) || (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY);
-    const bool need_decompress_and_unswizzle_on_cpu = is_swizzled && !can_texture_be_unswizzled_without_decode(base_format);
-
-    uint32_t mip_index = 0;
-    size_t source_size = 0;
-    std::uint32_t org_width = width;
-    std::uint32_t org_height = height;
-
-    while (mip_index < gxm_texture.mip_count + 1 && width && height) {
-        pixels = texture_data;
-
-        switch (texture_type) {
-        case SCE_GXM_TEXTURE_SWIZZLED:
-        case SCE_GXM_TEXTURE_TILED:
-        case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY: {
-            if (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY) {
-                width = nearest_power_of_two(width);
-                height = nearest_power_of_two(height);
-            }
+    const SceGxmTextureFormat fmt = gxm::get_format(&job.texture);
+    const GLenum format = translate_format(fmt);
+    const GLenum type = translate_type(fmt);
 
-            if (need_decompress_and_unswizzle_on_cpu) {
-                // Must decompress them
-                texture_data_decompressed.resize(width * height * 4);
-                source_size = decompress_compressed_swizz_texture(base_format, texture_data_decompressed.data(), pixels, width, height);
-                bytes_per_pixel = 4;
-                bpp = 32;
-                pixels = texture_data_decompressed.data();
-            }
+    for (size_t mip_index = 0; mip_index < job.mips.size(); mip_index++) {
+        const renderer::TextureDecodeMip &mip = job.mips[mip_index];
+        const GLint level = static_cast<GLint>(mip_index);
 
-            if (!((base_format >= SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP) && (base_format <= SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP))) {
-                // Convert data
-                texture_pixels_lineared.resize(width * height * bytes_per_pixel);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(mip.pixels_per_stride));
 
-                if (is_swizzled)
-                    renderer::texture::swizzled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), width, height,
-                        static_cast<std::uint8_t>(bpp));
-                else
-                    renderer::texture::tiled_texture_to_linear_texture(texture_pixels_lineared.data(), reinterpret_cast<const uint8_t *>(pixels), width, height,
-                        static_cast<std::uint8_t>(bpp));
+        if (job.rgba)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels);
+        else if (mip.compressed_size)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height, format, static_cast<GLsizei>(mip.compressed_size), mip.pixels);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height, format, type, mip.pixels);
+    }
 
-                pixels = texture_pixels_lineared.data();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
 
-                if (need_decompress_and_unswizzle_on_cpu)
-                    texture_data_decompressed.clear();
-            }
+void upload_bound_texture(const SceGxmTexture &gxm_texture, const MemState &mem) {
+    R_PROFILE(__func__);
 
-            pixels_per_stride = width;
+    // Only used from the render thread, kept to reuse its staging buffer.
+    static renderer::TextureDecodeJob job;
 
-            if (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY) {
-                width = org_width;
-                height = org_height;
-            }
+    if (renderer::texture::prepare_texture_decode(job, gxm_texture, mem)) {
+        for (size_t mip_index = 0; mip_index < job.mips.size(); mip_index++)
+            renderer::texture::decode_texture_mip(job, mip_index);
+    }
 
-            break;
-        }
-        case SCE_GXM_TEXTURE_LINEAR:
-            pixels_per_stride = (width + 7) & ~7;
+    upload_decoded_texture(job);
+}
 
-            break;
-        case SCE_GXM_TEXTURE_LINEAR_STRIDED:
-            pixels_per_stride = gxm::get_stride_in_bytes(&gxm_texture) / bytes_per_pixel;
+bool queue_texture_upload(GLTextureCacheState &cache, std::size_t index, const SceGxmTexture &gxm_texture, const MemState &mem) {
+    const renderer::TextureDecodeJobPtr job = renderer::texture::create_texture_decode_job(cache.decoder);
+    if (!renderer::texture::prepare_texture_decode(*job, gxm_texture, mem)) {
+        renderer::texture::recycle_texture_decode_job(cache.decoder, *job);
+        return false;
+    }
 
-            break;
-        default:
-            LOG_ERROR("Uniplemented Texture type: {} ", log_hex(gxm_texture.texture_type()));
-            pixels_per_stride = (width + 7) & ~7; // NOTE: This is correct only with linear textures.
+    job->slot = index;
+    job->id = cache.next_decode_id++;
+    cache.pending_decodes[index] = job->id;
+    renderer::texture::submit_texture_decode(cache.decoder, job);
 
-            break;
-        }
+    return true;
+}
 
-        if (gxm::is_paletted_format(fmt)) {
-            const uint32_t *const palette_bytes = renderer::texture::get_texture_palette(gxm_texture, mem);
-            palette_texture_pixels.resize(width * height * 4);
-            if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
-                renderer::texture::palette_texture_to_rgba_8(palette_texture_pixels.data(),
-                    reinterpret_cast<const uint8_t *>(pixels), width, height, palette_bytes);
-            } else {
-                renderer::texture::palette_texture_to_rgba_4(palette_texture_pixels.data(),
-                    reinterpret_cast<const uint8_t *>(pixels), width, height, palette_bytes);
-            }
-            pixels = palette_texture_pixels.data();
-            pixels_per_stride = width;
-        }
+void upload_decoded_textures(GLTextureCacheState &cache) {
+    renderer::texture::take_decoded_textures(cache.decoder, cache.decoded);
+    if (cache.decoded.empty())
+        return;
 
-        if (gxm::is_yuv_format(fmt)) {
-            switch (fmt) {
-            case SCE_GXM_TEXTURE_FORMAT_YUV420P2_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YVU420P2_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YUV420P2_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_YVU420P2_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_YUV420P3_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YVU420P3_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YUV420P3_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_YVU420P3_CSC1: {
-                yuv_texture_pixels.resize(width * height * 3);
-                renderer::texture::yuv420_texture_to_rgb(yuv_texture_pixels.data(),
-                    reinterpret_cast<const uint8_t *>(pixels), width, height);
-                pixels = yuv_texture_pixels.data();
-                pixels_per_stride = width;
-                break;
-            }
+    R_PROFILE(__func__);
 
-            case SCE_GXM_TEXTURE_FORMAT_YUYV422_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YVYU422_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_UYVY422_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_VYUY422_CSC0:
-            case SCE_GXM_TEXTURE_FORMAT_YUYV422_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_YVYU422_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_UYVY422_CSC1:
-            case SCE_GXM_TEXTURE_FORMAT_VYUY422_CSC1:
-                assert(false);
-            default:
-                assert(false);
-            }
-        }
+    GLint bound_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound_texture);
 
-        const GLenum format = translate_format(fmt);
-        const GLenum type = translate_type(fmt);
-
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(pixels_per_stride));
-
-        if (need_decompress_and_unswizzle_on_cpu)
-            glTexSubImage2D(GL_TEXTURE_2D, mip_index, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-        else {
-            size_t compressed_size = 0;
-            if (renderer::texture::is_compressed_format(gxm::get_base_format(fmt), width, height, compressed_size)) {
-                source_size = compressed_size;
-                glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_index, 0, 0, width, height, format, static_cast<GLsizei>(compressed_size), pixels);
-            } else {
-                source_size = (width * height * (bpp + 7)) >> 3;
-                glTexSubImage2D(GL_TEXTURE_2D, mip_index, 0, 0, width, height, format, type, pixels);
-            }
+    for (const renderer::TextureDecodeJobPtr &job : cache.decoded) {
+        // The slot was given to another texture, or a newer upload is on its way.
+        if (cache.pending_decodes[job->slot] == job->id) {
+            cache.pending_decodes[job->slot] = 0;
+            glBindTexture(GL_TEXTURE_2D, cache.textures[job->slot]);
+            upload_decoded_texture(*job);
         }
 
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-
-        mip_index++;
-        width /= 2;
-        height /= 2;
-
-        texture_data += source_size;
+        renderer::texture::recycle_texture_decode_job(cache.decoder, *job);
     }
+
+    glBindTexture(GL_TEXTURE_2D, bound_texture);
+    cache.decoded.clear();
 }
 
 // Dumps bound texture to a file
@@ -312,7 +173,7 @@ void dump(const SceGxmTexture &gxm_texture, const MemState &mem, const std::stri
     const SceGxmTextureBaseFormat base_format = gxm::get_base_format(format);
 
     const bool is_swizzled = (gxm_texture.texture_type() == SCE_GXM_TEXTURE_SWIZZLED) || (gxm_texture.texture_type() == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY);
-    const bool need_decompress_and_unswizzle_on_cpu = is_swizzled && !can_texture_be_unswizzled_without_decode(base_format);
+    const bool need_decompress_and_unswizzle_on_cpu = is_swizzled && !renderer::texture::can_texture_be_unswizzled_without_decode(base_format);
 
     size_t bpp = renderer::texture::bits_per_pixel(base_format);
     const size_t stride = (width + 7) & ~7; // NOTE: This is correct only with linear textures.
@@ -43,16 +43,14 @@ static const GLint swizzle_rgb1[4] = { GL_ONE, GL_BLUE, GL_GREEN, GL_RED };
 static const GLint swizzle_bgr1[4] = { GL_ONE, GL_RED, GL_GREEN, GL_BLUE };
 
 // SceGxmTextureSwizzleYUV420Mode
-// TODO I don't know what these should be.
-// NOTE: We'll probably need an intermediate shader pass to translate them to RGB.
+// These are converted to RGBA on the CPU, the swizzle only picks the chroma order and colour matrix there.
 static const GLint swizzle_yuv_csc0[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 static const GLint swizzle_yvu_csc0[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 static const GLint swizzle_yuv_csc1[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 static const GLint swizzle_yvu_csc1[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 
 // SceGxmTextureSwizzleYUV422Mode
-// TODO I don't know what these should be.
-// NOTE: We'll probably need an intermediate shader pass to translate them to RGB.
+// Converted to RGBA on the CPU as well.
 static const GLint swizzle_yuyv_csc0[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 static const GLint swizzle_yvyu_csc0[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
 static const GLint swizzle_uyvy_csc0[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
@@ -315,12 +313,10 @@ GLenum translate_format(SceGxmTextureFormat src) {
     case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
     case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
     case SCE_GXM_TEXTURE_BASE_FORMAT_U2F10F10F10:
-        return GL_RGBA;
-
     case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2:
     case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3:
     case SCE_GXM_TEXTURE_BASE_FORMAT_YUV422:
-        return GL_RGB;
+        return GL_RGBA;
 
     case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
         return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
@@ -426,8 +422,7 @@ GLenum translate_type(SceGxmTextureFormat format) {
     case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3:
         return GL_UNSIGNED_BYTE;
     case SCE_GXM_TEXTURE_BASE_FORMAT_YUV422:
-        LOG_WARN("Unhandled base format SCE_GXM_TEXTURE_BASE_FORMAT_YUV422");
-        return GL_BYTE;
+        return GL_UNSIGNED_BYTE;
     case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
         return GL_UNSIGNED_INT_8_8_8_8_REV;
     case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
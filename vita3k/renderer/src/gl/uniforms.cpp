@@ -101,7 +101,7 @@ void uniform_matrix_4<GLuint>(GLint location, GLsizei count, GLboolean transpose
 }
 
 template <class T>
-static void set_uniform(GLint location, size_t component_count, GLsizei array_size, const T *value, const std::string &name, bool is_matrix, bool log_uniforms) {
+static void set_uniform(GLint location, size_t component_count, GLsizei array_size, const T *value, const SceGxmProgramParameter &parameter, bool is_matrix, bool log_uniforms) {
     if (log_uniforms) {
         // warning: shit code
         std::string values = "{ ";
@@ -117,7 +117,7 @@ static void set_uniform(GLint location, size_t component_count, GLsizei array_si
         values.erase(values.size() - 1, 1);
         values += " }";
         const auto items = array_size * component_count;
-        LOG_ERROR("name: {}   loc: {}, component_count: {}, array_size: {}, values: {}{}", name, location, component_count, array_size, items > 1 ? "\n" : "", values);
+        LOG_ERROR("name: {}   loc: {}, component_count: {}, array_size: {}, values: {}{}", gxp::parameter_name(parameter), location, component_count, array_size, items > 1 ? "\n" : "", values);
     }
 
     switch (component_count) {
@@ -158,64 +158,14 @@ static void set_uniform(GLint location, size_t component_count, GLsizei array_si
     }
 }
 
-bool set_uniform(GLuint program, const SceGxmProgram &shader_program, GLShaderStatics &statics, const MemState &mem,
-    const SceGxmProgramParameter *parameter, const void *data, bool log_uniforms) {
+bool set_uniform(const UniformLocation &uniform, const SceGxmProgramParameter &parameter, const void *data, bool log_uniforms) {
     R_PROFILE(__func__);
 
-    auto name = gxp::parameter_name(*parameter);
-
-    auto &excluded_uniforms = statics.excluded_uniforms;
-    ExcludedUniform to_search{ name, program };
-
-    if (std::find(excluded_uniforms.begin(), excluded_uniforms.end(), to_search) != excluded_uniforms.end())
-        return false;
-
-    const GLint location = glGetUniformLocation(program, name.c_str());
-
-    if (location < 0) {
-        // NOTE: This can happen because the uniform isn't used in the shader, thus optimized away by the shader compiler.
-        LOG_WARN("Uniform parameter {} not found in OpenGL program {}, it will not be set again.", name, program);
-        excluded_uniforms.push_back(to_search);
+    // NOTE: The uniform can be missing because it isn't used in the shader, thus optimized away by the shader compiler.
+    if (uniform.location < 0)
         return false;
-    }
 
-    // This was added for compability with hand-written shaders. GXP shaders don't use matrix, but rather flatten them as array.
-    // Hand-written shaders usually convet them to matrix if possible. Until we get rid of hand-written shaders, this will stay here.
-    bool is_matrix = false;
-    GLenum utype{};
-
-    auto uniform_type_ite = statics.uniform_types.find(location);
-    if (uniform_type_ite == statics.uniform_types.end()) {
-        GLint total_uniforms = 0;
-        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &total_uniforms);
-
-        GLint max_uniform_name_length = 0;
-        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_uniform_name_length);
-
-        GLint usize = 0;
-
-        std::string uname;
-        uname.resize(max_uniform_name_length);
-
-        GLint written_name_length = 0;
-
-        for (GLint i = 0; i < total_uniforms; i++) {
-            glGetActiveUniform(program, i, max_uniform_name_length, &written_name_length, &usize, &utype, &uname[0]);
-            if (strncmp(name.c_str(), uname.c_str(), written_name_length) == 0) {
-                statics.uniform_types[location] = utype;
-                break;
-            }
-        }
-    } else {
-        utype = uniform_type_ite->second;
-    }
-
-    // TODO: Add more types
-    if (utype == GL_FLOAT_MAT2 || utype == GL_FLOAT_MAT3 || utype == GL_FLOAT_MAT4) {
-        is_matrix = true;
-    }
-
-    const SceGxmParameterType type = static_cast<SceGxmParameterType>(static_cast<uint16_t>(parameter->type));
+    const SceGxmParameterType type = static_cast<SceGxmParameterType>(static_cast<uint16_t>(parameter.type));
 
     const GLint *src_s32;
     const GLfloat *src_f32;
@@ -228,24 +178,24 @@ bool set_uniform(GLuint program, const SceGxmProgram &shader_program, GLShaderSt
     case SCE_GXM_PARAMETER_TYPE_S16:
     case SCE_GXM_PARAMETER_TYPE_S8:
         src_s32 = reinterpret_cast<const GLint *>(data);
-        set_uniform<GLint>(location, parameter->component_count, parameter->array_size, src_s32, name, is_matrix, log_uniforms);
+        set_uniform<GLint>(uniform.location, parameter.component_count, parameter.array_size, src_s32, parameter, uniform.is_matrix, log_uniforms);
         break;
 
     case SCE_GXM_PARAMETER_TYPE_U32:
     case SCE_GXM_PARAMETER_TYPE_U16:
     case SCE_GXM_PARAMETER_TYPE_U8:
         src_u32 = reinterpret_cast<const GLuint *>(data);
-        set_uniform<GLuint>(location, parameter->component_count, parameter->array_size, src_u32, name, is_matrix, log_uniforms);
+        set_uniform<GLuint>(uniform.location, parameter.component_count, parameter.array_size, src_u32, parameter, uniform.is_matrix, log_uniforms);
         break;
 
     case SCE_GXM_PARAMETER_TYPE_F32:
     case SCE_GXM_PARAMETER_TYPE_F16:
         src_f32 = reinterpret_cast<const GLfloat *>(data);
-        set_uniform<GLfloat>(location, parameter->component_count, parameter->array_size, src_f32, name, is_matrix, log_uniforms);
+        set_uniform<GLfloat>(uniform.location, parameter.component_count, parameter.array_size, src_f32, parameter, uniform.is_matrix, log_uniforms);
         break;
 
     default:
-        LOG_WARN("Type {} not handled for uniform parameter {}.", type, name);
+        LOG_WARN("Type {} not handled for uniform parameter {}.", type, gxp::parameter_name(parameter));
         break;
     }
 
@@ -254,16 +204,31 @@ bool set_uniform(GLuint program, const SceGxmProgram &shader_program, GLShaderSt
 
 bool set_uniform_buffer(GLContext &context, const bool vertex_shader, const int block_num, const int size, const void *data, bool log_active_shader) {
     const int binding_base = vertex_shader ? 0 : SCE_GXM_REAL_MAX_UNIFORM_BUFFER;
-    glBindBuffer(GL_UNIFORM_BUFFER, context.uniform_buffer[binding_base + block_num]);
-    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STATIC_DRAW);
-    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    glBindBufferBase(GL_UNIFORM_BUFFER, binding_base + block_num, context.uniform_buffer[binding_base + block_num]);
+    GLintptr offset = 0;
+    const bool staged = get_staging_offset(context, data, offset);
+    if (staged) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding_base + block_num, context.staging_buffer[0], offset, size);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, context.uniform_buffer[binding_base + block_num]);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STATIC_DRAW);
+        glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding_base + block_num, context.uniform_buffer[binding_base + block_num]);
+    }
 
     if (log_active_shader) {
-        std::vector<uint8_t> my_data((uint8_t *)data, (uint8_t *)data + size);
-        context.ubo_data[binding_base + block_num] = my_data;
+        std::vector<uint8_t> &logged_data = context.ubo_data[binding_base + block_num];
+        if (staged) {
+            // Staging memory is mapped write only, read it back through GL.
+            logged_data.resize(size);
+            glBindBuffer(GL_COPY_READ_BUFFER, context.staging_buffer[0]);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, logged_data.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        } else {
+            logged_data.assign(static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+        }
     }
 
     return true;
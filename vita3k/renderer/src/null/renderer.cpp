@@ -0,0 +1,109 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/null/functions.h>
+
+#include <crypto/hash.h>
+#include <shader/usse_program_analyzer.h>
+#include <util/log.h>
+
+#include <iterator>
+
+namespace renderer::null {
+// Indexed by CommandOpcode.
+static const char *const command_names[] = {
+    "CreateContext",
+    "CreateRenderTarget",
+    "Draw",
+    "Nop",
+    "SetState",
+    "SetContext",
+    "SyncSurfaceData",
+    "JumpWithLink",
+    "JumpBack",
+    "SignalSyncObject",
+    "DestroyRenderTarget",
+    "FenceStaging",
+};
+
+static_assert(std::size(command_names) == COMMAND_OPCODE_COUNT);
+
+bool create(std::unique_ptr<State> &state) {
+    state = std::make_unique<NullState>();
+    return true;
+}
+
+bool create(std::unique_ptr<Context> &context) {
+    context = std::make_unique<Context>();
+    return true;
+}
+
+bool create(std::unique_ptr<RenderTarget> &rt) {
+    rt = std::make_unique<RenderTarget>();
+    return true;
+}
+
+// The front end still needs the hash and the uniform buffer layout of every program.
+template <typename Program>
+static bool create_program(std::unique_ptr<Program> &program_out, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map) {
+    program_out = std::make_unique<Program>();
+
+    const Sha256Hash hash = sha256(&program, program.size);
+    program_out->hash.assign(hash.begin(), hash.end());
+    gxp_ptr_map.emplace(hash, &program);
+
+    shader::usse::get_uniform_buffer_sizes(program, program_out->uniform_buffer_sizes);
+
+    return true;
+}
+
+bool create(std::unique_ptr<FragmentProgram> &fp, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map) {
+    return create_program(fp, program, gxp_ptr_map);
+}
+
+bool create(std::unique_ptr<VertexProgram> &vp, const SceGxmProgram &program, GXPPtrMap &gxp_ptr_map) {
+    return create_program(vp, program, gxp_ptr_map);
+}
+
+void record_command(NullState &state, CommandOpcode opcode, std::chrono::steady_clock::duration time) {
+    const size_t index = static_cast<size_t>(opcode);
+    if (index >= COMMAND_OPCODE_COUNT)
+        return;
+
+    CommandStats &stats = state.command_stats[index];
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(), std::memory_order_relaxed);
+}
+
+void log_command_stats(const NullState &state) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.start_time).count();
+
+    LOG_INFO("Null renderer processed commands for {:.2f} s:", seconds);
+    for (size_t i = 0; i < COMMAND_OPCODE_COUNT; i++) {
+        const std::uint64_t count = state.command_stats[i].count.load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+
+        const std::uint64_t nanoseconds = state.command_stats[i].nanoseconds.load(std::memory_order_relaxed);
+        LOG_INFO("  {:<20} {:>10} commands, {:>10.3f} ms total, {:>8.0f} ns each", command_names[i], count,
+            nanoseconds / 1e6, static_cast<double>(nanoseconds) / count);
+    }
+
+    const std::uint64_t draws = state.command_stats[static_cast<size_t>(CommandOpcode::Draw)].count.load(std::memory_order_relaxed);
+    LOG_INFO("  {:.0f} draws/s", (seconds > 0) ? draws / seconds : 0.0);
+}
+} // namespace renderer::null
@@ -143,10 +143,16 @@ void set_vertex_stream(State &state, Context *ctx, GxmContextState *gxm_context,
 
 void draw(State &state, Context *ctx, GxmContextState *gxm_context, SceGxmPrimitiveType prim_type, SceGxmIndexFormat index_type, const void *index_data, const std::uint32_t index_count) {
     switch (state.current_backend) {
-    default:
-        renderer::add_command(ctx, renderer::CommandOpcode::Draw, nullptr, prim_type, index_type, index_data, index_count);
+    default: {
+        // The guest can reuse its index buffer before the renderer gets to this draw.
+        const std::size_t index_size = index_count * ((index_type == SCE_GXM_INDEX_FORMAT_U16) ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+        void *const a_copy = alloc_staging(*ctx, index_size);
+        std::memcpy(a_copy, index_data, index_size);
+
+        renderer::add_command(ctx, renderer::CommandOpcode::Draw, nullptr, prim_type, index_type, static_cast<const void *>(a_copy), index_count);
         break;
     }
+    }
 }
 
 void sync_surface_data(State &state, Context *ctx, GxmContextState *gxm_context) {
@@ -192,11 +198,11 @@ void set_uniform_buffer(State &state, Context *ctx, const bool is_vertex_uniform
     default: {
         // Calculate the number of bytes
         std::uint32_t bytes_to_copy_and_pad = (((block_size + 15) / 16)) * 16;
-        std::uint8_t *a_copy = new std::uint8_t[bytes_to_copy_and_pad];
+        void *const a_copy = alloc_staging(*ctx, bytes_to_copy_and_pad);
 
         std::memcpy(a_copy, data, block_size);
 
-        renderer::add_state_set_command(ctx, renderer::GXMState::UniformBuffer, is_vertex_uniform, block_number, bytes_to_copy_and_pad, a_copy);
+        renderer::add_state_set_command(ctx, renderer::GXMState::UniformBuffer, is_vertex_uniform, block_number, bytes_to_copy_and_pad, static_cast<const void *>(a_copy));
         break;
     }
     }
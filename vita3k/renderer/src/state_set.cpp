@@ -47,7 +47,7 @@ COMMAND_SET_STATE(program) {
 
         switch (renderer.current_backend) {
         case Backend::OpenGL: {
-            gl::sync_blending(*state, mem);
+            gl::sync_blending(*reinterpret_cast<gl::GLContext *>(render_context), *state, mem);
             break;
         }
 
@@ -56,19 +56,8 @@ COMMAND_SET_STATE(program) {
             break;
         }
     } else {
+        // Vertex attributes are laid out by the draws, they point into the streams uploaded for each of them.
         state->vertex_program = program.cast<const SceGxmVertexProgram>();
-
-        // Try to bind and layout vertex attributes
-        switch (renderer.current_backend) {
-        case Backend::OpenGL: {
-            gl::sync_vertex_attributes(*reinterpret_cast<gl::GLContext *>(render_context), *state, mem);
-            break;
-        }
-
-        default:
-            REPORT_MISSING(renderer.current_backend);
-            break;
-        }
     }
 }
 
@@ -106,8 +95,6 @@ COMMAND_SET_STATE(uniform_buffer) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         gl::set_uniform_buffer(*reinterpret_cast<gl::GLContext *>(render_context), is_vertex, block_num, size, data, config.log_active_shaders);
-        delete data;
-
         break;
     }
 
@@ -157,7 +144,7 @@ COMMAND_SET_STATE(depth_bias) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         if (is_front) {
-            gl::sync_front_depth_bias(*state);
+            gl::sync_front_depth_bias(*reinterpret_cast<gl::GLContext *>(render_context), *state);
         } else {
             // LOG_INFO("AAAA");
         }
@@ -183,7 +170,7 @@ COMMAND_SET_STATE(depth_func) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         if (is_front) {
-            gl::sync_front_depth_func(*state);
+            gl::sync_front_depth_func(*reinterpret_cast<gl::GLContext *>(render_context), *state);
         } else {
             //LOG_WARN("Unhandle set back depth func for OpenGL backend");
         }
@@ -209,7 +196,7 @@ COMMAND_SET_STATE(depth_write_enable) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         if (is_front)
-            gl::sync_front_depth_write_enable(*state);
+            gl::sync_front_depth_write_enable(*reinterpret_cast<gl::GLContext *>(render_context), *state);
         //else
         //LOG_WARN("Unhandle set back depth write enable for OpenGL backend");
 
@@ -234,7 +221,7 @@ COMMAND_SET_STATE(polygon_mode) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         if (is_front)
-            gl::sync_front_polygon_mode(*state);
+            gl::sync_front_polygon_mode(*reinterpret_cast<gl::GLContext *>(render_context), *state);
         else
             // LOG_WARN("Unhandle set back polygon mode for OpenGL backend");
 
@@ -258,7 +245,7 @@ COMMAND_SET_STATE(point_line_width) {
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
         if (is_front)
-            gl::sync_front_point_line_width(*state);
+            gl::sync_front_point_line_width(*reinterpret_cast<gl::GLContext *>(render_context), *state);
         else
             //LOG_WARN("Unhandle set back line width for OpenGL backend");
 
@@ -297,7 +284,7 @@ COMMAND_SET_STATE(stencil_func) {
 
     switch (renderer.current_backend) {
     case Backend::OpenGL: {
-        gl::sync_stencil_func(*state, mem, !is_front);
+        gl::sync_stencil_func(*reinterpret_cast<gl::GLContext *>(render_context), *state, mem, !is_front);
         break;
     }
 
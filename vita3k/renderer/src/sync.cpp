@@ -10,13 +10,40 @@
 #include <renderer/functions.h>
 #include <util/log.h>
 
+#include <algorithm>
+
 namespace renderer {
+constexpr std::size_t STAGING_BUFFER_SIZE = 4 * 1024 * 1024;
+
 COMMAND(handle_nop) {
     // Signal back to client
     int code_to_finish = helper.pop<int>();
     complete_command(renderer, helper, code_to_finish);
 }
 
+COMMAND(handle_fence_staging) {
+    StagingBuffer *buffer = helper.pop<StagingBuffer *>();
+
+    // Heap buffers were copied by every command reading them, which have all run by now.
+    if (buffer->heap) {
+        buffer->status = CommandErrorCodeNone;
+        return;
+    }
+
+    switch (renderer.current_backend) {
+    case Backend::OpenGL: {
+        gl::fence_staging_buffer(*reinterpret_cast<gl::GLContext *>(render_context), *buffer);
+        break;
+    }
+
+    default: {
+        REPORT_MISSING(renderer.current_backend);
+        buffer->status = CommandErrorCodeNone;
+        break;
+    }
+    }
+}
+
 COMMAND(handle_signal_sync_object) {
     SceGxmSyncObject *sync = helper.pop<Ptr<SceGxmSyncObject>>().get(mem);
     renderer::subject_done(sync, renderer::SyncObjectSubject::Fragment);
@@ -68,6 +95,56 @@ void subject_in_progress(SceGxmSyncObject *sync_object, const SyncObjectSubject
     sync_object->done &= ~subjects;
 }
 
+void *alloc_staging(Context &context, std::size_t size, bool host_read) {
+    size = (size + context.staging_alignment - 1) & ~(context.staging_alignment - 1);
+
+    // Data read on the CPU and data read by the GPU are filled into separate buffers.
+    StagingBuffer *buffer = nullptr;
+    for (auto scene_buffer = context.scene_staging_buffers.rbegin(); scene_buffer != context.scene_staging_buffers.rend(); ++scene_buffer) {
+        if ((*scene_buffer)->host_read == host_read) {
+            buffer = *scene_buffer;
+            break;
+        }
+    }
+
+    if (!buffer || (buffer->used + size > buffer->size)) {
+        // Take a buffer no queued scene reads from any more, or grow the ring.
+        // Backend memory may be slow to read from the CPU, so it is only used for the GPU.
+        buffer = nullptr;
+        for (const auto &candidate : context.staging_buffers) {
+            if ((candidate->status != CommandErrorCodePending) && (candidate->size >= size) && (!host_read || candidate->heap)) {
+                buffer = candidate.get();
+                break;
+            }
+        }
+
+        if (!buffer) {
+            context.staging_buffers.push_back(std::make_unique<StagingBuffer>());
+            buffer = context.staging_buffers.back().get();
+            buffer->size = std::max(size, STAGING_BUFFER_SIZE);
+            buffer->heap.reset(new std::uint8_t[buffer->size]);
+            buffer->memory = buffer->heap.get();
+        }
+
+        buffer->used = 0;
+        buffer->host_read = host_read;
+        buffer->status = CommandErrorCodePending;
+        context.scene_staging_buffers.push_back(buffer);
+    }
+
+    void *const data = &buffer->memory[buffer->used];
+    buffer->used += size;
+
+    return data;
+}
+
+void fence_staging(Context &context) {
+    for (StagingBuffer *buffer : context.scene_staging_buffers)
+        add_command(&context, CommandOpcode::FenceStaging, nullptr, buffer);
+
+    context.scene_staging_buffers.clear();
+}
+
 void submit_command_list(State &state, renderer::Context *context, GxmContextState *context_state,
     CommandList &command_list) {
     command_list.context = context;
@@ -4,73 +4,85 @@
 
 #include <gxm/functions.h>
 #include <mem/ptr.h>
+#include <util/hash.h>
 #include <util/log.h>
 
-#include <algorithm> // find
-#include <cstring> // memcmp
-#include <numeric> // accumulate, reduce
-#ifdef WIN32
-#include <execution>
-#endif
-
 namespace renderer {
 namespace texture {
 
-static TextureCacheHash hash_data(const void *data, size_t size) {
-    const uint8_t *const begin = static_cast<const uint8_t *>(data);
-    const uint8_t *const end = begin + size;
-
-#ifdef WIN32
-    return std::reduce(std::execution::par_unseq, begin, end, TextureCacheHash(0));
-#else
-    return std::accumulate(begin, end, TextureCacheHash(0));
-#endif
-}
-
-static TextureCacheHash hash_palette_data(const SceGxmTexture &texture, size_t count, const MemState &mem) {
-    const uint32_t *const palette_bytes = get_texture_palette(texture, mem);
-    const TextureCacheHash palette_hash = hash_data(palette_bytes, count * sizeof(uint32_t));
-    return palette_hash;
-}
-
-TextureCacheHash hash_texture_data(const SceGxmTexture &texture, const MemState &mem) {
-    R_PROFILE(__func__);
-
+static size_t texture_data_size(const SceGxmTexture &texture) {
     const SceGxmTextureFormat format = gxm::get_format(&texture);
     const SceGxmTextureBaseFormat base_format = gxm::get_base_format(format);
     const size_t width = gxm::get_width(&texture);
     const size_t height = gxm::get_height(&texture);
     const size_t stride = (width + 7) & ~7; // NOTE: This is correct only with linear textures.
     const size_t bpp = texture::bits_per_pixel(base_format);
-    const size_t size = (bpp * stride * height) / 8;
-    const Ptr<const void> data(texture.data_addr << 2);
-    const TextureCacheHash data_hash = hash_data(data.get(mem), size);
+    return (bpp * stride * height) / 8;
+}
 
-    switch (base_format) {
+static size_t texture_palette_size(const SceGxmTexture &texture) {
+    switch (gxm::get_base_format(gxm::get_format(&texture))) {
     case SCE_GXM_TEXTURE_BASE_FORMAT_P4:
-        return data_hash ^ hash_palette_data(texture, 16, mem);
+        return 16 * sizeof(uint32_t);
     case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
-        return data_hash ^ hash_palette_data(texture, 256, mem);
+        return 256 * sizeof(uint32_t);
     default:
-        return data_hash;
+        return 0;
     }
 }
 
-static size_t find_lru(const TextureCacheTimestamps &timestamps, TextureCacheTimestamp current_time) {
+TextureCacheHash hash_texture_data(const SceGxmTexture &texture, const MemState &mem) {
     R_PROFILE(__func__);
 
-    uint64_t oldest_age = current_time - timestamps.front();
-    size_t oldest_index = 0;
+    const Ptr<const void> data(texture.data_addr << 2);
+    const TextureCacheHash data_hash = hash_bytes(data.get(mem), texture_data_size(texture));
 
-    for (size_t index = 1; index < timestamps.size(); ++index) {
-        const uint64_t age = current_time - timestamps[index];
-        if (age > oldest_age) {
-            oldest_age = age;
-            oldest_index = index;
-        }
-    }
+    const size_t palette_size = texture_palette_size(texture);
+    if (palette_size == 0)
+        return data_hash;
+
+    return hash_bytes(get_texture_palette(texture, mem), palette_size, data_hash);
+}
+
+// Write-protect the texture's data and palette, so that is_texture_written can tell
+// whether the guest has touched them since they were last hashed.
+static void track_texture_writes(const SceGxmTexture &texture, const MemState &mem) {
+    track_writes(mem, texture.data_addr << 2, texture_data_size(texture));
+
+    const size_t palette_size = texture_palette_size(texture);
+    if (palette_size != 0)
+        track_writes(mem, texture.palette_addr << 6, palette_size);
+}
+
+static bool is_texture_written(const SceGxmTexture &texture, const MemState &mem) {
+    if (is_written(mem, texture.data_addr << 2, texture_data_size(texture)))
+        return true;
+
+    const size_t palette_size = texture_palette_size(texture);
+    return (palette_size != 0) && is_written(mem, texture.palette_addr << 6, palette_size);
+}
+
+static void lru_unlink(TextureCacheState &cache, size_t index) {
+    const TextureCacheLink link = cache.lru_links[index];
+    if (link.prev != TextureCacheNoIndex)
+        cache.lru_links[link.prev].next = link.next;
+    else
+        cache.lru_head = link.next;
+
+    if (link.next != TextureCacheNoIndex)
+        cache.lru_links[link.next].prev = link.prev;
+    else
+        cache.lru_tail = link.prev;
+}
 
-    return oldest_index;
+static void lru_push_front(TextureCacheState &cache, size_t index) {
+    cache.lru_links[index].prev = TextureCacheNoIndex;
+    cache.lru_links[index].next = cache.lru_head;
+    if (cache.lru_head != TextureCacheNoIndex)
+        cache.lru_links[cache.lru_head].prev = index;
+    else
+        cache.lru_tail = index;
+    cache.lru_head = index;
 }
 
 void cache_and_bind_texture(TextureCacheState &cache, const SceGxmTexture &gxm_texture, const MemState &mem) {
@@ -79,38 +91,44 @@ void cache_and_bind_texture(TextureCacheState &cache, const SceGxmTexture &gxm_t
     size_t index = 0;
     bool configure = false;
     bool upload = false;
-    // TODO Palettes are probably quicker to hash than texture data, so if we find games use palette animation this could be optimised:
-    // Skip data hash if palette hashes differ.
-    const TextureCacheHash hash = hash_texture_data(gxm_texture, mem);
+    TextureCacheHash hash = 0;
 
     // Try to find GXM texture in cache.
-    size_t cached_gxm_texture_index = -1;
-    for (size_t a = 0; a < cache.used; a++) {
-        if (memcmp(&cache.gxm_textures[a], &gxm_texture, sizeof(SceGxmTexture)) == 0) {
-            cached_gxm_texture_index = a;
-            break;
-        }
-    }
-    if (cached_gxm_texture_index == -1) {
+    const TextureCacheIndices::const_iterator cached = cache.indices.find(gxm_texture);
+    if (cached == cache.indices.end()) {
         // Texture not found in cache.
         if (cache.used < TextureCacheSize) {
             // Cache is not full. Add texture to cache.
             index = cache.used;
             ++cache.used;
         } else {
-            // Cache is full. Find least recently used texture.
-            index = find_lru(cache.timestamps, cache.timestamp);
-            LOG_DEBUG("Evicting texture {} (t = {}) from cache. Current t = {}.", index, cache.timestamps[index], cache.timestamp);
+            // Cache is full. Evict least recently used texture.
+            index = cache.lru_tail;
+            lru_unlink(cache, index);
+            cache.indices.erase(cache.gxm_textures[index]);
+            LOG_DEBUG("Evicting texture {} from cache.", index);
         }
         configure = true;
         upload = true;
         cache.gxm_textures[index] = gxm_texture;
+        cache.indices.emplace(gxm_texture, index);
+        track_texture_writes(gxm_texture, mem);
+        hash = hash_texture_data(gxm_texture, mem);
     } else {
-        // Texture is cached.
-        index = cached_gxm_texture_index;
+        index = cached->second;
+        lru_unlink(cache, index);
         configure = false;
-        upload = (hash != cache.hashes[index]);
+        if (is_texture_written(gxm_texture, mem)) {
+            // Texture is cached, but its memory has been written since it was hashed.
+            track_texture_writes(gxm_texture, mem);
+            hash = hash_texture_data(gxm_texture, mem);
+            upload = (hash != cache.hashes[index]);
+        } else {
+            // Texture is cached and untouched.
+            upload = false;
+        }
     }
+    lru_push_front(cache, index);
 
     cache.select_callback(index);
 
@@ -121,8 +139,6 @@ void cache_and_bind_texture(TextureCacheState &cache, const SceGxmTexture &gxm_t
         cache.upload_texture_callback(index, &gxm_texture, mem);
         cache.hashes[index] = hash;
     }
-
-    cache.timestamps[index] = cache.timestamp;
 }
 
 } // namespace texture
@@ -0,0 +1,318 @@
+#include <renderer/functions.h>
+#include <renderer/profile.h>
+#include <renderer/pvrt-dec.h>
+#include <renderer/texture_decode_state.h>
+
+#include <gxm/functions.h>
+#include <mem/ptr.h>
+#include <util/align.h>
+#include <util/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace renderer {
+namespace texture {
+
+// Staging buffers kept around for reuse. Anything beyond this is freed once uploaded.
+static constexpr size_t MAX_FREE_STAGING_BUFFERS = 16;
+
+bool can_texture_be_unswizzled_without_decode(SceGxmTextureBaseFormat fmt) {
+    return (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_P8 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8 || fmt == SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8);
+}
+
+static bool is_pvrt_format(SceGxmTextureBaseFormat fmt) {
+    return (fmt >= SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP) && (fmt <= SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP);
+}
+
+static int bc_type(SceGxmTextureBaseFormat fmt) {
+    switch (fmt) {
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
+        return 1;
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC2:
+        return 2;
+    case SCE_GXM_TEXTURE_BASE_FORMAT_UBC3:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// Size of the compressed source consumed by decompress_swizzled.
+static size_t compressed_swizzled_size(SceGxmTextureBaseFormat fmt, uint32_t width, uint32_t height) {
+    const size_t blocks = ((width + 3) / 4) * ((height + 3) / 4);
+    if (const int type = bc_type(fmt))
+        return blocks * ((type > 1) ? 16 : 8);
+    if (is_pvrt_format(fmt))
+        // TODO, calcule return is not sur.
+        return blocks;
+
+    return 0;
+}
+
+/**
+ * \brief Decompress a swizzled texture to 32-bit RGBA.
+ *
+ * \param fmt    Texture base format.
+ * \param dest   Destination texture data. Size must be sufficient enough of align(width, 4) * align(height, 4) * 4 (bytes).
+ * \param data   Source data to decompress.
+ * \param width  Texture width.
+ * \param height Texture height.
+ */
+static void decompress_swizzled(SceGxmTextureBaseFormat fmt, uint8_t *dest, const uint8_t *data, uint32_t width, uint32_t height) {
+    if (const int type = bc_type(fmt)) {
+        decompress_bc_swizz_image(width, height, data, reinterpret_cast<uint32_t *>(dest), type);
+    } else if (is_pvrt_format(fmt)) {
+        // TODO, is not perfect for PVRT-II.
+        pvr::PVRTDecompressPVRTC(data, (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP) || (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP), width, height,
+            (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP) || (fmt == SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP), dest);
+    } else {
+        // No decoder for this format yet, upload it black.
+        std::memset(dest, 0, static_cast<size_t>(width) * height * 4);
+    }
+}
+
+bool prepare_texture_decode(TextureDecodeJob &job, const SceGxmTexture &texture, const MemState &mem) {
+    R_PROFILE(__func__);
+
+    const SceGxmTextureFormat fmt = gxm::get_format(&texture);
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(fmt);
+    const size_t bpp = bits_per_pixel(base_format);
+    const size_t bytes_per_pixel = (bpp + 7) >> 3;
+
+    const auto texture_type = texture.texture_type();
+    const bool is_swizzled = (texture_type == SCE_GXM_TEXTURE_SWIZZLED) || (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY);
+    const bool is_converted_layout = is_swizzled || (texture_type == SCE_GXM_TEXTURE_TILED);
+
+    job.texture = texture;
+    job.rgba = is_swizzled && !can_texture_be_unswizzled_without_decode(base_format);
+    job.stages = 0;
+    if (job.rgba)
+        job.stages |= TEXTURE_DECODE_DECOMPRESS;
+    if (is_converted_layout && !is_pvrt_format(base_format))
+        job.stages |= TEXTURE_DECODE_LINEARIZE;
+    if (gxm::is_paletted_format(fmt)) {
+        job.stages |= TEXTURE_DECODE_PALETTE;
+        job.palette = get_texture_palette(texture, mem);
+    }
+    if (gxm::is_yuv_format(fmt))
+        job.stages |= TEXTURE_DECODE_YUV;
+
+    const uint8_t *data = Ptr<const uint8_t>(texture.data_addr << 2).get(mem);
+    uint32_t width = static_cast<uint32_t>(gxm::get_width(&texture));
+    uint32_t height = static_cast<uint32_t>(gxm::get_height(&texture));
+    size_t staging_size = 0;
+
+    job.mips.clear();
+    for (uint32_t mip_index = 0; mip_index < texture.mip_count + 1u && width && height; mip_index++) {
+        TextureDecodeMip mip;
+        mip.width = width;
+        mip.height = height;
+        mip.decode_width = (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY) ? nearest_power_of_two(width) : width;
+        mip.decode_height = (texture_type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY) ? nearest_power_of_two(height) : height;
+        mip.source = data;
+
+        size_t source_size = 0;
+        size_t output_size = 0;
+
+        switch (texture_type) {
+        case SCE_GXM_TEXTURE_SWIZZLED:
+        case SCE_GXM_TEXTURE_TILED:
+        case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+            if (job.rgba) {
+                source_size = compressed_swizzled_size(base_format, mip.decode_width, mip.decode_height);
+                output_size = align(mip.decode_width, 4) * align(mip.decode_height, 4) * 4;
+            }
+            if (job.stages & TEXTURE_DECODE_LINEARIZE)
+                output_size = static_cast<size_t>(mip.decode_width) * mip.decode_height * (job.rgba ? 4 : bytes_per_pixel);
+            mip.pixels_per_stride = mip.decode_width;
+            break;
+        case SCE_GXM_TEXTURE_LINEAR:
+            mip.pixels_per_stride = (width + 7) & ~7;
+            break;
+        case SCE_GXM_TEXTURE_LINEAR_STRIDED:
+            mip.pixels_per_stride = gxm::get_stride_in_bytes(&texture) / bytes_per_pixel;
+            break;
+        default:
+            LOG_ERROR("Uniplemented Texture type: {} ", log_hex(texture.texture_type()));
+            mip.pixels_per_stride = (width + 7) & ~7; // NOTE: This is correct only with linear textures.
+            break;
+        }
+
+        if (job.stages & TEXTURE_DECODE_PALETTE) {
+            output_size = static_cast<size_t>(width) * height * 4;
+            mip.pixels_per_stride = width;
+        }
+        if (job.stages & TEXTURE_DECODE_YUV) {
+            output_size = static_cast<size_t>(width) * height * 4;
+            mip.pixels_per_stride = width;
+        }
+
+        if (!job.rgba) {
+            size_t compressed_size = 0;
+            if (is_compressed_format(base_format, width, height, compressed_size)) {
+                mip.compressed_size = compressed_size;
+                source_size = compressed_size;
+            } else {
+                source_size = (static_cast<size_t>(width) * height * bpp + 7) >> 3;
+            }
+        }
+
+        mip.staging_offset = staging_size;
+        staging_size += align(output_size, 16);
+        job.mips.push_back(mip);
+
+        data += source_size;
+        width /= 2;
+        height /= 2;
+    }
+
+    job.staging.resize(staging_size);
+    for (TextureDecodeMip &mip : job.mips)
+        mip.pixels = job.stages ? static_cast<const void *>(job.staging.data() + mip.staging_offset) : mip.source;
+
+    return job.stages != 0;
+}
+
+void decode_texture_mip(TextureDecodeJob &job, size_t mip_index) {
+    R_PROFILE(__func__);
+
+    // Intermediate results when a texture needs more than one conversion.
+    static thread_local TextureStagingBuffer scratch[2];
+    size_t next_scratch = 0;
+
+    const TextureDecodeMip &mip = job.mips[mip_index];
+    const SceGxmTextureFormat fmt = gxm::get_format(&job.texture);
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(fmt);
+
+    const uint8_t *pixels = mip.source;
+    uint32_t remaining = job.stages;
+    const auto output = [&](TextureDecodeStage stage, size_t size) {
+        remaining &= ~stage;
+        if (remaining == 0)
+            return job.staging.data() + mip.staging_offset;
+
+        TextureStagingBuffer &buffer = scratch[next_scratch++ & 1];
+        buffer.resize(size);
+        return buffer.data();
+    };
+
+    if (job.stages & TEXTURE_DECODE_DECOMPRESS) {
+        uint8_t *dest = output(TEXTURE_DECODE_DECOMPRESS, align(mip.decode_width, 4) * align(mip.decode_height, 4) * 4);
+        decompress_swizzled(base_format, dest, pixels, mip.decode_width, mip.decode_height);
+        pixels = dest;
+    }
+
+    if (job.stages & TEXTURE_DECODE_LINEARIZE) {
+        const size_t bpp = job.rgba ? 32 : bits_per_pixel(base_format);
+        uint8_t *dest = output(TEXTURE_DECODE_LINEARIZE, mip.decode_width * mip.decode_height * (bpp >> 3));
+        const auto texture_type = job.texture.texture_type();
+        if (texture_type == SCE_GXM_TEXTURE_TILED)
+            tiled_texture_to_linear_texture(dest, pixels, mip.decode_width, mip.decode_height, static_cast<uint8_t>(bpp));
+        else
+            swizzled_texture_to_linear_texture(dest, pixels, mip.decode_width, mip.decode_height, static_cast<uint8_t>(bpp));
+        pixels = dest;
+    }
+
+    if (job.stages & TEXTURE_DECODE_PALETTE) {
+        uint8_t *dest = output(TEXTURE_DECODE_PALETTE, static_cast<size_t>(mip.width) * mip.height * 4);
+        if (base_format == SCE_GXM_TEXTURE_BASE_FORMAT_P8)
+            palette_texture_to_rgba_8(reinterpret_cast<uint32_t *>(dest), pixels, mip.width, mip.height, job.palette);
+        else
+            palette_texture_to_rgba_4(reinterpret_cast<uint32_t *>(dest), pixels, mip.width, mip.height, job.palette);
+        pixels = dest;
+    }
+
+    if (job.stages & TEXTURE_DECODE_YUV) {
+        uint8_t *dest = output(TEXTURE_DECODE_YUV, static_cast<size_t>(mip.width) * mip.height * 4);
+        yuv_texture_to_rgba(dest, pixels, mip.width, mip.height, fmt);
+    }
+}
+
+static void decode_worker(TextureDecodeState &state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (true) {
+        state.work_available.wait(lock, [&state] { return state.quit || !state.queue.empty(); });
+        if (state.quit)
+            return;
+
+        const TextureDecodeJobPtr job = std::move(state.queue.front().first);
+        const size_t mip_index = state.queue.front().second;
+        state.queue.pop_front();
+
+        lock.unlock();
+        decode_texture_mip(*job, mip_index);
+        lock.lock();
+
+        if (--job->remaining_mips == 0) {
+            state.done.push_back(job);
+            ++state.done_count;
+        }
+    }
+}
+
+bool init(TextureDecodeState &state, size_t worker_count) {
+    for (size_t i = 0; i < worker_count; i++)
+        state.workers.emplace_back(decode_worker, std::ref(state));
+
+    return !state.workers.empty();
+}
+
+TextureDecodeJobPtr create_texture_decode_job(TextureDecodeState &state) {
+    const TextureDecodeJobPtr job = std::make_shared<TextureDecodeJob>();
+
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.free_staging.empty()) {
+        job->staging = std::move(state.free_staging.back());
+        state.free_staging.pop_back();
+    }
+
+    return job;
+}
+
+void submit_texture_decode(TextureDecodeState &state, const TextureDecodeJobPtr &job) {
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    job->remaining_mips = job->mips.size();
+    if (job->mips.empty()) {
+        state.done.push_back(job);
+        ++state.done_count;
+        return;
+    }
+
+    // Biggest mips first, so the smaller ones fill in around them.
+    for (size_t mip = 0; mip < job->mips.size(); mip++)
+        state.queue.emplace_back(job, mip);
+
+    state.work_available.notify_all();
+}
+
+void take_decoded_textures(TextureDecodeState &state, TextureDecodeJobs &jobs) {
+    jobs.clear();
+    if (state.done_count == 0)
+        return;
+
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    jobs.swap(state.done);
+    state.done_count = 0;
+}
+
+void recycle_texture_decode_job(TextureDecodeState &state, TextureDecodeJob &job) {
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.free_staging.size() < MAX_FREE_STAGING_BUFFERS)
+        state.free_staging.push_back(std::move(job.staging));
+}
+
+} // namespace texture
+
+TextureDecodeState::~TextureDecodeState() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    work_available.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+} // namespace renderer
@@ -16,14 +16,73 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include "texture_isa.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
 
 #include <gxm/types.h>
 
+#if defined(TEXTURE_DECODER_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define UNSWIZZLE_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UNSWIZZLE_NEON 1
+#endif
+
 namespace renderer::texture {
 
+static DecoderIsa detect_decoder_isa() {
+#ifdef TEXTURE_DECODER_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return DecoderIsa::Scalar;
+
+    // The OS has to save the YMM registers on context switches as well.
+    __cpuid(info, 1);
+    const bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    if (!has_avx || ((_xgetbv(0) & 6) != 6))
+        return DecoderIsa::Scalar;
+
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5))
+        return DecoderIsa::AVX2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return DecoderIsa::AVX2;
+#endif
+#endif
+
+    return DecoderIsa::Scalar;
+}
+
+static const DecoderIsa host_decoder_isa = detect_decoder_isa();
+static std::atomic<DecoderIsa> decoder_isa = host_decoder_isa;
+
+bool set_decoder_isa(DecoderIsa isa) {
+    if (isa > host_decoder_isa)
+        return false;
+
+    decoder_isa = isa;
+    return true;
+}
+
+DecoderIsa get_decoder_isa() {
+    return decoder_isa.load(std::memory_order_relaxed);
+}
+
 size_t bits_per_pixel(SceGxmTextureBaseFormat base_format) {
     switch (base_format) {
     case SCE_GXM_TEXTURE_BASE_FORMAT_U8:
@@ -114,6 +173,149 @@ static uint32_t decode_morton2_y(uint32_t code) {
     return compact_one_by_one(code >> 1);
 }
 
+// Part1By1 - insert a zero bit between each of the low 16 bits
+static constexpr uint32_t spread_one_by_one(uint32_t x) {
+    x &= 0x0000ffff;
+    x = (x ^ (x << 8)) & 0x00ff00ff;
+    x = (x ^ (x << 4)) & 0x0f0f0f0f;
+    x = (x ^ (x << 2)) & 0x33333333;
+    x = (x ^ (x << 1)) & 0x55555555;
+    return x;
+}
+
+static constexpr uint32_t MAX_SWIZZLE_BLOCK_SIZE = 4096;
+
+// Morton offset of each row inside a swizzled block. The offset of a column is the row offset shifted left by one.
+static const std::array<uint32_t, MAX_SWIZZLE_BLOCK_SIZE> morton_offsets = [] {
+    std::array<uint32_t, MAX_SWIZZLE_BLOCK_SIZE> offsets{};
+    for (uint32_t i = 0; i < MAX_SWIZZLE_BLOCK_SIZE; i++)
+        offsets[i] = spread_one_by_one(i);
+    return offsets;
+}();
+
+static bool is_power_of_two(uint32_t x) {
+    return (x != 0) && ((x & (x - 1)) == 0);
+}
+
+struct Texel128 {
+    uint64_t data[2];
+};
+
+// A swizzled block is made of 4x4 tiles of 16 consecutive texels. Within a tile, row bits are
+// at even positions and column bits at odd ones, so the linear rows are made of these texels.
+static constexpr std::array<uint8_t, 16> tile_order = {
+    0, 2, 8, 10,
+    1, 3, 9, 11,
+    4, 6, 12, 14,
+    5, 7, 13, 15
+};
+
+template <typename T>
+static void unswizzle_tile(T *dest, size_t stride, const T *tile) {
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++)
+            dest[y * stride + x] = tile[tile_order[y * 4 + x]];
+    }
+}
+
+#if defined(UNSWIZZLE_SSE2)
+template <>
+void unswizzle_tile<uint16_t>(uint16_t *dest, size_t stride, const uint16_t *tile) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tile));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tile) + 1);
+    // Gather even and odd texels into pairs: [0 2] [4 6] [1 3] [5 7], and the same for the second half.
+    const __m128i pairs_a = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i pairs_b = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(b, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i rows02 = _mm_unpacklo_epi32(pairs_a, pairs_b);
+    const __m128i rows13 = _mm_unpackhi_epi32(pairs_a, pairs_b);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dest), rows02);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + stride), rows13);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + stride * 2), _mm_unpackhi_epi64(rows02, rows02));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + stride * 3), _mm_unpackhi_epi64(rows13, rows13));
+}
+
+template <>
+void unswizzle_tile<uint32_t>(uint32_t *dest, size_t stride, const uint32_t *tile) {
+    const float *src = reinterpret_cast<const float *>(tile);
+    const __m128 q0 = _mm_loadu_ps(src);
+    const __m128 q1 = _mm_loadu_ps(src + 4);
+    const __m128 q2 = _mm_loadu_ps(src + 8);
+    const __m128 q3 = _mm_loadu_ps(src + 12);
+    _mm_storeu_ps(reinterpret_cast<float *>(dest), _mm_shuffle_ps(q0, q2, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(reinterpret_cast<float *>(dest + stride), _mm_shuffle_ps(q0, q2, _MM_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_ps(reinterpret_cast<float *>(dest + stride * 2), _mm_shuffle_ps(q1, q3, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(reinterpret_cast<float *>(dest + stride * 3), _mm_shuffle_ps(q1, q3, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+template <>
+void unswizzle_tile<uint64_t>(uint64_t *dest, size_t stride, const uint64_t *tile) {
+    // Every vector holds a column of two vertically adjacent texels.
+    const __m128i *src = reinterpret_cast<const __m128i *>(tile);
+    for (uint32_t y = 0; y < 4; y += 2) {
+        const __m128i c0 = _mm_loadu_si128(src + y + 0);
+        const __m128i c1 = _mm_loadu_si128(src + y + 1);
+        const __m128i c2 = _mm_loadu_si128(src + y + 4);
+        const __m128i c3 = _mm_loadu_si128(src + y + 5);
+        __m128i *row0 = reinterpret_cast<__m128i *>(dest + y * stride);
+        __m128i *row1 = reinterpret_cast<__m128i *>(dest + (y + 1) * stride);
+        _mm_storeu_si128(row0, _mm_unpacklo_epi64(c0, c1));
+        _mm_storeu_si128(row0 + 1, _mm_unpacklo_epi64(c2, c3));
+        _mm_storeu_si128(row1, _mm_unpackhi_epi64(c0, c1));
+        _mm_storeu_si128(row1 + 1, _mm_unpackhi_epi64(c2, c3));
+    }
+}
+#elif defined(UNSWIZZLE_NEON)
+template <>
+void unswizzle_tile<uint16_t>(uint16_t *dest, size_t stride, const uint16_t *tile) {
+    const uint16x8x2_t halves = vuzpq_u16(vld1q_u16(tile), vld1q_u16(tile + 8));
+    const uint32x4_t even = vreinterpretq_u32_u16(halves.val[0]);
+    const uint32x4_t odd = vreinterpretq_u32_u16(halves.val[1]);
+    const uint32x2x2_t rows02 = vuzp_u32(vget_low_u32(even), vget_high_u32(even));
+    const uint32x2x2_t rows13 = vuzp_u32(vget_low_u32(odd), vget_high_u32(odd));
+    vst1_u32(reinterpret_cast<uint32_t *>(dest), rows02.val[0]);
+    vst1_u32(reinterpret_cast<uint32_t *>(dest + stride), rows13.val[0]);
+    vst1_u32(reinterpret_cast<uint32_t *>(dest + stride * 2), rows02.val[1]);
+    vst1_u32(reinterpret_cast<uint32_t *>(dest + stride * 3), rows13.val[1]);
+}
+
+template <>
+void unswizzle_tile<uint32_t>(uint32_t *dest, size_t stride, const uint32_t *tile) {
+    const uint32x4x2_t rows01 = vuzpq_u32(vld1q_u32(tile), vld1q_u32(tile + 8));
+    const uint32x4x2_t rows23 = vuzpq_u32(vld1q_u32(tile + 4), vld1q_u32(tile + 12));
+    vst1q_u32(dest, rows01.val[0]);
+    vst1q_u32(dest + stride, rows01.val[1]);
+    vst1q_u32(dest + stride * 2, rows23.val[0]);
+    vst1q_u32(dest + stride * 3, rows23.val[1]);
+}
+#endif
+
+// Swizzled textures are split into square blocks along their longer side, each block in Morton order.
+template <typename T>
+static void unswizzle_blocks(T *dest, const T *src, uint32_t width, uint32_t height) {
+    const uint32_t size = std::min(width, height);
+    const uint32_t block_count = std::max(width, height) / size;
+    const size_t block_texels = static_cast<size_t>(size) * size;
+
+    for (uint32_t block = 0; block < block_count; block++) {
+        const T *block_src = src + block * block_texels;
+        T *block_dest = (height < width) ? dest + block * size : dest + block * block_texels;
+
+        if (size < 4) {
+            for (uint32_t y = 0; y < size; y++) {
+                for (uint32_t x = 0; x < size; x++)
+                    block_dest[y * width + x] = block_src[morton_offsets[y] | (morton_offsets[x] << 1)];
+            }
+            continue;
+        }
+
+        for (uint32_t y = 0; y < size; y += 4) {
+            T *row = block_dest + static_cast<size_t>(y) * width;
+            for (uint32_t x = 0; x < size; x += 4)
+                unswizzle_tile(row + x, width, block_src + (morton_offsets[y] | (morton_offsets[x] << 1)));
+        }
+    }
+}
+
 void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
     if (bits_per_pixel % 8 != 0) {
         // Don't support yet
@@ -122,10 +324,32 @@ void swizzled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint1
 
     uint8_t bytes_per_pixel = (bits_per_pixel + 7) >> 3;
 
-    for (uint32_t i = 0; i < static_cast<uint32_t>(width * height); i++) {
-        size_t min = width < height ? width : height;
-        size_t k = static_cast<size_t>(log2(min));
+    if (is_power_of_two(width) && is_power_of_two(height) && (std::min(width, height) <= MAX_SWIZZLE_BLOCK_SIZE)) {
+        switch (bytes_per_pixel) {
+        case 1:
+            unswizzle_blocks(dest, src, width, height);
+            return;
+        case 2:
+            unswizzle_blocks(reinterpret_cast<uint16_t *>(dest), reinterpret_cast<const uint16_t *>(src), width, height);
+            return;
+        case 4:
+            unswizzle_blocks(reinterpret_cast<uint32_t *>(dest), reinterpret_cast<const uint32_t *>(src), width, height);
+            return;
+        case 8:
+            unswizzle_blocks(reinterpret_cast<uint64_t *>(dest), reinterpret_cast<const uint64_t *>(src), width, height);
+            return;
+        case 16:
+            unswizzle_blocks(reinterpret_cast<Texel128 *>(dest), reinterpret_cast<const Texel128 *>(src), width, height);
+            return;
+        default:
+            break;
+        }
+    }
 
+    const size_t min = width < height ? width : height;
+    const size_t k = static_cast<size_t>(log2(min));
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(width * height); i++) {
         size_t x, y;
         if (height < width) {
             // XXXyxyxyx → XXXxxxyyy
@@ -157,18 +381,19 @@ void tiled_texture_to_linear_texture(uint8_t *dest, const uint8_t *src, uint16_t
         return;
     }
 
-    const uint16_t width_in_tiles = (width + 31) >> 5;
+    const size_t bytes_per_pixel = bits_per_pixel >> 3;
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+    const size_t tile_row_size = 32 * bytes_per_pixel;
+    const size_t tile_size = 32 * tile_row_size;
 
-    for (uint16_t y = 0; y < width; y++) {
-        for (uint16_t x = 0; x < height; x++) {
-            // Calculate texel address in title
-            const uint16_t texel_offset_in_title = (x & 0b11111) | ((y & 0b11111) << 4);
-            const uint16_t tile_address = (x & 0b111111100000) + width_in_tiles * (y & 0b111111100000);
+    // Texels of a tile are stored row by row, so every tile row is one run of 32 texels.
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *tile_row = src + (y >> 5) * width_in_tiles * tile_size + (y & 0b11111) * tile_row_size;
+        uint8_t *dest_row = dest + static_cast<size_t>(y) * width * bytes_per_pixel;
 
-            uint32_t offset = ((tile_address << 9) | (texel_offset_in_title)) * (bits_per_pixel >> 3);
-
-            // Make scanline
-            memcpy(dest + ((y * width) + x) * (bits_per_pixel >> 3), src + offset, bits_per_pixel >> 3);
+        for (uint32_t tile_x = 0; tile_x < width_in_tiles; tile_x++) {
+            const uint32_t texels = std::min<uint32_t>(32, width - tile_x * 32);
+            std::memcpy(dest_row + tile_x * tile_row_size, tile_row + tile_x * tile_size, texels * bytes_per_pixel);
         }
     }
 }
@@ -420,6 +645,127 @@ static void decompress_block_dxt5(std::uint32_t x, std::uint32_t y, std::uint32_
     }
 }
 
+#ifdef TEXTURE_DECODER_AVX2
+// Same rounding as the per-texel decoders above, so that both produce identical images.
+static void decode_bc_color_palette(const std::uint8_t *block_storage, bool allow_three_colors, std::uint32_t palette[4]) {
+    const std::uint16_t color0 = block_storage[0] | (block_storage[1] << 8);
+    const std::uint16_t color1 = block_storage[2] | (block_storage[3] << 8);
+
+    const auto expand = [](std::uint32_t value, std::uint32_t bits) {
+        const std::uint32_t max = (1 << bits) - 1;
+        const std::uint32_t temp = value * 255 + (max + 1) / 2;
+        return (temp / (max + 1) + temp) / (max + 1);
+    };
+
+    const std::uint32_t r0 = expand(color0 >> 11, 5), g0 = expand((color0 >> 5) & 0x3F, 6), b0 = expand(color0 & 0x1F, 5);
+    const std::uint32_t r1 = expand(color1 >> 11, 5), g1 = expand((color1 >> 5) & 0x3F, 6), b1 = expand(color1 & 0x1F, 5);
+
+    palette[0] = pack_rgba_reversed(r0, g0, b0, 0);
+    palette[1] = pack_rgba_reversed(r1, g1, b1, 0);
+    if (!allow_three_colors || (color0 > color1)) {
+        palette[2] = pack_rgba_reversed((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 0);
+        palette[3] = pack_rgba_reversed((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 0);
+    } else {
+        palette[2] = pack_rgba_reversed((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 0);
+        palette[3] = 0;
+    }
+}
+
+static void decode_bc3_alpha_palette(std::uint8_t alpha0, std::uint8_t alpha1, std::uint32_t palette[8]) {
+    palette[0] = alpha0 << 24;
+    palette[1] = alpha1 << 24;
+    for (std::uint32_t code = 2; code < 8; code++) {
+        std::uint32_t alpha;
+        if (alpha0 > alpha1)
+            alpha = ((8 - code) * alpha0 + (code - 1) * alpha1) / 7;
+        else if (code >= 6)
+            alpha = (code == 6) ? 0 : 255;
+        else
+            alpha = ((6 - code) * alpha0 + (code - 1) * alpha1) / 5;
+
+        palette[code] = alpha << 24;
+    }
+}
+
+// Decodes a block straight into the order decompress_bc_swizz_image stores texels in. The first eight outputs
+// are texels 0, 4, 1, 5, 8, 12, 9, 13 of the block and the last eight are texels 2, 6, 3, 7, 10, 14, 11, 15.
+TEXTURE_AVX2_FUNCTION static void decompress_bc_swizz_image_avx2(std::uint32_t width, std::uint32_t height, const std::uint8_t *block_storage, std::uint32_t *image, const std::uint8_t bc_type) {
+    const std::uint32_t block_count_x = (width + 3) / 4;
+    const std::uint32_t block_count_y = (height + 3) / 4;
+    const std::uint32_t block_size = (bc_type > 1) ? 16 : 8;
+    const std::uint32_t color_offset = block_size - 8;
+
+    // Two bits per texel of color indices.
+    const __m256i color_shifts[2] = {
+        _mm256_setr_epi32(0, 8, 2, 10, 16, 24, 18, 26),
+        _mm256_setr_epi32(4, 12, 6, 14, 20, 28, 22, 30),
+    };
+    // Four bits per texel of BC2 alpha, texels 0-7 in the low word and 8-15 in the high word.
+    const __m256i bc2_alpha_shifts[2] = {
+        _mm256_setr_epi32(0, 16, 4, 20, 0, 16, 4, 20),
+        _mm256_setr_epi32(8, 24, 12, 28, 8, 24, 12, 28),
+    };
+    // Three bits per texel of BC3 alpha indices, texels 0-7 in the low 24 bits and 8-15 in the next 24.
+    const __m256i bc3_alpha_shifts[2] = {
+        _mm256_setr_epi32(0, 12, 3, 15, 0, 12, 3, 15),
+        _mm256_setr_epi32(6, 18, 9, 21, 6, 18, 9, 21),
+    };
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    alignas(32) std::uint32_t color_palette[8] = {};
+    alignas(32) std::uint32_t alpha_palette[8] = {};
+
+    for (std::uint32_t j = 0; j < block_count_y; j++) {
+        for (std::uint32_t i = 0; i < block_count_x; i++) {
+            const std::uint8_t *const block = block_storage + i * block_size;
+            const std::uint8_t *const color_block = block + color_offset;
+
+            decode_bc_color_palette(color_block, bc_type != 3, color_palette);
+            const __m256i colors = _mm256_load_si256(reinterpret_cast<const __m256i *>(color_palette));
+
+            std::uint32_t color_code;
+            std::memcpy(&color_code, color_block + 4, sizeof(color_code));
+            const __m256i color_codes = _mm256_set1_epi32(static_cast<int>(color_code));
+
+            __m256i alpha_source = _mm256_setzero_si256();
+            __m256i alpha_entries = opaque;
+            if (bc_type == 2) {
+                std::uint32_t alpha_words[2];
+                std::memcpy(alpha_words, block, sizeof(alpha_words));
+                alpha_source = _mm256_setr_epi32(alpha_words[0], alpha_words[0], alpha_words[0], alpha_words[0], alpha_words[1], alpha_words[1], alpha_words[1], alpha_words[1]);
+            } else if (bc_type == 3) {
+                decode_bc3_alpha_palette(block[0], block[1], alpha_palette);
+                alpha_entries = _mm256_load_si256(reinterpret_cast<const __m256i *>(alpha_palette));
+
+                const std::uint32_t low = block[2] | (block[3] << 8) | (block[4] << 16);
+                const std::uint32_t high = block[5] | (block[6] << 8) | (block[7] << 16);
+                alpha_source = _mm256_setr_epi32(low, low, low, low, high, high, high, high);
+            }
+
+            for (int half = 0; half < 2; half++) {
+                const __m256i color_indices = _mm256_and_si256(_mm256_srlv_epi32(color_codes, color_shifts[half]), _mm256_set1_epi32(3));
+                const __m256i rgb = _mm256_permutevar8x32_epi32(colors, color_indices);
+
+                __m256i alpha = alpha_entries;
+                if (bc_type == 2) {
+                    const __m256i nibbles = _mm256_and_si256(_mm256_srlv_epi32(alpha_source, bc2_alpha_shifts[half]), _mm256_set1_epi32(0xF));
+                    alpha = _mm256_or_si256(_mm256_slli_epi32(nibbles, 24), _mm256_slli_epi32(nibbles, 28));
+                } else if (bc_type == 3) {
+                    const __m256i alpha_indices = _mm256_and_si256(_mm256_srlv_epi32(alpha_source, bc3_alpha_shifts[half]), _mm256_set1_epi32(7));
+                    alpha = _mm256_permutevar8x32_epi32(alpha_entries, alpha_indices);
+                }
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(image + half * 8), _mm256_or_si256(rgb, alpha));
+            }
+
+            image += 16;
+        }
+
+        block_storage += block_count_x * block_size;
+    }
+}
+#endif
+
 /**
  * \brief Decompresses all the blocks of a DXT compressed texture and stores the resulting pixels in 'image'.
  * 
@@ -432,6 +778,13 @@ static void decompress_block_dxt5(std::uint32_t x, std::uint32_t y, std::uint32_
  * \param bc_type          Block compressed type. BC1 (DXT1), BC2 (DXT2) or BC3 (DXT3).
  */
 void decompress_bc_swizz_image(std::uint32_t width, std::uint32_t height, const std::uint8_t *block_storage, std::uint32_t *image, const std::uint8_t bc_type) {
+#ifdef TEXTURE_DECODER_AVX2
+    if ((get_decoder_isa() == DecoderIsa::AVX2) && (bc_type >= 1) && (bc_type <= 3)) {
+        decompress_bc_swizz_image_avx2(width, height, block_storage, image, bc_type);
+        return;
+    }
+#endif
+
     std::uint32_t block_count_x = (width + 3) / 4;
     std::uint32_t block_count_y = (height + 3) / 4;
     std::uint32_t block_size = (bc_type > 1) ? 16 : 8;
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <renderer/functions.h>
+
+// AVX2 decoders are built on every x86 target and only called once the host is known to support them.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define TEXTURE_DECODER_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TEXTURE_AVX2_FUNCTION
+#else
+#define TEXTURE_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
@@ -1,3 +1,5 @@
+#include "texture_isa.h"
+
 #include <renderer/functions.h>
 #include <renderer/profile.h>
 
@@ -5,17 +7,66 @@
 #include <mem/ptr.h>
 #include <util/log.h>
 
+#include <cstring>
+
 namespace renderer {
 namespace texture {
 
+#ifdef TEXTURE_DECODER_AVX2
+// Looks up eight texels at a time. The 16 entry palette fits in two registers, bit 3 of the index picks one.
+TEXTURE_AVX2_FUNCTION static size_t palette_row_to_rgba_4_avx2(uint32_t *dst_row, const uint8_t *src_row, size_t width, const uint32_t *palette) {
+    const __m256i low_entries = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(palette));
+    const __m256i high_entries = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(palette + 8));
+    const __m256i nibble_shifts = _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4);
+    const __m256i nibble_mask = _mm256_set1_epi32(0xf);
+
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint32_t packed;
+        std::memcpy(&packed, &src_row[x / 2], sizeof(packed));
+        const __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(packed));
+        const __m256i pairs = _mm256_cvtepu8_epi32(_mm_unpacklo_epi8(bytes, bytes));
+        const __m256i indices = _mm256_and_si256(_mm256_srlv_epi32(pairs, nibble_shifts), nibble_mask);
+
+        const __m256 from_low = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(low_entries, indices));
+        const __m256 from_high = _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(high_entries, indices));
+        const __m256 use_high = _mm256_castsi256_ps(_mm256_slli_epi32(indices, 28));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst_row[x]), _mm256_castps_si256(_mm256_blendv_ps(from_low, from_high, use_high)));
+    }
+
+    return x;
+}
+
+TEXTURE_AVX2_FUNCTION static size_t palette_row_to_rgba_8_avx2(uint32_t *dst_row, const uint8_t *src_row, size_t width, const uint32_t *palette) {
+    const int *const entries = reinterpret_cast<const int *>(palette);
+
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&src_row[x]));
+        const __m256i first = _mm256_i32gather_epi32(entries, _mm256_cvtepu8_epi32(bytes), 4);
+        const __m256i second = _mm256_i32gather_epi32(entries, _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst_row[x]), first);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst_row[x + 8]), second);
+    }
+
+    return x;
+}
+#endif
+
 void palette_texture_to_rgba_4(uint32_t *dst, const uint8_t *src, size_t width, size_t height, const uint32_t *palette) {
     R_PROFILE(__func__);
 
+    const bool use_avx2 = get_decoder_isa() == DecoderIsa::AVX2;
     const size_t stride = ((width + 7) & ~7) / 2; // NOTE: This is correct only with linear textures.
     for (size_t y = 0; y < height; ++y) {
         uint32_t *const dst_row = &dst[y * width];
         const uint8_t *const src_row = &src[y * stride];
-        for (size_t x = 0; x < width; x += 2) {
+        size_t x = 0;
+#ifdef TEXTURE_DECODER_AVX2
+        if (use_avx2)
+            x = palette_row_to_rgba_4_avx2(dst_row, src_row, width, palette);
+#endif
+        for (; x < width; x += 2) {
             const uint8_t lohi = src_row[x / 2];
             const uint8_t lo = lohi & 0xf;
             const uint8_t hi = lohi >> 4;
@@ -28,11 +79,17 @@ void palette_texture_to_rgba_4(uint32_t *dst, const uint8_t *src, size_t width,
 void palette_texture_to_rgba_8(uint32_t *dst, const uint8_t *src, size_t width, size_t height, const uint32_t *palette) {
     R_PROFILE(__func__);
 
+    const bool use_avx2 = get_decoder_isa() == DecoderIsa::AVX2;
     const size_t stride = (width + 7) & ~7; // NOTE: This is correct only with linear textures.
     for (size_t y = 0; y < height; ++y) {
         uint32_t *const dst_row = &dst[y * width];
         const uint8_t *const src_row = &src[y * stride];
-        for (size_t x = 0; x < width; ++x) {
+        size_t x = 0;
+#ifdef TEXTURE_DECODER_AVX2
+        if (use_avx2)
+            x = palette_row_to_rgba_8_avx2(dst_row, src_row, width, palette);
+#endif
+        for (; x < width; ++x) {
             dst_row[x] = palette[src_row[x]];
         }
     }
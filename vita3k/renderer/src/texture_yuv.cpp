@@ -1,8 +1,14 @@
 #include <renderer/functions.h>
+#include <renderer/profile.h>
 
+#include <gxm/functions.h>
 #include <util/log.h>
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 extern "C" {
 #include <libswscale/swscale.h>
@@ -10,54 +16,161 @@ extern "C" {
 
 namespace renderer::texture {
 
-static SwsContext *s_render_sws_context{};
-static size_t res[2] = { 0, 0 };
-SwsContext *get_sws_context(size_t width, size_t height) {
-    bool recreate = false;
-    if (res[0] != width || res[1] != height) {
-        recreate = true;
-        res[0] = width;
-        res[1] = height;
-    } else if (s_render_sws_context == nullptr) {
-        recreate = true;
-    }
-
-    if (recreate) {
-        if (s_render_sws_context != nullptr) {
-            sws_freeContext(s_render_sws_context);
-            s_render_sws_context = nullptr;
-        }
-        s_render_sws_context = sws_getContext(width, height, AV_PIX_FMT_YUV420P, width, height, AV_PIX_FMT_RGB24,
-            0, nullptr, nullptr, nullptr);
+// What a conversion context converts from. CSC0 textures use the ITU-R BT.601 matrix and CSC1 textures
+// the ITU-R BT.709 one, both with limited range.
+struct SwsContextKey {
+    size_t width = 0;
+    size_t height = 0;
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    bool bt709 = false;
+
+    bool operator==(const SwsContextKey &other) const {
+        return (width == other.width) && (height == other.height) && (format == other.format) && (bt709 == other.bt709);
+    }
+};
+
+struct SwsContextDeleter {
+    void operator()(SwsContext *context) const {
+        sws_freeContext(context);
+    }
+};
+
+typedef std::unique_ptr<SwsContext, SwsContextDeleter> SwsContextPtr;
+typedef std::vector<std::pair<SwsContextKey, SwsContextPtr>> SwsContexts;
+
+// Enough for every video a title plays at once. Past this the least recently used context is freed.
+static constexpr size_t MAX_SWS_CONTEXTS = 4;
+
+// Contexts can't be shared between threads, so every decode thread keeps its own. Most recently used first.
+static thread_local SwsContexts sws_contexts;
+
+static SwsContext *get_sws_context(const SwsContextKey &key) {
+    const auto cached = std::find_if(sws_contexts.begin(), sws_contexts.end(), [&key](const auto &entry) {
+        return entry.first == key;
+    });
+    if (cached != sws_contexts.end()) {
+        std::rotate(sws_contexts.begin(), cached, cached + 1);
+        return sws_contexts.front().second.get();
+    }
+
+    SwsContextPtr context(sws_getContext(static_cast<int>(key.width), static_cast<int>(key.height), key.format,
+        static_cast<int>(key.width), static_cast<int>(key.height), AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr));
+    if (!context) {
+        LOG_ERROR("Failed to create a {}x{} YUV conversion context.", key.width, key.height);
+        return nullptr;
     }
-    return s_render_sws_context;
+
+    int *inv_table = nullptr;
+    int *table = nullptr;
+    int src_range = 0;
+    int dst_range = 0;
+    int brightness = 0;
+    int contrast = 0;
+    int saturation = 0;
+    sws_getColorspaceDetails(context.get(), &inv_table, &src_range, &table, &dst_range, &brightness, &contrast, &saturation);
+    sws_setColorspaceDetails(context.get(), sws_getCoefficients(key.bt709 ? SWS_CS_ITU709 : SWS_CS_ITU601), 0, table, 1, brightness, contrast, saturation);
+
+    if (sws_contexts.size() == MAX_SWS_CONTEXTS)
+        sws_contexts.pop_back();
+
+    sws_contexts.emplace(sws_contexts.begin(), key, std::move(context));
+    return sws_contexts.front().second.get();
 }
 
-void yuv420_texture_to_rgb(uint8_t *dst, const uint8_t *src, size_t width, size_t height) {
-    SwsContext *context = get_sws_context(width, height);
-    assert(context);
+void yuv_texture_to_rgba(uint8_t *dst, const uint8_t *src, size_t width, size_t height, SceGxmTextureFormat format) {
+    R_PROFILE(__func__);
 
-    const uint8_t *slices[] = {
-        &src[0], // Y Slice
-        &src[width * height], // U Slice
-        &src[width * height + width * height / 4], // V Slice
-    };
+    const SceGxmTextureBaseFormat base_format = gxm::get_base_format(format);
+    const uint32_t swizzle = format & 0x0000f000;
+    const size_t chroma_width = (width + 1) / 2;
+    const size_t chroma_height = (height + 1) / 2;
 
-    int strides[] = {
-        static_cast<int>(width),
-        static_cast<int>(width / 2),
-        static_cast<int>(width / 2),
-    };
+    SwsContextKey key;
+    key.width = width;
+    key.height = height;
+
+    const uint8_t *slices[3] = {};
+    int strides[3] = {};
+
+    // Only used to reorder VYUY, which swscale has no reader for.
+    static thread_local std::vector<uint8_t> reordered;
+
+    switch (base_format) {
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P2: {
+        const bool swap_chroma = swizzle & SCE_GXM_TEXTURE_SWIZZLE_YVU_CSC0;
+        key.format = swap_chroma ? AV_PIX_FMT_NV21 : AV_PIX_FMT_NV12;
+        key.bt709 = swizzle & SCE_GXM_TEXTURE_SWIZZLE_YUV_CSC1;
+        slices[0] = src;
+        slices[1] = src + width * height;
+        strides[0] = static_cast<int>(width);
+        strides[1] = static_cast<int>(chroma_width * 2);
+        break;
+    }
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV420P3: {
+        const bool swap_chroma = swizzle & SCE_GXM_TEXTURE_SWIZZLE_YVU_CSC0;
+        const uint8_t *const first_chroma = src + width * height;
+        const uint8_t *const second_chroma = first_chroma + chroma_width * chroma_height;
+        key.format = AV_PIX_FMT_YUV420P;
+        key.bt709 = swizzle & SCE_GXM_TEXTURE_SWIZZLE_YUV_CSC1;
+        slices[0] = src;
+        slices[1] = swap_chroma ? second_chroma : first_chroma;
+        slices[2] = swap_chroma ? first_chroma : second_chroma;
+        strides[0] = static_cast<int>(width);
+        strides[1] = static_cast<int>(chroma_width);
+        strides[2] = static_cast<int>(chroma_width);
+        break;
+    }
+    case SCE_GXM_TEXTURE_BASE_FORMAT_YUV422: {
+        const size_t row_size = chroma_width * 4;
+        key.bt709 = swizzle & SCE_GXM_TEXTURE_SWIZZLE_YUYV_CSC1;
+        slices[0] = src;
+        strides[0] = static_cast<int>(row_size);
+
+        switch (swizzle & ~SCE_GXM_TEXTURE_SWIZZLE_YUYV_CSC1) {
+        case SCE_GXM_TEXTURE_SWIZZLE_YUYV_CSC0:
+            key.format = AV_PIX_FMT_YUYV422;
+            break;
+        case SCE_GXM_TEXTURE_SWIZZLE_YVYU_CSC0:
+            key.format = AV_PIX_FMT_YVYU422;
+            break;
+        case SCE_GXM_TEXTURE_SWIZZLE_UYVY_CSC0:
+            key.format = AV_PIX_FMT_UYVY422;
+            break;
+        case SCE_GXM_TEXTURE_SWIZZLE_VYUY_CSC0:
+            // Swap the chroma bytes of every pair of texels to get UYVY.
+            reordered.resize(row_size * height);
+            for (size_t i = 0; i < reordered.size(); i += 4) {
+                reordered[i + 0] = src[i + 2];
+                reordered[i + 1] = src[i + 1];
+                reordered[i + 2] = src[i + 0];
+                reordered[i + 3] = src[i + 3];
+            }
+            key.format = AV_PIX_FMT_UYVY422;
+            slices[0] = reordered.data();
+            break;
+        }
+        break;
+    }
+    default:
+        LOG_ERROR("Texture format {} is not YUV.", log_hex(format));
+        return;
+    }
+
+    SwsContext *const context = get_sws_context(key);
+    if (!context) {
+        std::memset(dst, 0, width * height * 4);
+        return;
+    }
 
     uint8_t *dst_slices[] = {
         dst,
     };
 
     const int dst_strides[] = {
-        static_cast<int>(width * 3),
+        static_cast<int>(width * 4),
     };
 
-    int error = sws_scale(context, slices, strides, 0, height, dst_slices, dst_strides);
-    assert(error == height);
+    const int error = sws_scale(context, slices, strides, 0, static_cast<int>(height), dst_slices, dst_strides);
+    assert(error == static_cast<int>(height));
 }
 } // namespace renderer::texture
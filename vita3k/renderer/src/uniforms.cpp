@@ -26,8 +26,8 @@ void set_uniforms(State &state, Context *ctx, const SceGxmProgram &program, cons
         const std::size_t uniform_raw_size = parameter.component_count * parameter.array_size * sizeof(std::uint32_t);
         const std::size_t offset = parameter.resource_index * sizeof(std::uint32_t);
 
-        // Free later by the queue
-        std::uint8_t *data = new std::uint8_t[uniform_raw_size];
+        // Valid until the renderer is done with the scene. It is read back to set the uniform on the CPU.
+        std::uint8_t *data = static_cast<std::uint8_t *>(alloc_staging(*ctx, uniform_raw_size, true));
 
         // Copy data to temporary buffer
         std::copy(base + offset, base + offset + uniform_raw_size, data);
@@ -0,0 +1,198 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Measures swizzled and tiled texture conversion against the per-texel loops they replaced, and the palette and
+// block compression decoders of each instruction set against the scalar ones. renderer-tests checks that they match.
+
+constexpr size_t ITERATIONS = 8;
+
+// The previous unswizzler: two Morton decodes, a log2 and a division for every texel.
+static uint32_t compact_one_by_one(uint32_t x) {
+    x &= 0x55555555;
+    x = (x ^ (x >> 1)) & 0x33333333;
+    x = (x ^ (x >> 2)) & 0x0f0f0f0f;
+    x = (x ^ (x >> 4)) & 0x00ff00ff;
+    x = (x ^ (x >> 8)) & 0x0000ffff;
+    return x;
+}
+
+static void reference_swizzled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const uint8_t bytes_per_pixel = bits_per_pixel >> 3;
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(width * height); i++) {
+        size_t min = width < height ? width : height;
+        size_t k = static_cast<size_t>(log2(min));
+
+        size_t x, y;
+        if (height < width) {
+            size_t j = i >> (2 * k) << (2 * k)
+                | (compact_one_by_one(i >> 1) & (min - 1)) << k
+                | (compact_one_by_one(i) & (min - 1)) << 0;
+            x = j / height;
+            y = j % height;
+        } else {
+            size_t j = i >> (2 * k) << (2 * k)
+                | (compact_one_by_one(i) & (min - 1)) << k
+                | (compact_one_by_one(i >> 1) & (min - 1)) << 0;
+            x = j % width;
+            y = j / width;
+        }
+
+        if (y >= height || x >= width)
+            continue;
+
+        std::memcpy(dest + (y * width + x) * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+    }
+}
+
+// Per-texel address computation for 32x32 tiles stored row by row.
+static void reference_tiled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const uint8_t bytes_per_pixel = bits_per_pixel >> 3;
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint32_t tile = (y >> 5) * width_in_tiles + (x >> 5);
+            const uint32_t texel = ((y & 31) << 5) | (x & 31);
+            std::memcpy(dest + (y * width + x) * bytes_per_pixel, src + ((tile << 10) | texel) * bytes_per_pixel, bytes_per_pixel);
+        }
+    }
+}
+
+typedef void (*ConvertFunction)(uint8_t *, const uint8_t *, uint16_t, uint16_t, uint8_t);
+
+static double run(ConvertFunction convert, std::vector<uint8_t> &dest, const std::vector<uint8_t> &src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i)
+        convert(dest.data(), src.data(), width, height, bits_per_pixel);
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count() / ITERATIONS;
+}
+
+static void compare(const char *name, ConvertFunction reference, ConvertFunction convert, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const size_t tiled_width = (width + 31) & ~31;
+    const size_t tiled_height = (height + 31) & ~31;
+    std::vector<uint8_t> src(tiled_width * tiled_height * (bits_per_pixel >> 3));
+    std::mt19937 rng(width * 31 + height);
+    for (uint8_t &byte : src)
+        byte = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * (bits_per_pixel >> 3));
+    std::vector<uint8_t> actual(expected.size());
+    const double reference_seconds = run(reference, expected, src, width, height, bits_per_pixel);
+    const double seconds = run(convert, actual, src, width, height, bits_per_pixel);
+
+    std::printf("%-8s %4ux%-4u %3u bpp: %9.3f ms -> %8.3f ms (%5.1fx)\n", name, width, height, bits_per_pixel,
+        reference_seconds * 1000, seconds * 1000, reference_seconds / seconds);
+}
+
+typedef void (*DecodeFunction)(uint32_t *, const uint8_t *, uint32_t, uint32_t);
+
+static double run_decoder(DecodeFunction decode, std::vector<uint32_t> &dest, const std::vector<uint8_t> &src, uint32_t width, uint32_t height) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i)
+        decode(dest.data(), src.data(), width, height);
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count() / ITERATIONS;
+}
+
+static void compare_decoder(const char *name, DecodeFunction decode, uint32_t width, uint32_t height) {
+    using renderer::texture::DecoderIsa;
+
+    std::vector<uint8_t> src(static_cast<size_t>(width) * height * 2);
+    std::mt19937 rng(width * 31 + height);
+    for (uint8_t &byte : src)
+        byte = static_cast<uint8_t>(rng());
+
+    const DecoderIsa best_isa = renderer::texture::get_decoder_isa();
+    if (best_isa == DecoderIsa::Scalar) {
+        std::printf("%-8s %4ux%-4u: only the scalar decoder is supported\n", name, width, height);
+        return;
+    }
+
+    std::vector<uint32_t> expected(static_cast<size_t>(width) * height);
+    std::vector<uint32_t> actual(expected.size());
+    renderer::texture::set_decoder_isa(DecoderIsa::Scalar);
+    const double reference_seconds = run_decoder(decode, expected, src, width, height);
+    renderer::texture::set_decoder_isa(best_isa);
+    const double seconds = run_decoder(decode, actual, src, width, height);
+
+    std::printf("%-8s %4ux%-4u: %9.3f ms -> %8.3f ms (%5.1fx, %6.0f Mtexel/s)\n", name, width, height,
+        reference_seconds * 1000, seconds * 1000, reference_seconds / seconds, width * height / seconds / 1e6);
+}
+
+static const uint32_t *benchmark_palette() {
+    static const std::vector<uint32_t> palette = [] {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < entries.size(); i++)
+            entries[i] = i * 0x01010101;
+        return entries;
+    }();
+    return palette.data();
+}
+
+static void decode_palette_4(uint32_t *dest, const uint8_t *src, uint32_t width, uint32_t height) {
+    renderer::texture::palette_texture_to_rgba_4(dest, src, width, height, benchmark_palette());
+}
+
+static void decode_palette_8(uint32_t *dest, const uint8_t *src, uint32_t width, uint32_t height) {
+    renderer::texture::palette_texture_to_rgba_8(dest, src, width, height, benchmark_palette());
+}
+
+template <uint8_t bc_type>
+static void decode_bc(uint32_t *dest, const uint8_t *src, uint32_t width, uint32_t height) {
+    renderer::texture::decompress_bc_swizz_image(width, height, src, dest, bc_type);
+}
+
+int main() {
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64, 128 }) {
+        for (const uint16_t size : { 256, 512, 1024, 2048 })
+            compare("swizzled", reference_swizzled_to_linear, renderer::texture::swizzled_texture_to_linear_texture, size, size, bits_per_pixel);
+        compare("swizzled", reference_swizzled_to_linear, renderer::texture::swizzled_texture_to_linear_texture, 1024, 256, bits_per_pixel);
+        compare("swizzled", reference_swizzled_to_linear, renderer::texture::swizzled_texture_to_linear_texture, 256, 1024, bits_per_pixel);
+        compare("swizzled", reference_swizzled_to_linear, renderer::texture::swizzled_texture_to_linear_texture, 2, 8, bits_per_pixel);
+    }
+
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64 }) {
+        for (const uint16_t size : { 256, 512, 1024, 2048 })
+            compare("tiled", reference_tiled_to_linear, renderer::texture::tiled_texture_to_linear_texture, size, size, bits_per_pixel);
+        compare("tiled", reference_tiled_to_linear, renderer::texture::tiled_texture_to_linear_texture, 480, 272, bits_per_pixel);
+    }
+
+    for (const uint32_t size : { 256, 1024, 2048 }) {
+        compare_decoder("p4", decode_palette_4, size, size);
+        compare_decoder("p8", decode_palette_8, size, size);
+        compare_decoder("bc1", decode_bc<1>, size, size);
+        compare_decoder("bc2", decode_bc<2>, size, size);
+        compare_decoder("bc3", decode_bc<3>, size, size);
+    }
+    compare_decoder("p4", decode_palette_4, 480, 272);
+    compare_decoder("p8", decode_palette_8, 480, 272);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace renderer::texture;
+
+typedef std::function<void(std::vector<uint32_t> &)> Decoder;
+
+// Decodes with the scalar decoders, which are the reference image, then with every other instruction set the host
+// supports. Output buffers are prefilled so that texels a decoder skips show up as differences.
+static void expect_same_image(size_t texel_count, const Decoder &decode) {
+    const DecoderIsa default_isa = get_decoder_isa();
+
+    std::vector<uint32_t> expected(texel_count, 0xDEADBEEF);
+    ASSERT_TRUE(set_decoder_isa(DecoderIsa::Scalar));
+    decode(expected);
+
+    bool tested = false;
+    for (const DecoderIsa isa : { DecoderIsa::AVX2 }) {
+        if (!set_decoder_isa(isa))
+            continue;
+
+        std::vector<uint32_t> actual(texel_count, 0xDEADBEEF);
+        decode(actual);
+        EXPECT_EQ(expected, actual) << "instruction set " << static_cast<int>(isa);
+        tested = true;
+    }
+
+    set_decoder_isa(default_isa);
+    if (!tested)
+        GTEST_SKIP() << "the host only supports the scalar decoders";
+}
+
+static std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t &byte : bytes)
+        byte = static_cast<uint8_t>(rng());
+
+    return bytes;
+}
+
+static void expect_same_palette_image(size_t width, size_t height, size_t bits_per_index) {
+    const size_t stride = (width + 7) & ~7;
+    const std::vector<uint8_t> src = random_bytes(stride * height, static_cast<uint32_t>(width * 7 + height));
+    const std::vector<uint8_t> palette_bytes = random_bytes(256 * sizeof(uint32_t), 1);
+    const uint32_t *const palette = reinterpret_cast<const uint32_t *>(palette_bytes.data());
+
+    // The 4-bit decoder writes texels in pairs, so odd widths need one texel of slack at the end.
+    expect_same_image(width * height + 1, [&](std::vector<uint32_t> &dst) {
+        if (bits_per_index == 4)
+            palette_texture_to_rgba_4(dst.data(), src.data(), width, height, palette);
+        else
+            palette_texture_to_rgba_8(dst.data(), src.data(), width, height, palette);
+    });
+}
+
+static void expect_same_bc_image(uint32_t width, uint32_t height, uint8_t bc_type, std::vector<uint8_t> blocks) {
+    const size_t block_count = ((width + 3) / 4) * ((height + 3) / 4);
+    ASSERT_EQ(blocks.size(), block_count * ((bc_type > 1) ? 16 : 8));
+
+    expect_same_image(block_count * 16, [&](std::vector<uint32_t> &dst) {
+        decompress_bc_swizz_image(width, height, blocks.data(), dst.data(), bc_type);
+    });
+}
+
+TEST(texture_decoder, palette_4) {
+    for (const size_t width : { 1, 2, 7, 8, 9, 16, 33, 480 })
+        expect_same_palette_image(width, 5, 4);
+}
+
+TEST(texture_decoder, palette_8) {
+    for (const size_t width : { 1, 7, 8, 15, 16, 17, 33, 480 })
+        expect_same_palette_image(width, 5, 8);
+}
+
+TEST(texture_decoder, bc_random_blocks) {
+    for (const uint8_t bc_type : { 1, 2, 3 }) {
+        for (const uint32_t size : { 4, 12, 64, 256 }) {
+            const size_t block_count = (size / 4) * (size / 4);
+            expect_same_bc_image(size, size, bc_type, random_bytes(block_count * ((bc_type > 1) ? 16 : 8), size + bc_type));
+        }
+        expect_same_bc_image(6, 10, bc_type, random_bytes(6 * ((bc_type > 1) ? 16 : 8), bc_type));
+    }
+}
+
+// Equal endpoints select the three color mode of BC1 and BC2, equal alpha endpoints the six alpha mode of BC3.
+TEST(texture_decoder, bc_equal_endpoints) {
+    std::vector<uint8_t> bc1_block = { 0x34, 0x12, 0x34, 0x12, 0xE4, 0x1B, 0xB1, 0x4E };
+    expect_same_bc_image(4, 4, 1, bc1_block);
+
+    std::vector<uint8_t> bc2_block = { 0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE };
+    bc2_block.insert(bc2_block.end(), bc1_block.begin(), bc1_block.end());
+    expect_same_bc_image(4, 4, 2, bc2_block);
+
+    std::vector<uint8_t> bc3_block = { 0x80, 0x80, 0x88, 0xC6, 0xFA, 0x05, 0x39, 0x77 };
+    bc3_block.insert(bc3_block.end(), bc1_block.begin(), bc1_block.end());
+    expect_same_bc_image(4, 4, 3, bc3_block);
+}
@@ -0,0 +1,131 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <renderer/functions.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace renderer::texture;
+
+// Per-texel Morton decode, the scalar reference for the SSE2 and NEON unswizzlers.
+static uint32_t compact_one_by_one(uint32_t x) {
+    x &= 0x55555555;
+    x = (x ^ (x >> 1)) & 0x33333333;
+    x = (x ^ (x >> 2)) & 0x0f0f0f0f;
+    x = (x ^ (x >> 4)) & 0x00ff00ff;
+    x = (x ^ (x >> 8)) & 0x0000ffff;
+    return x;
+}
+
+static void reference_swizzled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const uint8_t bytes_per_pixel = bits_per_pixel >> 3;
+    const size_t min = width < height ? width : height;
+    const size_t k = static_cast<size_t>(log2(min));
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(width * height); i++) {
+        size_t x, y;
+        if (height < width) {
+            size_t j = i >> (2 * k) << (2 * k)
+                | (compact_one_by_one(i >> 1) & (min - 1)) << k
+                | (compact_one_by_one(i) & (min - 1)) << 0;
+            x = j / height;
+            y = j % height;
+        } else {
+            size_t j = i >> (2 * k) << (2 * k)
+                | (compact_one_by_one(i) & (min - 1)) << k
+                | (compact_one_by_one(i >> 1) & (min - 1)) << 0;
+            x = j % width;
+            y = j / width;
+        }
+
+        if (y >= height || x >= width)
+            continue;
+
+        std::memcpy(dest + (y * width + x) * bytes_per_pixel, src + i * bytes_per_pixel, bytes_per_pixel);
+    }
+}
+
+// Per-texel address computation for 32x32 tiles stored row by row.
+static void reference_tiled_to_linear(uint8_t *dest, const uint8_t *src, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const uint8_t bytes_per_pixel = bits_per_pixel >> 3;
+    const uint32_t width_in_tiles = (width + 31) >> 5;
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint32_t tile = (y >> 5) * width_in_tiles + (x >> 5);
+            const uint32_t texel = ((y & 31) << 5) | (x & 31);
+            std::memcpy(dest + (y * width + x) * bytes_per_pixel, src + ((tile << 10) | texel) * bytes_per_pixel, bytes_per_pixel);
+        }
+    }
+}
+
+typedef void (*ConvertFunction)(uint8_t *, const uint8_t *, uint16_t, uint16_t, uint8_t);
+
+// Source buffers cover whole tiles, output buffers are prefilled so that texels a conversion skips show up as differences.
+static void expect_same_layout(ConvertFunction reference, ConvertFunction convert, uint16_t width, uint16_t height, uint8_t bits_per_pixel) {
+    const size_t tiled_width = (width + 31) & ~31;
+    const size_t tiled_height = (height + 31) & ~31;
+    std::vector<uint8_t> src(tiled_width * tiled_height * (bits_per_pixel >> 3));
+    std::mt19937 rng(width * 31 + height);
+    for (uint8_t &byte : src)
+        byte = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * (bits_per_pixel >> 3), 0xCD);
+    std::vector<uint8_t> actual(expected.size(), 0xCD);
+    reference(expected.data(), src.data(), width, height, bits_per_pixel);
+    convert(actual.data(), src.data(), width, height, bits_per_pixel);
+
+    EXPECT_EQ(expected, actual) << width << "x" << height << ", " << static_cast<int>(bits_per_pixel) << " bpp";
+}
+
+TEST(texture_format, swizzled_square) {
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64, 128 }) {
+        for (const uint16_t size : { 1, 2, 4, 8, 64, 256 })
+            expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, size, size, bits_per_pixel);
+    }
+}
+
+TEST(texture_format, swizzled_rectangular) {
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64, 128 }) {
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 256, 64, bits_per_pixel);
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 64, 256, bits_per_pixel);
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 2, 8, bits_per_pixel);
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 16, 1, bits_per_pixel);
+    }
+}
+
+// Sizes that are not powers of two take the per-texel path.
+TEST(texture_format, swizzled_not_power_of_two) {
+    for (const uint8_t bits_per_pixel : { 8, 32 }) {
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 480, 272, bits_per_pixel);
+        expect_same_layout(reference_swizzled_to_linear, swizzled_texture_to_linear_texture, 3, 5, bits_per_pixel);
+    }
+}
+
+TEST(texture_format, tiled) {
+    for (const uint8_t bits_per_pixel : { 8, 16, 32, 64 }) {
+        for (const uint16_t size : { 32, 64, 256 })
+            expect_same_layout(reference_tiled_to_linear, tiled_texture_to_linear_texture, size, size, bits_per_pixel);
+        expect_same_layout(reference_tiled_to_linear, tiled_texture_to_linear_texture, 480, 272, bits_per_pixel);
+        expect_same_layout(reference_tiled_to_linear, tiled_texture_to_linear_texture, 33, 1, bits_per_pixel);
+    }
+}
@@ -10,7 +10,8 @@ namespace shader {
 namespace usse {
 namespace disasm {
 
-extern std::string *disasm_storage;
+// Per thread, shaders may be translated on several threads at once.
+extern thread_local std::string *disasm_storage;
 
 //
 // Disasm helpers
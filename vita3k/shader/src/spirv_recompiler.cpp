@@ -1124,6 +1124,9 @@ static SpirvCode convert_gxp_to_spirv(const SceGxmProgram &program, const std::s
     if (!spirv_log.empty())
         LOG_ERROR("SPIR-V Error:\n{}", spirv_log);
 
+    // The storage is about to go out of scope
+    disasm::disasm_storage = nullptr;
+
     if (dumper) {
         dumper("dsm", disasm_dump);
     }
@@ -10,7 +10,7 @@ using namespace shader::usse;
 
 namespace shader::usse::disasm {
 
-std::string *disasm_storage = nullptr;
+thread_local std::string *disasm_storage = nullptr;
 
 //
 // Disasm helpers
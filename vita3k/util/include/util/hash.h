@@ -0,0 +1,29 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Fast non-cryptographic 64-bit hash of a block of memory.
+ *
+ * Same construction as XXH3 (SIMD-friendly 64-byte stripes folded with 32x32->64 multiplies),
+ * but not bit-compatible with it. Suitable for cache keys, not for anything persisted across versions.
+ */
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 0);
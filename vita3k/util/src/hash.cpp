@@ -0,0 +1,158 @@
+// Vita3K emulator project
+// Copyright (C) 2018 Vita3K team
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <util/hash.h>
+
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASH_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr size_t LANES = 8;
+constexpr size_t STRIPE_SIZE = LANES * sizeof(uint64_t);
+constexpr size_t STRIPES_PER_BLOCK = 16;
+constexpr size_t BLOCK_SIZE = STRIPE_SIZE * STRIPES_PER_BLOCK;
+// Each stripe in a block uses the secret shifted by one word.
+constexpr size_t SECRET_WORDS = LANES + STRIPES_PER_BLOCK;
+
+constexpr uint64_t PRIME32_1 = 0x9E3779B1U;
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+
+constexpr uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += PRIME64_1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct Secret {
+    alignas(16) uint64_t words[SECRET_WORDS] = {};
+
+    constexpr Secret() {
+        uint64_t state = PRIME64_2;
+        for (size_t i = 0; i < SECRET_WORDS; ++i)
+            words[i] = splitmix64(state);
+    }
+};
+
+constexpr Secret secret;
+
+#ifndef HASH_SSE2
+uint64_t read64(const uint8_t *p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+#endif
+
+uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+#ifdef _MSC_VER
+    uint64_t high = 0;
+    const uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#endif
+}
+
+uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+// acc[i] += lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i]); acc[i ^ 1] += data[i]
+void accumulate_stripe(uint64_t *acc, const uint8_t *data, const uint64_t *key) {
+#ifdef HASH_SSE2
+    for (size_t i = 0; i < LANES / 2; ++i) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data) + i);
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + i);
+        const __m128i dk = _mm_xor_si128(d, k);
+        const __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+        const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i *const a = reinterpret_cast<__m128i *>(acc) + i;
+        _mm_store_si128(a, _mm_add_epi64(_mm_load_si128(a), _mm_add_epi64(product, swapped)));
+    }
+#else
+    for (size_t i = 0; i < LANES; ++i) {
+        const uint64_t d = read64(data + i * sizeof(uint64_t));
+        const uint64_t dk = d ^ key[i];
+        acc[i ^ 1] += d;
+        acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32);
+    }
+#endif
+}
+
+void scramble(uint64_t *acc, const uint64_t *key) {
+    for (size_t i = 0; i < LANES; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= key[i];
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+} // namespace
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+    alignas(16) uint64_t acc[LANES] = {
+        PRIME32_1, PRIME64_1, PRIME64_2, PRIME64_3,
+        seed, PRIME64_1 ^ seed, PRIME64_2 + seed, PRIME64_3 - seed
+    };
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    size_t remaining = size;
+
+    while (remaining >= BLOCK_SIZE) {
+        for (size_t stripe = 0; stripe < STRIPES_PER_BLOCK; ++stripe)
+            accumulate_stripe(acc, p + stripe * STRIPE_SIZE, secret.words + stripe);
+        scramble(acc, secret.words + STRIPES_PER_BLOCK);
+        p += BLOCK_SIZE;
+        remaining -= BLOCK_SIZE;
+    }
+
+    size_t stripe = 0;
+    while (remaining >= STRIPE_SIZE) {
+        accumulate_stripe(acc, p, secret.words + stripe++);
+        p += STRIPE_SIZE;
+        remaining -= STRIPE_SIZE;
+    }
+
+    if (remaining > 0) {
+        alignas(16) uint8_t last[STRIPE_SIZE] = {};
+        std::memcpy(last, p, remaining);
+        accumulate_stripe(acc, last, secret.words + stripe);
+    }
+
+    uint64_t result = static_cast<uint64_t>(size) * PRIME64_1;
+    for (size_t i = 0; i < LANES; i += 2)
+        result += mul128_fold64(acc[i] ^ secret.words[i + 3], acc[i + 1] ^ secret.words[i + 4]);
+
+    return avalanche(result);
+}